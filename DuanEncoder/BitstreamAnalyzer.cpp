@@ -0,0 +1,605 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "BitstreamAnalyzer.h"
+#include "SliceOutput.h"
+#include <QDataStream>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+
+namespace {
+// 2：头里的总字节数由 u32 扩为 u64，头长 28 字节
+const quint32 kReportVersion = 2;
+
+// 按位读取 RBSP，读的同时跳过防竞争字节（00 00 03 中的 03），不需要先拷贝去除
+class BitReader {
+public:
+    BitReader(const uint8_t* data, const uint8_t* end) : m_pos(data), m_end(end) {}
+
+    int bit() {
+        if (m_bitsLeft == 0) {
+            if (m_pos >= m_end) {
+                m_overrun = true;
+                return 0;
+            }
+            uint8_t byte = *m_pos++;
+            if (m_zeros >= 2 && byte == 3) {
+                m_zeros = 0;
+                if (m_pos >= m_end) {
+                    m_overrun = true;
+                    return 0;
+                }
+                byte = *m_pos++;
+            }
+            m_zeros = byte == 0 ? m_zeros + 1 : 0;
+            m_byte = byte;
+            m_bitsLeft = 8;
+        }
+        m_bitsLeft--;
+        return (m_byte >> m_bitsLeft) & 1;
+    }
+
+    uint32_t bits(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; i++) value = (value << 1) | bit();
+        return value;
+    }
+
+    void skip(int n) {
+        for (int i = 0; i < n; i++) bit();
+    }
+
+    // 指数哥伦布编码
+    uint32_t ue() {
+        int zeros = 0;
+        while (!bit()) {
+            if (m_overrun || ++zeros >= 32) {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + bits(zeros);
+    }
+
+    int32_t se() {
+        uint32_t k = ue();
+        return (k & 1) ? (int32_t)((k + 1) / 2) : -(int32_t)(k / 2);
+    }
+
+    bool ok() const { return !m_overrun; }
+
+private:
+    const uint8_t* m_pos;
+    const uint8_t* m_end;
+    uint8_t m_byte = 0;
+    int m_bitsLeft = 0;
+    int m_zeros = 0;
+    bool m_overrun = false;
+};
+
+// 依次回调 (单元起点, NAL 头, NAL 结尾)。单元从本 NAL 的起始码算到下一个起始码之前，
+// 第一个单元还包含起始码之前的字节，各单元字节数之和等于输入长度
+template <typename Fn>
+void forEachNal(const uint8_t* begin, const uint8_t* end, Fn fn) {
+    const uint8_t* unit = begin;
+    const uint8_t* sc = AnnexB::findStartCode(begin, end);
+    while (sc + 3 < end) {
+        const uint8_t* nal = sc + 3;
+        const uint8_t* next = AnnexB::findStartCode(nal, end);
+        // 4 字节起始码的前导 00 属于下一个 NAL
+        const uint8_t* nalEnd = next;
+        while (next < end && nalEnd > nal && nalEnd[-1] == 0) nalEnd--;
+        fn(unit, nal, next < end ? nalEnd : end);
+        unit = nalEnd;
+        sc = next;
+    }
+}
+
+bool isHighProfile(int profile) {
+    switch (profile) {
+    case 100: case 110: case 122: case 244: case 44:
+    case 83: case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void skipScalingList(BitReader& r, int size) {
+    int last = 8;
+    int next = 8;
+    for (int j = 0; j < size; j++) {
+        if (next != 0) next = (last + r.se() + 256) % 256;
+        last = next == 0 ? last : next;
+    }
+}
+}
+
+BitstreamAnalyzer::BitstreamAnalyzer(AVCodecID codec) : m_codec(codec) {
+}
+
+int BitstreamAnalyzer::nalType(const uint8_t* nal) const {
+    return m_codec == AV_CODEC_ID_HEVC ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+}
+
+int BitstreamAnalyzer::categoryOf(int type) const {
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        if (type <= 31) return NalSlice;
+        if (type >= 32 && type <= 34) return NalParameterSet;
+        if (type == 39 || type == 40) return NalSei;
+        return NalOther;
+    }
+    if (type >= 1 && type <= 5) return NalSlice;
+    if (type == 7 || type == 8 || type == 13 || type == 15) return NalParameterSet;
+    if (type == 6) return NalSei;
+    return NalOther;
+}
+
+bool BitstreamAnalyzer::isFrameStart(const uint8_t* nal, const uint8_t* end, bool frameHasSlice) const {
+    int type = nalType(nal);
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        if (type == 35) return true;                    // AUD
+        if (!frameHasSlice) return false;
+        if (type >= 32 && type <= 34) return true;      // VPS/SPS/PPS
+        if (type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55)) return true;
+        // first_slice_segment_in_pic_flag
+        return type <= 31 && end - nal > 2 && (nal[2] & 0x80);
+    }
+    if (type == 9) return true;                         // AUD
+    if (!frameHasSlice) return false;
+    if ((type >= 6 && type <= 8) || (type >= 14 && type <= 18)) return true;
+    if (type >= 1 && type <= 5) {
+        BitReader r(nal + 1, end);
+        return r.ue() == 0;                             // first_mb_in_slice
+    }
+    return false;
+}
+
+void BitstreamAnalyzer::addExtradata(const uint8_t* data, int size) {
+    // 只处理 Annex-B 形式，avcC/hvcC 以版本号 1 开头
+    if (!data || size < 4 || data[0] == 1) return;
+    forEachNal(data, data + size, [this](const uint8_t* unit, const uint8_t* nal, const uint8_t* end) {
+        parseNal(nal, end, (int)(end - unit), nullptr);
+    });
+}
+
+void BitstreamAnalyzer::addPacket(const uint8_t* data, int size, int64_t pts) {
+    FrameStats frame;
+    frame.offset = m_totalBytes;
+    frame.pts = pts;
+    beginFrame();
+    forEachNal(data, data + size, [this, &frame](const uint8_t* unit, const uint8_t* nal, const uint8_t* end) {
+        parseNal(nal, end, (int)(end - unit), &frame);
+    });
+    finishFrame(&frame);
+    m_totalBytes += size;
+}
+
+bool BitstreamAnalyzer::analyzeFile(const QString& path, QString* error) {
+    QFile file(path);
+    uchar* data = NULL;
+    FrameStats frame;
+    bool open = false;
+    bool hasSlice = false;
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    if (file.size() == 0) {
+        *error = "File is empty";
+        return false;
+    }
+    data = file.map(0, file.size());
+    if (!data) {
+        *error = file.errorString();
+        return false;
+    }
+
+    const uint8_t* begin = data;
+    forEachNal(begin, begin + file.size(), [&](const uint8_t* unit, const uint8_t* nal, const uint8_t* end) {
+        if (open && isFrameStart(nal, end, hasSlice)) {
+            finishFrame(&frame);
+            open = false;
+        }
+        if (!open) {
+            frame = FrameStats();
+            frame.offset = m_totalBytes;
+            beginFrame();
+            open = true;
+            hasSlice = false;
+        }
+        int bytes = (int)(end - unit);
+        parseNal(nal, end, bytes, &frame);
+        m_totalBytes += bytes;
+        if (categoryOf(nalType(nal)) == NalSlice) hasSlice = true;
+    });
+    if (open) finishFrame(&frame);
+
+    file.unmap(data);
+    return true;
+}
+
+void BitstreamAnalyzer::parseNal(const uint8_t* nal, const uint8_t* end, int bytes, FrameStats* frame) {
+    if (end - nal < (m_codec == AV_CODEC_ID_HEVC ? 2 : 1)) {
+        if (frame) frame->categoryBytes[NalOther] += bytes;
+        return;
+    }
+    int type = nalType(nal);
+    bool slice = categoryOf(type) == NalSlice;
+
+    if (frame) {
+        frame->nalCount++;
+        frame->categoryBytes[categoryOf(type)] += bytes;
+        m_nalTypeCount[type]++;
+        m_nalTypeBytes[type] += bytes;
+        if (slice) frame->slices++;
+    }
+
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        if (type == 34) parseHevcPps(nal, end);
+        else if (slice && frame) {
+            if (type >= 16 && type <= 23) frame->keyframe = true;
+            parseHevcSlice(nal, end);
+        }
+    }
+    else {
+        if (type == 7) parseH264Sps(nal, end);
+        else if (type == 8) parseH264Pps(nal, end);
+        else if (slice && frame) {
+            if (type == 5) frame->keyframe = true;
+            parseH264Slice(nal, end);
+        }
+    }
+}
+
+void BitstreamAnalyzer::parseH264Sps(const uint8_t* nal, const uint8_t* end) {
+    BitReader r(nal + 1, end);
+    Sps sps;
+    int profile = r.bits(8);
+    r.skip(16);                                 // 约束标志和级别
+    uint32_t id = r.ue();
+    if (id >= 32) return;
+
+    if (isHighProfile(profile)) {
+        sps.chromaFormat = r.ue();
+        if (sps.chromaFormat == 3) sps.separateColourPlane = r.bit();
+        r.ue();                                 // bit_depth_luma_minus8
+        r.ue();                                 // bit_depth_chroma_minus8
+        r.bit();                                // qpprime_y_zero_transform_bypass_flag
+        if (r.bit()) {
+            for (int i = 0; i < (sps.chromaFormat != 3 ? 8 : 12); i++) {
+                if (r.bit()) skipScalingList(r, i < 6 ? 16 : 64);
+            }
+        }
+    }
+    sps.log2MaxFrameNum = r.ue() + 4;
+    sps.pocType = r.ue();
+    if (sps.pocType == 0) {
+        sps.log2MaxPocLsb = r.ue() + 4;
+    }
+    else if (sps.pocType == 1) {
+        sps.deltaPicOrderAlwaysZero = r.bit();
+        r.se();
+        r.se();
+        uint32_t cycle = r.ue();
+        if (cycle > 255) return;
+        for (uint32_t i = 0; i < cycle; i++) r.se();
+    }
+    r.ue();                                     // max_num_ref_frames
+    r.bit();                                    // gaps_in_frame_num_value_allowed_flag
+    r.ue();                                     // pic_width_in_mbs_minus1
+    r.ue();                                     // pic_height_in_map_units_minus1
+    sps.frameMbsOnly = r.bit();
+    sps.valid = r.ok();
+    m_sps[id] = sps;
+}
+
+void BitstreamAnalyzer::parseH264Pps(const uint8_t* nal, const uint8_t* end) {
+    BitReader r(nal + 1, end);
+    Pps pps;
+    uint32_t id = r.ue();
+    if (id >= 256) return;
+
+    pps.spsId = r.ue() & 31;
+    pps.cabac = r.bit();
+    pps.bottomFieldPicOrder = r.bit();
+    pps.sliceGroups = r.ue() > 0;
+    if (!pps.sliceGroups) {
+        pps.numRefIdx[0] = r.ue() + 1;
+        pps.numRefIdx[1] = r.ue() + 1;
+        pps.weightedPred = r.bit();
+        pps.weightedBipred = r.bits(2);
+        pps.picInitQp = 26 + r.se();
+        r.se();                                 // pic_init_qs_minus26
+        r.se();                                 // chroma_qp_index_offset
+        r.bit();                                // deblocking_filter_control_present_flag
+        r.bit();                                // constrained_intra_pred_flag
+        pps.redundantPicCnt = r.bit();
+    }
+    pps.valid = r.ok();
+    m_pps[id] = pps;
+}
+
+// 解析到 slice_qp_delta 为止。字段顺序见 H.264 7.3.3
+void BitstreamAnalyzer::parseH264Slice(const uint8_t* nal, const uint8_t* end) {
+    BitReader r(nal + 1, end);
+    const int refIdc = (nal[0] >> 5) & 3;
+    const bool idr = (nal[0] & 0x1f) == 5;
+    int numRefIdx[2] = { 0, 0 };
+
+    r.ue();                                     // first_mb_in_slice
+    int sliceType = r.ue() % 5;
+    const bool isP = sliceType == 0 || sliceType == 3;
+    const bool isB = sliceType == 1;
+    const bool isI = !isP && !isB;
+    addSliceType(isB ? 'B' : isP ? 'P' : 'I');
+
+    uint32_t ppsId = r.ue();
+    if (ppsId >= 256 || !m_pps[ppsId].valid || m_pps[ppsId].sliceGroups) return;
+    const Pps& pps = m_pps[ppsId];
+    const Sps& sps = m_sps[pps.spsId];
+    if (!sps.valid) return;
+
+    if (sps.separateColourPlane) r.skip(2);
+    r.skip(sps.log2MaxFrameNum);
+    bool field = false;
+    if (!sps.frameMbsOnly) {
+        field = r.bit();
+        if (field) r.bit();                     // bottom_field_flag
+    }
+    if (idr) r.ue();                            // idr_pic_id
+    if (sps.pocType == 0) {
+        r.skip(sps.log2MaxPocLsb);
+        if (pps.bottomFieldPicOrder && !field) r.se();
+    }
+    else if (sps.pocType == 1 && !sps.deltaPicOrderAlwaysZero) {
+        r.se();
+        if (pps.bottomFieldPicOrder && !field) r.se();
+    }
+    if (pps.redundantPicCnt) r.ue();
+    if (isB) r.bit();                           // direct_spatial_mv_pred_flag
+
+    numRefIdx[0] = pps.numRefIdx[0];
+    numRefIdx[1] = pps.numRefIdx[1];
+    if (!isI && r.bit()) {                      // num_ref_idx_active_override_flag
+        numRefIdx[0] = r.ue() + 1;
+        if (isB) numRefIdx[1] = r.ue() + 1;
+    }
+
+    // ref_pic_list_modification
+    for (int list = 0; list < (isB ? 2 : isI ? 0 : 1); list++) {
+        if (r.bit()) {
+            uint32_t idc = 0;
+            do {
+                idc = r.ue();
+                if (idc != 3) r.ue();
+            } while (idc != 3 && r.ok());
+        }
+    }
+
+    // pred_weight_table
+    if ((pps.weightedPred && isP) || (pps.weightedBipred == 1 && isB)) {
+        const bool chroma = !sps.separateColourPlane && sps.chromaFormat != 0;
+        r.ue();
+        if (chroma) r.ue();
+        for (int list = 0; list < (isB ? 2 : 1); list++) {
+            for (int i = 0; i < numRefIdx[list] && r.ok(); i++) {
+                if (r.bit()) {
+                    r.se();
+                    r.se();
+                }
+                if (chroma && r.bit()) {
+                    for (int j = 0; j < 4; j++) r.se();
+                }
+            }
+        }
+    }
+
+    // dec_ref_pic_marking
+    if (refIdc) {
+        if (idr) {
+            r.skip(2);
+        }
+        else if (r.bit()) {
+            uint32_t op = 0;
+            do {
+                op = r.ue();
+                if (op == 1 || op == 3) r.ue();
+                if (op == 2) r.ue();
+                if (op == 3 || op == 6) r.ue();
+                if (op == 4) r.ue();
+            } while (op != 0 && r.ok());
+        }
+    }
+    if (pps.cabac && !isI) r.ue();              // cabac_init_idc
+
+    int qp = pps.picInitQp + r.se();
+    if (r.ok() && qp >= 0 && qp <= 63) {
+        m_qpSum += qp;
+        m_qpCount++;
+    }
+}
+
+void BitstreamAnalyzer::parseHevcPps(const uint8_t* nal, const uint8_t* end) {
+    BitReader r(nal + 2, end);
+    Pps pps;
+    uint32_t id = r.ue();
+    if (id >= 64) return;
+
+    pps.spsId = r.ue() & 31;
+    pps.dependentSliceSegments = r.bit();
+    r.bit();                                    // output_flag_present_flag
+    pps.numExtraSliceHeaderBits = r.bits(3);
+    pps.valid = r.ok();
+    m_pps[id] = pps;
+}
+
+// 只从每帧第一个切片段取 slice_type；QP 要解析完整的 SPS 和参考帧集合才能拿到，不做
+void BitstreamAnalyzer::parseHevcSlice(const uint8_t* nal, const uint8_t* end) {
+    BitReader r(nal + 2, end);
+    int type = nalType(nal);
+    if (!r.bit()) return;                       // first_slice_segment_in_pic_flag
+    if (type >= 16 && type <= 23) r.bit();      // no_output_of_prior_pics_flag
+    uint32_t ppsId = r.ue();
+    if (ppsId >= 64 || !m_pps[ppsId].valid) return;
+
+    r.skip(m_pps[ppsId].numExtraSliceHeaderBits);
+    uint32_t sliceType = r.ue();
+    if (!r.ok()) return;
+    addSliceType(sliceType == 0 ? 'B' : sliceType == 1 ? 'P' : 'I');
+}
+
+void BitstreamAnalyzer::beginFrame() {
+    m_hasI = false;
+    m_hasP = false;
+    m_hasB = false;
+    m_qpSum = 0;
+    m_qpCount = 0;
+}
+
+void BitstreamAnalyzer::addSliceType(char type) {
+    if (type == 'B') m_hasB = true;
+    else if (type == 'P') m_hasP = true;
+    else m_hasI = true;
+}
+
+void BitstreamAnalyzer::finishFrame(FrameStats* frame) {
+    frame->type = m_hasB ? 'B' : m_hasP ? 'P' : m_hasI ? 'I' : '?';
+    frame->qp = m_qpCount > 0 ? (float)(m_qpSum / m_qpCount) : -1.0f;
+    frame->size = 0;
+    for (int i = 0; i < kNalCategories; i++) frame->size += frame->categoryBytes[i];
+    m_frames.push_back(*frame);
+}
+
+QString BitstreamAnalyzer::summary() const {
+    if (m_frames.empty()) return "no frames";
+
+    int64_t typeCount[3] = { 0 };
+    int64_t categoryBytes[kNalCategories] = { 0 };
+    double qpSum = 0;
+    int qpCount = 0;
+    size_t largest = 0;
+    for (size_t i = 0; i < m_frames.size(); i++) {
+        const FrameStats& frame = m_frames[i];
+        if (frame.type == 'I') typeCount[0]++;
+        else if (frame.type == 'P') typeCount[1]++;
+        else if (frame.type == 'B') typeCount[2]++;
+        for (int c = 0; c < kNalCategories; c++) categoryBytes[c] += frame.categoryBytes[c];
+        if (frame.qp >= 0) {
+            qpSum += frame.qp;
+            qpCount++;
+        }
+        if (frame.size > m_frames[largest].size) largest = i;
+    }
+
+    // 1 秒滑动窗口内的最大字节数，对比平均码率看尖峰
+    int window = std::max(1, (int)(m_frameRate + 0.5));
+    int64_t windowBytes = 0;
+    int64_t peakWindowBytes = 0;
+    for (size_t i = 0; i < m_frames.size(); i++) {
+        windowBytes += m_frames[i].size;
+        if (i >= (size_t)window) windowBytes -= m_frames[i - window].size;
+        peakWindowBytes = std::max(peakWindowBytes, windowBytes);
+    }
+    if ((int)m_frames.size() < window) peakWindowBytes = peakWindowBytes * window / (int64_t)m_frames.size();
+
+    const double frames = (double)m_frames.size();
+    const double avgKbps = m_totalBytes * 8.0 * m_frameRate / frames / 1000.0;
+    const double total = std::max<int64_t>(1, m_totalBytes);
+    QString text = QString("%1 frames (I %2, P %3, B %4), %5 bytes; avg %6 kbps, peak 1s %7 kbps; "
+        "largest frame #%8 (%9) %10 bytes = %11x avg")
+        .arg(m_frames.size()).arg(typeCount[0]).arg(typeCount[1]).arg(typeCount[2]).arg(m_totalBytes)
+        .arg(avgKbps, 0, 'f', 1).arg(peakWindowBytes * 8.0 / 1000.0, 0, 'f', 1)
+        .arg(largest).arg(QLatin1Char(m_frames[largest].type)).arg(m_frames[largest].size)
+        .arg(m_frames[largest].size / (m_totalBytes / frames), 0, 'f', 1);
+    text += QString("; NAL bytes: slice %1%, parameter sets %2%, SEI %3%, other %4%")
+        .arg(categoryBytes[NalSlice] * 100.0 / total, 0, 'f', 1)
+        .arg(categoryBytes[NalParameterSet] * 100.0 / total, 0, 'f', 1)
+        .arg(categoryBytes[NalSei] * 100.0 / total, 0, 'f', 1)
+        .arg(categoryBytes[NalOther] * 100.0 / total, 0, 'f', 1);
+    if (qpCount > 0) text += QString("; avg QP %1").arg(qpSum / qpCount, 0, 'f', 1);
+    return text;
+}
+
+bool BitstreamAnalyzer::writeReport(const QString& path, QString* error) const {
+    if (path.endsWith(".json", Qt::CaseInsensitive)) return writeJson(path, error);
+    return writeBinary(path, error);
+}
+
+bool BitstreamAnalyzer::writeJson(const QString& path, QString* error) const {
+    QJsonArray frames;
+    for (size_t i = 0; i < m_frames.size(); i++) {
+        const FrameStats& frame = m_frames[i];
+        QJsonObject entry;
+        entry["i"] = (qint64)i;
+        entry["pos"] = (qint64)frame.offset;
+        if (frame.pts >= 0) entry["pts"] = (qint64)frame.pts;
+        entry["size"] = frame.size;
+        entry["type"] = QString(QLatin1Char(frame.type));
+        entry["key"] = frame.keyframe;
+        if (frame.qp >= 0) entry["qp"] = qRound(frame.qp * 100) / 100.0;
+        entry["nals"] = frame.nalCount;
+        entry["slices"] = frame.slices;
+        entry["vcl"] = frame.categoryBytes[NalSlice];
+        entry["ps"] = frame.categoryBytes[NalParameterSet];
+        entry["sei"] = frame.categoryBytes[NalSei];
+        entry["other"] = frame.categoryBytes[NalOther];
+        frames.append(entry);
+    }
+
+    QJsonArray nalTypes;
+    for (int type = 0; type < 64; type++) {
+        if (m_nalTypeCount[type] == 0) continue;
+        QJsonObject entry;
+        entry["type"] = type;
+        entry["count"] = (qint64)m_nalTypeCount[type];
+        entry["bytes"] = (qint64)m_nalTypeBytes[type];
+        nalTypes.append(entry);
+    }
+
+    QJsonObject root;
+    root["codec"] = m_codec == AV_CODEC_ID_HEVC ? "hevc" : "h264";
+    root["frame_rate"] = m_frameRate;
+    root["bytes"] = (qint64)m_totalBytes;
+    root["summary"] = summary();
+    root["nal_types"] = nalTypes;
+    root["frames"] = frames;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = file.errorString();
+        return false;
+    }
+    // 每帧一个对象，紧凑格式
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+bool BitstreamAnalyzer::writeBinary(const QString& path, QString* error) const {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("DBSA", 4);
+    out << kReportVersion << (quint32)(m_codec == AV_CODEC_ID_HEVC ? 1 : 0) << (quint32)m_frames.size()
+        << (quint32)qRound(m_frameRate * 1000) << (quint64)m_totalBytes;
+    for (const FrameStats& frame : m_frames) {
+        out << (qint64)frame.offset << (quint32)frame.size
+            << (qint16)(frame.qp >= 0 ? qRound(frame.qp * 100) : -1)
+            << (quint8)frame.type << (quint8)(frame.keyframe ? 1 : 0)
+            << (quint16)std::min(frame.nalCount, 0xffff) << (quint16)std::min(frame.slices, 0xffff)
+            << (quint32)frame.categoryBytes[NalSlice] << (quint32)frame.categoryBytes[NalParameterSet]
+            << (quint32)frame.categoryBytes[NalSei];
+    }
+    if (out.status() != QDataStream::Ok) {
+        *error = "Write failed";
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
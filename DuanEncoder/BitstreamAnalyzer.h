@@ -0,0 +1,108 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// 编码输出（Annex-B H.264/HEVC）的逐帧统计：帧类型、大小、NAL 构成，以及 H.264 的切片 QP。
+// 只解析 NAL 头、参数集和切片头开头的字段，一次顺序扫描，码流不拷贝（离线时直接映射文件）。
+// 可以在编码循环里逐包调用，也可以事后分析文件，结果导出为 JSON 或紧凑二进制，用于查找码率尖峰
+class BitstreamAnalyzer {
+public:
+    enum NalCategory { NalSlice, NalParameterSet, NalSei, NalOther, kNalCategories };
+
+    struct FrameStats {
+        int64_t offset = 0;          // 在码流中的字节偏移
+        int64_t pts = -1;            // 在线分析时为编码器时间戳，离线为 -1
+        int size = 0;
+        char type = '?';             // I/P/B，按帧内最“弱”的切片
+        bool keyframe = false;       // IDR / IRAP
+        float qp = -1;               // 各切片 QP 的平均，无法解析时为 -1
+        int nalCount = 0;
+        int slices = 0;
+        int categoryBytes[kNalCategories] = { 0 };
+    };
+
+    explicit BitstreamAnalyzer(AVCodecID codec);
+
+    // 用于计算码率和 1 秒窗口峰值
+    void setFrameRate(double fps) { m_frameRate = fps; }
+    // 全局头（extradata）里的参数集，只用于解析切片头，不计入统计
+    void addExtradata(const uint8_t* data, int size);
+    // 在线：avcodec_receive_packet 得到的一个包即一帧
+    void addPacket(const uint8_t* data, int size, int64_t pts);
+    // 离线：映射整个文件，按访问单元边界切帧
+    bool analyzeFile(const QString& path, QString* error);
+
+    const std::vector<FrameStats>& frames() const { return m_frames; }
+    QString summary() const;
+    // 扩展名为 .json 时写 JSON，否则写二进制
+    bool writeReport(const QString& path, QString* error) const;
+    bool writeJson(const QString& path, QString* error) const;
+    // 28 字节头（"DBSA"、版本 u32（当前为 2）、编码器 u32、帧数 u32、帧率×1000 u32、总字节数 u64），之后每帧 32 字节，小端：
+    // 偏移 i64、大小 u32、QP×100 i16、类型 u8、标志 u8（bit0 关键帧）、NAL 数 u16、切片数 u16、
+    // 切片/参数集/SEI 字节 u32×3（其余字节为 大小 减去三者之和）
+    bool writeBinary(const QString& path, QString* error) const;
+
+private:
+    struct Sps {
+        bool valid = false;
+        bool separateColourPlane = false;
+        int chromaFormat = 1;
+        int log2MaxFrameNum = 4;
+        int pocType = 0;
+        int log2MaxPocLsb = 4;
+        bool deltaPicOrderAlwaysZero = false;
+        bool frameMbsOnly = true;
+    };
+
+    struct Pps {
+        bool valid = false;
+        int spsId = 0;
+        bool cabac = false;
+        bool bottomFieldPicOrder = false;
+        bool sliceGroups = false;        // FMO，不支持解析切片头
+        int numRefIdx[2] = { 1, 1 };
+        bool weightedPred = false;
+        int weightedBipred = 0;
+        int picInitQp = 26;
+        bool redundantPicCnt = false;
+        // HEVC 切片头用到的字段
+        bool dependentSliceSegments = false;
+        int numExtraSliceHeaderBits = 0;
+    };
+
+    int nalType(const uint8_t* nal) const;
+    int categoryOf(int type) const;
+    bool isFrameStart(const uint8_t* nal, const uint8_t* end, bool frameHasSlice) const;
+    // nal 指向 NAL 头，end 为 NAL 结尾（不含下一个起始码）；frame 为空时只更新参数集
+    void parseNal(const uint8_t* nal, const uint8_t* end, int bytes, FrameStats* frame);
+    void parseH264Sps(const uint8_t* nal, const uint8_t* end);
+    void parseH264Pps(const uint8_t* nal, const uint8_t* end);
+    void parseH264Slice(const uint8_t* nal, const uint8_t* end);
+    void parseHevcPps(const uint8_t* nal, const uint8_t* end);
+    void parseHevcSlice(const uint8_t* nal, const uint8_t* end);
+    void beginFrame();
+    void finishFrame(FrameStats* frame);
+    void addSliceType(char type);
+
+    AVCodecID m_codec;
+    double m_frameRate = 25.0;
+    Sps m_sps[32];
+    Pps m_pps[256];
+
+    std::vector<FrameStats> m_frames;
+    int64_t m_totalBytes = 0;
+    int64_t m_nalTypeCount[64] = { 0 };
+    int64_t m_nalTypeBytes[64] = { 0 };
+
+    // 当前帧的切片累计
+    bool m_hasI = false;
+    bool m_hasP = false;
+    bool m_hasB = false;
+    double m_qpSum = 0;
+    int m_qpCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,600 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "EncodePool.h"
+#include "EncodeWorker.h"
+#include "Tracer.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+}
+
+namespace {
+const int kFrameRate = 25;
+// 分段长度：尽量让每个工作进程分到两段以上便于均衡，上限与工作进程的 gop_size 一致。
+// 每段独立编码、以 IDR 开头，段长不到 gop_size 时关键帧比单进程编码多（100 帧分 4 段就是 4 个 IDR）
+const int kMinSegmentFrames = 25;
+const int kMaxSegmentFrames = 250;
+const int kWorkerGopSize = 250;
+// 同一段失败这么多次就放弃（多半是输入或参数问题，而不是偶发崩溃）
+const int kMaxJobAttempts = 3;
+// 每个工作进程最多启动次数（首次 + 重启）
+const int kMaxWorkerLaunches = 4;
+std::atomic<int> g_poolSerial{ 0 };
+}
+
+EncodePool::EncodePool(QObject* parent) : QThread(parent) {}
+
+EncodePool::~EncodePool() {
+    m_control.cancel();
+    wait();
+}
+
+void EncodePool::setParams(const QString& inputYuv, const QString& outputFile,
+    int width, int height, int bitRate, int frameNum, int codecType, int workers) {
+    m_inputYuv = inputYuv;
+    m_outputFile = outputFile;
+    m_width = width;
+    m_height = height;
+    m_bitRate = bitRate;
+    m_frameNum = frameNum;
+    m_codecType = codecType;
+    m_workerCount = std::max(1, workers);
+    m_control.reset();
+    m_cancelled = false;
+    m_outputFinalized = false;
+    m_success = false;
+    m_throughput = 0.0;
+    m_segmentLength = 0;
+    m_keyframeCount = 0;
+    m_metrics.reset(frameNum, kFrameRate);
+}
+
+void EncodePool::log(LogLevel level, const QString& text) {
+    LogSink::instance().write(level, "pool", text);
+}
+
+int EncodePool::autoSegmentFrames(int64_t totalFrames, int workers) {
+    int64_t frames = (totalFrames + workers * 2 - 1) / (workers * 2);
+    return (int)std::max<int64_t>(kMinSegmentFrames, std::min<int64_t>(kMaxSegmentFrames, frames));
+}
+
+void EncodePool::run() {
+    QFileInfo info(m_inputYuv);
+    const AVOutputFormat* ofmt = NULL;
+    QEventLoop loop;
+    QLocalServer server;
+    QTimer control_timer;
+    QString server_name;
+    int64_t available = 0;
+    int segment_frames = 0;
+    int worker_count = 0;
+
+    DUAN_TRACE_THREAD("encode_pool");
+    m_metrics.running.store(true, std::memory_order_relaxed);
+    m_loop = &loop;
+    m_server = &server;
+    m_workers.clear();
+    m_jobs.clear();
+    m_pending.clear();
+    m_jobsDone = 0;
+    m_restarts = 0;
+    m_finishing = false;
+    m_encodedFrames = 0;
+    m_progressPercent = -1;
+    m_encodeSeconds = 0.0;
+
+    // 帧数以文件实际大小为准
+    m_frameBytes = m_width * m_height * 3 / 2;
+    m_slotBytes = EncodeProtocol::slotBytes(m_width, m_height);
+    available = info.exists() ? info.size() / m_frameBytes : 0;
+    if (available <= 0) {
+        log(LogError, QString("Could not open input file '%1'").arg(m_inputYuv));
+        goto cleanup;
+    }
+    m_totalFrames = std::min<int64_t>(m_frameNum, available);
+    if (m_totalFrames < m_frameNum) {
+        log(LogWarning, QString("Warning: input only has %1 frames").arg(m_totalFrames));
+    }
+    m_metrics.totalFrames.store(m_totalFrames, std::memory_order_relaxed);
+
+    // 最终封装是否需要全局头决定了各工作进程编码器的设置
+    ofmt = av_guess_format(NULL, m_outputFile.toUtf8().constData(), NULL);
+    if (!ofmt) {
+        log(LogError, QString("Could not deduce the output format from '%1'").arg(m_outputFile));
+        goto cleanup;
+    }
+    m_globalHeader = (ofmt->flags & AVFMT_GLOBALHEADER) != 0;
+
+    // 切分任务
+    segment_frames = m_segmentFrames > 0 ? m_segmentFrames : autoSegmentFrames(m_totalFrames, m_workerCount);
+    m_segmentLength = segment_frames;
+    for (int64_t first = 0; first < m_totalFrames; first += segment_frames) {
+        Job job;
+        job.id = (int)m_jobs.size();
+        job.firstFrame = first;
+        job.frameCount = (int)std::min<int64_t>(segment_frames, m_totalFrames - first);
+        m_keyframeCount += (job.frameCount + kWorkerGopSize - 1) / kWorkerGopSize;
+        job.segmentPath = QString("%1.part%2.nut").arg(m_outputFile).arg(job.id);
+        m_jobs.push_back(job);
+        m_pending.push_back(job.id);
+    }
+
+    // 控制通道：本地套接字（Windows 为命名管道，其他平台为 Unix 域套接字）
+    server_name = QString("duan-encode-%1-%2").arg(QCoreApplication::applicationPid()).arg(++g_poolSerial);
+    QLocalServer::removeServer(server_name);
+    if (!server.listen(server_name)) {
+        log(LogError, QString("Could not listen on '%1': %2").arg(server_name).arg(server.errorString()));
+        goto cleanup;
+    }
+    connect(&server, &QLocalServer::newConnection, &server, [this] { onConnection(); });
+
+    worker_count = std::min(m_workerCount, (int)m_jobs.size());
+    log(LogInfo, QString("encode pool: %1 frames in %2 segments of up to %3 frames (%4 keyframes), %5 worker processes")
+        .arg(m_totalFrames).arg(m_jobs.size()).arg(segment_frames).arg(m_keyframeCount).arg(worker_count));
+    for (int i = 0; i < worker_count; i++) {
+        Worker* w = new Worker();
+        w->id = i;
+        m_workers.push_back(w);
+        if (!createWorker(w)) goto cleanup;
+    }
+
+    m_wallClock.start();
+    for (Worker* w : m_workers) {
+        launchWorker(w);
+    }
+
+    // 暂停/取消由界面线程改原子状态，这里定时检查
+    connect(&control_timer, &QTimer::timeout, &server, [this] {
+        if (m_finishing) return;
+        if (m_control.isCancelled()) {
+            m_cancelled = true;
+            log(LogWarning, QString("Cancel requested after %1 frames").arg(m_encodedFrames));
+            finish(false);
+            return;
+        }
+        feedAll();
+    });
+    control_timer.start(50);
+
+    loop.exec();
+
+cleanup:
+    control_timer.stop();
+    for (Worker* w : m_workers) {
+        if (w->process) {
+            w->process->kill();
+            w->process->waitForFinished(1000);
+            delete w->process;
+        }
+        delete w->socket;
+        if (w->shm) {
+            w->shm->detach();
+            delete w->shm;
+        }
+        delete w->input;
+        delete w;
+    }
+    m_workers.clear();
+    server.close();
+    m_server = nullptr;
+    m_loop = nullptr;
+
+    m_metrics.running.store(false, std::memory_order_relaxed);
+    emit encodeFinished(m_success);
+}
+
+bool EncodePool::createWorker(Worker* w) {
+    // 帧环由主进程创建并持有，工作进程崩溃重启后重新挂接同一块
+    w->shm = new QSharedMemory(QString("%1-ring%2").arg(m_server->serverName()).arg(w->id));
+    if (!w->shm->create(EncodeProtocol::kRingSlots * m_slotBytes)) {
+        log(LogError, QString("Could not create the frame ring for worker %1: %2").arg(w->id).arg(w->shm->errorString()));
+        return false;
+    }
+    w->input = new QFile(m_inputYuv);
+    if (!w->input->open(QIODevice::ReadOnly)) {
+        log(LogError, QString("Could not open input file '%1'").arg(m_inputYuv));
+        return false;
+    }
+    return true;
+}
+
+void EncodePool::launchWorker(Worker* w) {
+    QStringList args;
+    args << "--encode-worker" << m_server->fullServerName() << "--worker-id" << QString::number(w->id);
+    if (m_injectCrashAfter > 0 && w->id == 0 && w->generation == 0) {
+        args << "--worker-crash-after" << QString::number(m_injectCrashAfter);
+    }
+
+    w->generation++;
+    w->alive = true;
+    w->job = -1;
+    w->freeSlots.clear();
+    for (int i = EncodeProtocol::kRingSlots - 1; i >= 0; i--) {
+        w->freeSlots.push_back(i);
+    }
+
+    w->process = new QProcess();
+    // 工作进程里 FFmpeg 的输出直接转到本进程的控制台
+    w->process->setProcessChannelMode(QProcess::ForwardedChannels);
+    connect(w->process, &QProcess::finished, w->process, [this, w](int code, QProcess::ExitStatus status) {
+        onWorkerExit(w, status == QProcess::CrashExit ? QString("crashed") : QString("exited with code %1").arg(code));
+    });
+    connect(w->process, &QProcess::errorOccurred, w->process, [this, w](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onWorkerExit(w, "failed to start");
+        }
+    });
+    w->process->start(QCoreApplication::applicationFilePath(), args);
+}
+
+void EncodePool::onConnection() {
+    while (QLocalSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, socket, [this, socket] {
+            while (socket->canReadLine()) {
+                QByteArray line = socket->readLine().trimmed();
+                Worker* owner = nullptr;
+                for (Worker* w : m_workers) {
+                    if (w->socket == socket) owner = w;
+                }
+                if (owner) {
+                    onWorkerLine(owner, line);
+                    if (m_finishing) return;
+                    continue;
+                }
+
+                // 连接后的第一行 HELLO 说明是哪个工作进程
+                int id = line.startsWith("HELLO ") ? line.mid(6).toInt() : -1;
+                if (id < 0 || id >= (int)m_workers.size() || m_workers[id]->socket || !m_workers[id]->alive) {
+                    socket->abort();
+                    return;
+                }
+                owner = m_workers[id];
+                owner->socket = socket;
+                QString config = QString("CONFIG %1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                    .arg(m_width).arg(m_height).arg(m_bitRate).arg(m_codecType).arg(kFrameRate)
+                    .arg(m_globalHeader ? 1 : 0).arg(EncodeProtocol::kRingSlots).arg(m_slotBytes).arg(owner->shm->key());
+                socket->write(config.toUtf8());
+                assignJob(owner);
+            }
+        });
+    }
+}
+
+void EncodePool::onWorkerLine(Worker* w, const QByteArray& line) {
+    QList<QByteArray> args = line.split(' ');
+    const QByteArray& cmd = args[0];
+
+    if (cmd == "FREE" && args.size() >= 2) {
+        int slot = args[1].toInt();
+        if (slot >= 0 && slot < EncodeProtocol::kRingSlots) {
+            w->freeSlots.push_back(slot);
+        }
+        feedWorker(w);
+    }
+    else if (cmd == "PKT" && args.size() >= 2) {
+        int size = args[1].toInt();
+        m_metrics.addPacket(size);
+        if (w->job >= 0) {
+            m_jobs[w->job].packets++;
+            m_jobs[w->job].bytes += size;
+        }
+        m_encodedFrames++;
+        if (LogSink::instance().accepts(LogDebug)) {
+            log(LogDebug, QString("worker %1: encoded frame %2 size:%3").arg(w->id).arg(m_encodedFrames).arg(size));
+        }
+        reportProgress();
+    }
+    else if (cmd == "DONE" && args.size() >= 4) {
+        if (w->job < 0 || m_jobs[w->job].id != args[1].toInt()) return;
+        Job& job = m_jobs[w->job];
+        job.done = true;
+        m_jobsDone++;
+        w->frames += args[2].toLongLong();
+        w->cpuMs += args[3].toLongLong();
+        m_metrics.cpuNs.fetch_add(args[3].toLongLong() * 1000000, std::memory_order_relaxed);
+        log(LogDebug, QString("segment %1 (frames %2-%3) done by worker %4")
+            .arg(job.id).arg(job.firstFrame).arg(job.firstFrame + job.frameCount - 1).arg(w->id));
+        w->job = -1;
+
+        if (m_jobsDone == (int)m_jobs.size()) {
+            finish(true);
+            return;
+        }
+        assignJob(w);
+    }
+    else if (cmd == "FAIL" && args.size() >= 2) {
+        QString reason = QString::fromUtf8(line.mid(line.indexOf(' ', 5) + 1));
+        log(LogWarning, QString("encode worker %1: %2").arg(w->id).arg(reason));
+        // FAIL -1 是配置被拒绝，工作进程随后退出，由退出处理重排任务
+        if (w->job < 0 || m_jobs[w->job].id != args[1].toInt()) return;
+        requeueJob(w, reason);
+        if (!m_finishing) {
+            assignJob(w);
+        }
+    }
+}
+
+void EncodePool::onWorkerExit(Worker* w, const QString& reason) {
+    if (!w->alive) return;
+    w->alive = false;
+    if (w->socket) {
+        w->socket->abort();
+        w->socket->deleteLater();
+        w->socket = nullptr;
+    }
+    if (w->process) {
+        w->process->deleteLater();
+        w->process = nullptr;
+    }
+    if (m_finishing) return;
+
+    log(LogWarning, QString("encode worker %1 %2").arg(w->id).arg(reason));
+    if (w->job >= 0) {
+        requeueJob(w, reason);
+        if (m_finishing) return;
+    }
+
+    if (w->generation < kMaxWorkerLaunches) {
+        m_restarts++;
+        log(LogInfo, QString("restarting encode worker %1 (launch %2 of %3)").arg(w->id).arg(w->generation + 1).arg(kMaxWorkerLaunches));
+        launchWorker(w);
+        return;
+    }
+
+    log(LogWarning, QString("encode worker %1 was restarted too often, retiring it").arg(w->id));
+    bool any_alive = false;
+    for (Worker* other : m_workers) {
+        any_alive = any_alive || other->alive;
+    }
+    if (!any_alive) {
+        log(LogError, "No encode workers left");
+        finish(false);
+    }
+}
+
+void EncodePool::requeueJob(Worker* w, const QString& reason) {
+    Job& job = m_jobs[w->job];
+    w->job = -1;
+
+    // 这一段已上报的进度作废，分段文件从头再写
+    m_encodedFrames -= job.packets;
+    m_metrics.frames.fetch_sub(job.packets, std::memory_order_relaxed);
+    m_metrics.bytes.fetch_sub(job.bytes, std::memory_order_relaxed);
+    job.packets = 0;
+    job.bytes = 0;
+    QFile::remove(job.segmentPath);
+    reportProgress();
+
+    job.attempts++;
+    if (job.attempts >= kMaxJobAttempts) {
+        log(LogError, QString("segment %1 (frames %2-%3) failed %4 times: %5")
+            .arg(job.id).arg(job.firstFrame).arg(job.firstFrame + job.frameCount - 1).arg(job.attempts).arg(reason));
+        finish(false);
+        return;
+    }
+    log(LogWarning, QString("re-queued segment %1 (frames %2-%3), attempt %4")
+        .arg(job.id).arg(job.firstFrame).arg(job.firstFrame + job.frameCount - 1).arg(job.attempts + 1));
+    m_pending.push_front(job.id);
+
+    // 其他已空闲的工作进程可以马上接手
+    for (Worker* other : m_workers) {
+        if (other != w) assignJob(other);
+    }
+}
+
+void EncodePool::assignJob(Worker* w) {
+    if (m_finishing || !w->alive || !w->socket || w->job >= 0 || m_pending.empty()) return;
+
+    Job& job = m_jobs[m_pending.front()];
+    m_pending.pop_front();
+    w->job = job.id;
+    w->nextFrame = job.firstFrame;
+    QFile::remove(job.segmentPath);
+    w->socket->write(QString("JOB %1 %2 %3 %4\n").arg(job.id).arg(job.firstFrame).arg(job.frameCount)
+        .arg(job.segmentPath).toUtf8());
+    feedWorker(w);
+}
+
+void EncodePool::feedWorker(Worker* w) {
+    if (m_finishing || !w->socket || w->job < 0 || m_control.state() != JobControl::Running) return;
+
+    const Job& job = m_jobs[w->job];
+    int64_t end = job.firstFrame + job.frameCount;
+    uint8_t* ring = (uint8_t*)w->shm->data();
+    while (w->nextFrame < end && !w->freeSlots.empty()) {
+        int slot = w->freeSlots.back();
+        qint64 offset = w->nextFrame * m_frameBytes;
+        // 直接读进共享内存槽，工作进程原地编码，整条路径上没有额外拷贝
+        qint64 read_size = -1;
+        {
+            DUAN_TRACE_SCOPE("read");
+            if (w->input->pos() == offset || w->input->seek(offset)) {
+                read_size = w->input->read((char*)ring + (size_t)slot * m_slotBytes, m_frameBytes);
+            }
+        }
+        if (read_size != m_frameBytes) {
+            log(LogError, QString("Could not read frame %1 from the input").arg(w->nextFrame));
+            finish(false);
+            return;
+        }
+        w->freeSlots.pop_back();
+        w->socket->write(QString("FRAME %1 %2\n").arg(slot).arg(w->nextFrame).toUtf8());
+        w->nextFrame++;
+    }
+    w->socket->flush();
+}
+
+void EncodePool::feedAll() {
+    for (Worker* w : m_workers) {
+        feedWorker(w);
+    }
+}
+
+void EncodePool::finish(bool success) {
+    if (m_finishing) return;
+    m_finishing = true;
+    m_encodeSeconds = m_wallClock.elapsed() / 1000.0;
+
+    // 先让工作进程全部退出，分段文件才能安全读取和删除
+    for (Worker* w : m_workers) {
+        if (w->socket) {
+            w->socket->write("QUIT\n");
+            w->socket->flush();
+        }
+    }
+    for (Worker* w : m_workers) {
+        QProcess* process = w->process;
+        if (process && !process->waitForFinished(3000)) {
+            process->kill();
+            process->waitForFinished(1000);
+        }
+    }
+
+    // 取消时只合并开头连续完成的几段，输出仍是一个完整可播放的文件
+    int merge_count = 0;
+    if (success) {
+        merge_count = (int)m_jobs.size();
+    }
+    else if (m_cancelled) {
+        while (merge_count < (int)m_jobs.size() && m_jobs[merge_count].done) merge_count++;
+    }
+    int64_t merged_frames = 0;
+    for (int i = 0; i < merge_count; i++) {
+        merged_frames += m_jobs[i].frameCount;
+    }
+    if (merge_count > 0 && !mergeSegments(merge_count)) {
+        success = false;
+        merge_count = 0;
+        merged_frames = 0;
+    }
+    m_outputFinalized = merge_count > 0;
+    removeSegments();
+
+    if (success) {
+        reportThroughput();
+        log(LogInfo, "Encoding completed successfully!");
+    }
+    else if (m_cancelled && m_outputFinalized) {
+        log(LogWarning, QString("Encoding cancelled: %1 frames in %2 complete segments saved, finished %3 ms after the request")
+            .arg(merged_frames).arg(merge_count).arg(m_control.msSinceCancel(), 0, 'f', 1));
+    }
+    else if (m_cancelled) {
+        log(LogWarning, QString("Encoding cancelled before any segment was complete: no output written, finished %1 ms after the request")
+            .arg(m_control.msSinceCancel(), 0, 'f', 1));
+    }
+    m_success = success;
+    m_loop->quit();
+}
+
+bool EncodePool::mergeSegments(int jobCount) {
+    AVFormatContext* out_ctx = NULL;
+    AVFormatContext* in_ctx = NULL;
+    AVStream* out_stream = NULL;
+    AVPacket* pkt = NULL;
+    int64_t last_dts = AV_NOPTS_VALUE;
+    bool ok = false;
+    int ret = 0;
+
+    DUAN_TRACE_SCOPE("merge");
+    QElapsedTimer timer;
+    timer.start();
+
+    ret = avformat_alloc_output_context2(&out_ctx, NULL, NULL, m_outputFile.toUtf8().constData());
+    if (ret < 0) goto cleanup;
+    pkt = av_packet_alloc();
+    if (!pkt) goto cleanup;
+
+    for (int i = 0; i < jobCount; i++) {
+        ret = avformat_open_input(&in_ctx, m_jobs[i].segmentPath.toUtf8().constData(), NULL, NULL);
+        if (ret < 0 || in_ctx->nb_streams < 1) goto cleanup;
+        AVStream* in_stream = in_ctx->streams[0];
+
+        if (!out_stream) {
+            // 各段编码参数相同，输出流参数取第一段
+            out_stream = avformat_new_stream(out_ctx, NULL);
+            if (!out_stream) goto cleanup;
+            ret = avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar);
+            if (ret < 0) goto cleanup;
+            out_stream->codecpar->codec_tag = 0;
+            out_stream->time_base = in_stream->time_base;
+            if (!(out_ctx->oformat->flags & AVFMT_NOFILE)) {
+                ret = avio_open(&out_ctx->pb, m_outputFile.toUtf8().constData(), AVIO_FLAG_WRITE);
+                if (ret < 0) goto cleanup;
+            }
+            ret = avformat_write_header(out_ctx, NULL);
+            if (ret < 0) goto cleanup;
+        }
+
+        // 各段时间戳就是全局帧号，直接换算到输出时间基
+        while ((ret = av_read_frame(in_ctx, pkt)) >= 0) {
+            av_packet_rescale_ts(pkt, in_stream->time_base, out_stream->time_base);
+            // 段与段交界处 DTS 必须单调递增
+            if (pkt->dts != AV_NOPTS_VALUE && last_dts != AV_NOPTS_VALUE && pkt->dts <= last_dts) {
+                pkt->dts = last_dts + 1;
+                if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts) pkt->pts = pkt->dts;
+            }
+            if (pkt->dts != AV_NOPTS_VALUE) last_dts = pkt->dts;
+            pkt->stream_index = out_stream->index;
+            pkt->pos = -1;
+            ret = av_interleaved_write_frame(out_ctx, pkt);
+            if (ret < 0) goto cleanup;
+        }
+        avformat_close_input(&in_ctx);
+    }
+
+    ret = av_write_trailer(out_ctx);
+    if (ret < 0) goto cleanup;
+    ok = true;
+    log(LogInfo, QString("merged %1 segments into '%2' in %3 ms").arg(jobCount).arg(m_outputFile).arg(timer.elapsed()));
+
+cleanup:
+    if (!ok) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+        av_strerror(ret, err_buf, sizeof(err_buf));
+        log(LogError, QString("Could not merge the encoded segments: %1").arg(err_buf));
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&in_ctx);
+    if (out_ctx) {
+        if (!(out_ctx->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&out_ctx->pb);
+        }
+        avformat_free_context(out_ctx);
+    }
+    return ok;
+}
+
+void EncodePool::removeSegments() {
+    for (const Job& job : m_jobs) {
+        QFile::remove(job.segmentPath);
+    }
+}
+
+void EncodePool::reportProgress() {
+    int percent = m_totalFrames > 0 ? (int)(m_encodedFrames * 100 / m_totalFrames) : 0;
+    if (percent == m_progressPercent) return;
+    m_progressPercent = percent;
+    emit encodeProgress((int)m_encodedFrames, (int)m_totalFrames);
+}
+
+void EncodePool::reportThroughput() {
+    m_throughput = m_encodeSeconds > 0 ? m_totalFrames / m_encodeSeconds : 0.0;
+    log(LogInfo, QString("%1 workers: %2 frames in %3 s, %4 fps (%5 fps per worker), %6 segments, %7 restarts")
+        .arg(m_workers.size()).arg(m_totalFrames).arg(m_encodeSeconds, 0, 'f', 2)
+        .arg(m_throughput, 0, 'f', 1).arg(m_throughput / std::max<size_t>(1, m_workers.size()), 0, 'f', 1)
+        .arg(m_jobs.size()).arg(m_restarts));
+    for (Worker* w : m_workers) {
+        log(LogInfo, QString("  worker %1: %2 frames, %3 s CPU").arg(w->id).arg(w->frames).arg(w->cpuMs / 1000.0, 0, 'f', 2));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+#include <QThread>
+#include <QString>
+#include <QObject>
+#include <QElapsedTimer>
+#include <deque>
+#include <vector>
+#include "JobControl.h"
+#include "Metrics.h"
+#include "LogSink.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class QFile;
+class QLocalServer;
+class QLocalSocket;
+class QProcess;
+class QSharedMemory;
+class QEventLoop;
+
+// 多进程编码：把输入按帧切成若干段，分给本机的编码工作进程（同一个可执行文件 --encode-worker），
+// 最后按顺序合并成输出文件。编码器崩溃只会带走工作进程，主进程重启它并把未完成的段重新排队。
+// 接口与 EncoderThread 一致，界面按“工作进程数”选择用哪一个
+class EncodePool : public QThread {
+    Q_OBJECT
+public:
+    explicit EncodePool(QObject* parent = nullptr);
+    ~EncodePool() override;
+
+    void setParams(const QString& inputYuv, const QString& outputFile,
+        int width, int height, int bitRate, int frameNum,
+        int codecType = AV_CODEC_ID_H264, int workers = 2);
+    // 测试用：第一个工作进程编码到第 N 帧时主动崩溃
+    void setInjectedCrash(int frames) { m_injectCrashAfter = frames; }
+    // 分段长度（帧），0 为按工作进程数自动选择。每段以 IDR 开头，比较不同进程数的吞吐时要固定段长，
+    // 关键帧数才一致
+    void setSegmentFrames(int frames) { m_segmentFrames = frames; }
+    static int autoSegmentFrames(int64_t totalFrames, int workers);
+
+    // 暂停只是不再送帧；取消后已完成的开头连续几段仍会合并成可播放的文件
+    void pauseEncoding() { m_control.pause(); }
+    void resumeEncoding() { m_control.resume(); }
+    void cancelEncoding() { m_control.cancel(); }
+    bool isPaused() const { return m_control.isPaused(); }
+    bool wasCancelled() const { return m_cancelled; }
+    // 输出文件已合并写完；取消时一段都没完成或合并失败为 false
+    bool outputFinalized() const { return m_outputFinalized; }
+    bool succeeded() const { return m_success; }
+    const EncodeMetrics& metrics() const { return m_metrics; }
+    // 上一次运行的吞吐（帧/秒，按墙钟时间），用于比较不同工作进程数
+    double throughput() const { return m_throughput; }
+    // 上一次运行实际使用的段长和输出的关键帧数（每段一个 IDR，段内每 gop_size 帧再一个）
+    int segmentLength() const { return m_segmentLength; }
+    int keyframeCount() const { return m_keyframeCount; }
+
+protected:
+    void run() override;
+
+signals:
+    void encodeProgress(int current, int total);
+    void encodeFinished(bool success);
+
+private:
+    // 一段连续的帧，由一个工作进程独立编码成一个分段文件
+    struct Job {
+        int id = 0;
+        int64_t firstFrame = 0;
+        int frameCount = 0;
+        QString segmentPath;
+        int attempts = 0;
+        bool done = false;
+        int64_t packets = 0;          // 本次尝试已收到的包，重排时从进度中扣除
+        int64_t bytes = 0;
+    };
+
+    struct Worker {
+        int id = 0;
+        QProcess* process = nullptr;
+        QLocalSocket* socket = nullptr;
+        QSharedMemory* shm = nullptr;  // 主进程 -> 工作进程的帧环，重启后沿用
+        QFile* input = nullptr;        // 每个工作进程各自的读位置
+        std::vector<int> freeSlots;
+        int job = -1;                  // 当前任务下标，-1 表示空闲
+        int64_t nextFrame = 0;         // 下一帧要送的全局帧号
+        int generation = 0;            // 已启动次数，超过上限不再重启
+        bool alive = false;
+        int64_t frames = 0;
+        int64_t cpuMs = 0;
+    };
+
+    void log(LogLevel level, const QString& text);
+    bool createWorker(Worker* w);
+    void launchWorker(Worker* w);
+    void onConnection();
+    void onWorkerLine(Worker* w, const QByteArray& line);
+    void onWorkerExit(Worker* w, const QString& reason);
+    void assignJob(Worker* w);
+    void feedWorker(Worker* w);
+    void feedAll();
+    void requeueJob(Worker* w, const QString& reason);
+    void finish(bool success);
+    bool mergeSegments(int jobCount);
+    void removeSegments();
+    void reportThroughput();
+    // 百分比变化时才发 encodeProgress，逐包发会把界面的事件队列灌满
+    void reportProgress();
+
+    QString m_inputYuv;
+    QString m_outputFile;
+    int m_width = 480;
+    int m_height = 272;
+    int m_bitRate = 400000;
+    int m_frameNum = 100;
+    int m_codecType = AV_CODEC_ID_H264;
+    int m_workerCount = 2;
+    int m_injectCrashAfter = 0;
+    int m_segmentFrames = 0;
+
+    JobControl m_control;
+    EncodeMetrics m_metrics;
+    bool m_cancelled = false;
+    bool m_outputFinalized = false;
+    bool m_success = false;
+    double m_throughput = 0.0;
+    int m_segmentLength = 0;
+    int m_keyframeCount = 0;
+
+    // 以下只在 run() 所在线程使用
+    QEventLoop* m_loop = nullptr;
+    QLocalServer* m_server = nullptr;
+    std::vector<Worker*> m_workers;
+    std::vector<Job> m_jobs;
+    std::deque<int> m_pending;
+    int m_jobsDone = 0;
+    int m_restarts = 0;
+    int m_frameBytes = 0;
+    int m_slotBytes = 0;
+    bool m_globalHeader = false;
+    bool m_finishing = false;
+    int64_t m_encodedFrames = 0;
+    int64_t m_totalFrames = 0;
+    int m_progressPercent = -1;
+    double m_encodeSeconds = 0.0;     // 从启动到最后一段完成，不含合并
+    QElapsedTimer m_wallClock;
+};
\ No newline at end of file
@@ -0,0 +1,300 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "EncodeWorker.h"
+#include "Metrics.h"
+#include <QMutexLocker>
+#include <cstdio>
+#include <cstdlib>
+
+EncodeWorker::EncodeWorker(const QString& serverName, int workerId, int crashAfter)
+    : m_serverName(serverName), m_workerId(workerId), m_crashAfter(crashAfter) {}
+
+EncodeWorker::~EncodeWorker() {
+    closeJob();
+    if (m_shm.isAttached()) {
+        m_shm.detach();
+    }
+}
+
+void EncodeWorker::sendLine(const QByteArray& line) {
+    m_socket.write(line);
+    m_socket.write("\n");
+}
+
+void EncodeWorker::releaseSlot(void* opaque, uint8_t* data) {
+    EncodeWorker* worker = (EncodeWorker*)opaque;
+    int slot = (int)((data - worker->m_ring) / worker->m_slotBytes);
+    // 编码器内部线程也可能释放帧，只记录，由主循环统一回复
+    QMutexLocker locker(&worker->m_freedMutex);
+    worker->m_freedSlots.push_back(slot);
+}
+
+void EncodeWorker::sendFreedSlots() {
+    std::vector<int> freed;
+    {
+        QMutexLocker locker(&m_freedMutex);
+        freed.swap(m_freedSlots);
+    }
+    for (int slot : freed) {
+        sendLine("FREE " + QByteArray::number(slot));
+    }
+}
+
+int EncodeWorker::run() {
+    m_socket.connectToServer(m_serverName);
+    if (!m_socket.waitForConnected(5000)) {
+        fprintf(stderr, "encode worker %d: unable to connect to '%s': %s\n", m_workerId,
+            m_serverName.toLocal8Bit().constData(), m_socket.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+    sendLine("HELLO " + QByteArray::number(m_workerId));
+    m_socket.flush();
+
+    bool quit = false;
+    while (!quit && m_socket.state() == QLocalSocket::ConnectedState) {
+        if (!m_socket.canReadLine()) {
+            m_socket.waitForReadyRead(100);
+        }
+        while (m_socket.canReadLine()) {
+            QByteArray line = m_socket.readLine().trimmed();
+            if (line.isEmpty()) continue;
+            if (!handleLine(line)) {
+                quit = true;
+                break;
+            }
+        }
+        sendFreedSlots();
+        m_socket.flush();
+    }
+
+    // 主进程已关闭连接：丢弃未完成的任务，由主进程重新分配
+    closeJob();
+    m_socket.disconnectFromServer();
+    return 0;
+}
+
+bool EncodeWorker::handleLine(const QByteArray& line) {
+    QList<QByteArray> args = line.split(' ');
+    const QByteArray& cmd = args[0];
+
+    if (cmd == "FRAME" && args.size() >= 3) {
+        if (!encodeFrame(args[1].toInt(), args[2].toLongLong())) {
+            failJob("encoding failed");
+        }
+        return true;
+    }
+    if (cmd == "JOB" && args.size() >= 5) {
+        // 路径可能含空格，取第四个空格之后的全部内容
+        int pos = 0;
+        for (int i = 0; i < 4; i++) pos = line.indexOf(' ', pos) + 1;
+        QString path = QString::fromUtf8(line.mid(pos));
+        if (!startJob(args[1].toInt(), args[2].toLongLong(), args[3].toInt(), path)) {
+            failJob("unable to start the segment");
+        }
+        return true;
+    }
+    if (cmd == "CONFIG") {
+        if (!configure(args)) {
+            sendLine("FAIL -1 configuration rejected");
+            return false;
+        }
+        return true;
+    }
+    if (cmd == "QUIT") {
+        return false;
+    }
+    fprintf(stderr, "encode worker %d: unknown message '%s'\n", m_workerId, line.constData());
+    return true;
+}
+
+bool EncodeWorker::configure(const QList<QByteArray>& args) {
+    if (args.size() < 10) return false;
+    m_width = args[1].toInt();
+    m_height = args[2].toInt();
+    m_bitRate = args[3].toInt();
+    m_codecId = args[4].toInt();
+    m_frameRate = args[5].toInt();
+    m_globalHeader = args[6].toInt() != 0;
+    m_slotCount = args[7].toInt();
+    m_slotBytes = args[8].toInt();
+
+    if (m_shm.isAttached()) {
+        m_shm.detach();
+    }
+    m_shm.setKey(QString::fromUtf8(args[9]));
+    if (!m_shm.attach(QSharedMemory::ReadOnly)) {
+        fprintf(stderr, "encode worker %d: unable to attach the frame ring: %s\n", m_workerId,
+            m_shm.errorString().toLocal8Bit().constData());
+        return false;
+    }
+    if (m_shm.size() < (qsizetype)m_slotCount * m_slotBytes || m_slotBytes < EncodeProtocol::slotBytes(m_width, m_height)) {
+        fprintf(stderr, "encode worker %d: frame ring is too small\n", m_workerId);
+        return false;
+    }
+    m_ring = (uint8_t*)m_shm.constData();
+    return true;
+}
+
+bool EncodeWorker::startJob(int jobId, int64_t firstFrame, int frameCount, const QString& segmentPath) {
+    const AVCodec* codec = NULL;
+    int ret = 0;
+
+    closeJob();
+    m_jobId = jobId;
+    m_jobFrames = frameCount;
+    m_framesReceived = 0;
+    m_jobCpuStart = currentProcessCpuNs();
+
+    // 分段用 NUT 封装，保留编码器时间戳，合并时直接按帧号排好
+    ret = avformat_alloc_output_context2(&m_fmtCtx, NULL, "nut", segmentPath.toUtf8().constData());
+    if (ret < 0) goto fail;
+
+    codec = avcodec_find_encoder((AVCodecID)m_codecId);
+    if (!codec) goto fail;
+
+    m_stream = avformat_new_stream(m_fmtCtx, NULL);
+    m_codecCtx = avcodec_alloc_context3(codec);
+    m_frame = av_frame_alloc();
+    m_pkt = av_packet_alloc();
+    if (!m_stream || !m_codecCtx || !m_frame || !m_pkt) goto fail;
+
+    // 与 EncoderThread 相同的参数；每段以 IDR 开头，段长不到 gop_size 时分段边界处多出关键帧
+    m_codecCtx->codec_id = (AVCodecID)m_codecId;
+    m_codecCtx->codec_type = AVMEDIA_TYPE_VIDEO;
+    m_codecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+    m_codecCtx->width = m_width;
+    m_codecCtx->height = m_height;
+    m_codecCtx->bit_rate = m_bitRate;
+    m_codecCtx->gop_size = 250;
+    m_codecCtx->time_base.num = 1;
+    m_codecCtx->time_base.den = m_frameRate;
+    m_codecCtx->framerate.num = m_frameRate;
+    m_codecCtx->framerate.den = 1;
+    // 是否用全局头取决于最终输出的封装，而不是中间的 NUT 分段
+    if (m_globalHeader) {
+        m_codecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    if (m_codecId == AV_CODEC_ID_H264) {
+        av_opt_set(m_codecCtx->priv_data, "preset", "slow", 0);
+        av_opt_set(m_codecCtx->priv_data, "tune", "zerolatency", 0);
+    }
+    else if (m_codecId == AV_CODEC_ID_HEVC) {
+        av_opt_set(m_codecCtx->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(m_codecCtx->priv_data, "tune", "zero-latency", 0);
+    }
+
+    ret = avcodec_open2(m_codecCtx, codec, NULL);
+    if (ret < 0) goto fail;
+    ret = avcodec_parameters_from_context(m_stream->codecpar, m_codecCtx);
+    if (ret < 0) goto fail;
+    m_stream->time_base = m_codecCtx->time_base;
+
+    ret = avio_open(&m_fmtCtx->pb, segmentPath.toUtf8().constData(), AVIO_FLAG_WRITE);
+    if (ret < 0) goto fail;
+    ret = avformat_write_header(m_fmtCtx, NULL);
+    if (ret < 0) goto fail;
+
+    return true;
+
+fail:
+    if (ret < 0) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+        av_strerror(ret, err_buf, sizeof(err_buf));
+        fprintf(stderr, "encode worker %d: job %d (from frame %lld): %s\n", m_workerId, jobId, (long long)firstFrame, err_buf);
+    }
+    return false;
+}
+
+bool EncodeWorker::encodeFrame(int slot, int64_t frameIndex) {
+    int ret = 0;
+    if (m_jobId < 0 || !m_codecCtx) {
+        // 任务已失败，照常归还帧槽，等主进程重新分配
+        QMutexLocker locker(&m_freedMutex);
+        m_freedSlots.push_back(slot);
+        return true;
+    }
+    if (slot < 0 || slot >= m_slotCount) return false;
+
+    if (m_crashAfter > 0 && ++m_framesSeen >= m_crashAfter) {
+        fprintf(stderr, "encode worker %d: injected crash at frame %lld\n", m_workerId, (long long)frameIndex);
+        fflush(stderr);
+        abort();
+    }
+
+    // 帧数据直接指向共享内存槽，引用计数归零时回调归还槽号
+    uint8_t* data = m_ring + (size_t)slot * m_slotBytes;
+    m_frame->format = AV_PIX_FMT_YUV420P;
+    m_frame->width = m_width;
+    m_frame->height = m_height;
+    m_frame->buf[0] = av_buffer_create(data, m_slotBytes, &EncodeWorker::releaseSlot, this, AV_BUFFER_FLAG_READONLY);
+    if (!m_frame->buf[0]) return false;
+    av_image_fill_arrays(m_frame->data, m_frame->linesize, data, AV_PIX_FMT_YUV420P, m_width, m_height, 1);
+    m_frame->pts = frameIndex;
+
+    ret = avcodec_send_frame(m_codecCtx, m_frame);
+    av_frame_unref(m_frame);
+    if (ret < 0) return false;
+
+    if (writePackets(false) < 0) return false;
+
+    m_framesReceived++;
+    if (m_framesReceived >= m_jobFrames) {
+        return finishJob();
+    }
+    return true;
+}
+
+int EncodeWorker::writePackets(bool flush) {
+    int ret = 0;
+    if (flush) {
+        ret = avcodec_send_frame(m_codecCtx, NULL);
+        if (ret < 0 && ret != AVERROR_EOF) return ret;
+    }
+
+    while (1) {
+        ret = avcodec_receive_packet(m_codecCtx, m_pkt);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+        if (ret < 0) return ret;
+
+        sendLine("PKT " + QByteArray::number(m_pkt->size));
+        av_packet_rescale_ts(m_pkt, m_codecCtx->time_base, m_stream->time_base);
+        m_pkt->stream_index = m_stream->index;
+        ret = av_interleaved_write_frame(m_fmtCtx, m_pkt);
+        av_packet_unref(m_pkt);
+        if (ret < 0) return ret;
+    }
+}
+
+bool EncodeWorker::finishJob() {
+    int ret = writePackets(true);
+    if (ret >= 0) {
+        ret = av_write_trailer(m_fmtCtx);
+    }
+    if (ret < 0) return false;
+
+    int64_t cpu_ms = (currentProcessCpuNs() - m_jobCpuStart) / 1000000;
+    sendLine(QByteArray("DONE ") + QByteArray::number(m_jobId) + " " + QByteArray::number(m_framesReceived)
+        + " " + QByteArray::number(cpu_ms));
+    closeJob();
+    return true;
+}
+
+void EncodeWorker::failJob(const QString& reason) {
+    if (m_jobId >= 0) {
+        sendLine("FAIL " + QByteArray::number(m_jobId) + " " + reason.toUtf8());
+    }
+    closeJob();
+}
+
+void EncodeWorker::closeJob() {
+    // 编码器释放时会归还仍被引用的帧槽
+    avcodec_free_context(&m_codecCtx);
+    av_frame_free(&m_frame);
+    av_packet_free(&m_pkt);
+    if (m_fmtCtx) {
+        avio_closep(&m_fmtCtx->pb);
+        avformat_free_context(m_fmtCtx);
+        m_fmtCtx = nullptr;
+    }
+    m_stream = nullptr;
+    m_jobId = -1;
+}
\ No newline at end of file
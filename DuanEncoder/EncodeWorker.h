@@ -0,0 +1,101 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QString>
+#include <vector>
+
+extern "C" {
+#include <libavutil/opt.h>
+#include <libavutil/imgutils.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/buffer.h>
+#include <libavutil/error.h>
+}
+
+// 主进程（EncodePool）和编码工作进程之间的约定。
+// 本地套接字只传一行一条的文本控制消息，原始帧放在主进程创建的共享内存环里：
+//   主进程 -> 工作进程：CONFIG <宽> <高> <码率> <编码器> <帧率> <全局头> <槽数> <槽字节数> <共享内存key>
+//                       JOB <任务号> <起始帧> <帧数> <分段文件路径>
+//                       FRAME <槽号> <帧号>
+//                       QUIT
+//   工作进程 -> 主进程：HELLO <工作进程号>
+//                       FREE <槽号>          编码器不再引用该槽，可以写入下一帧
+//                       PKT <字节数>
+//                       DONE <任务号> <帧数> <CPU毫秒>
+//                       FAIL <任务号> <原因>
+namespace EncodeProtocol {
+const int kRingSlots = 8;        // 每个工作进程的帧槽数
+const int kSlotAlign = 64;       // 槽起始地址按缓存行对齐
+
+// YUV420P 一帧的字节数，向上取整到对齐边界
+inline int slotBytes(int width, int height) {
+    int bytes = width * height * 3 / 2;
+    return (bytes + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+}
+}
+
+// 编码工作进程：由 EncodePool 以 --encode-worker 启动。
+// 每个 JOB 是输入中一段连续的帧，独立编码（首帧为IDR）写入一个 NUT 分段文件，
+// 主进程按顺序把分段合并成最终输出。帧数据直接包装共享内存，不做拷贝
+class EncodeWorker {
+public:
+    // crashAfter > 0 时编码到第 N 帧主动崩溃，用于验证主进程的重启和任务重排
+    EncodeWorker(const QString& serverName, int workerId, int crashAfter = 0);
+    ~EncodeWorker();
+
+    // 阻塞运行到主进程发 QUIT 或连接断开，返回进程退出码
+    int run();
+
+private:
+    bool handleLine(const QByteArray& line);
+    bool configure(const QList<QByteArray>& args);
+    bool startJob(int jobId, int64_t firstFrame, int frameCount, const QString& segmentPath);
+    bool encodeFrame(int slot, int64_t frameIndex);
+    bool finishJob();
+    void closeJob();
+    // 取出编码器中已有的包并写入分段文件；flush 为 true 时先送入空帧冲刷
+    int writePackets(bool flush);
+    void failJob(const QString& reason);
+    void sendLine(const QByteArray& line);
+    void sendFreedSlots();
+    // av_buffer_create 的释放回调：编码器放开帧引用时记下槽号
+    static void releaseSlot(void* opaque, uint8_t* data);
+
+    QString m_serverName;
+    int m_workerId = 0;
+    int m_crashAfter = 0;
+    int64_t m_framesSeen = 0;
+
+    QLocalSocket m_socket;
+    QSharedMemory m_shm;
+    uint8_t* m_ring = nullptr;
+    int m_slotCount = 0;
+    int m_slotBytes = 0;
+
+    // CONFIG 下发的编码参数
+    int m_width = 0;
+    int m_height = 0;
+    int m_bitRate = 0;
+    int m_codecId = AV_CODEC_ID_H264;
+    int m_frameRate = 25;
+    bool m_globalHeader = false;
+
+    // 当前任务
+    int m_jobId = -1;
+    int m_jobFrames = 0;
+    int m_framesReceived = 0;
+    int64_t m_jobCpuStart = 0;
+    AVFormatContext* m_fmtCtx = nullptr;
+    AVCodecContext* m_codecCtx = nullptr;
+    AVStream* m_stream = nullptr;
+    AVFrame* m_frame = nullptr;
+    AVPacket* m_pkt = nullptr;
+
+    QMutex m_freedMutex;
+    std::vector<int> m_freedSlots;
+};
\ No newline at end of file
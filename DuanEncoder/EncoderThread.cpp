@@ -1,10 +1,39 @@
-#define _CRT_SECURE_NO_WARNINGS  // ðȫ
+#define _CRT_SECURE_NO_WARNINGS  // 禁用安全函数警告
 #include "EncoderThread.h"
 #include "stdafx.h"
+#include "Tracer.h"
+#include "FilterChain.h"
+#include "SliceOutput.h"
+#include "BitstreamAnalyzer.h"
+#include "RtpStream.h"
+#include "SceneDetector.h"
 #include <QDebug>
 #include <cstdio>
+#include <cstring>
 
-EncoderThread::EncoderThread(QObject* parent) : QThread(parent) {}
+extern "C" {
+#include <libavutil/time.h>
+}
+
+namespace {
+// 取消后留给冲刷编码器和写文件尾的时间，超过后输出IO被强制中断
+const int kFinalizeGraceMs = 2000;
+// 低延迟模式下帧内刷新一轮的帧数（25fps 下一秒），丢包后最多这么久恢复
+const int kIntraRefreshPeriod = 25;
+// 场景切换预分析：领先编码的帧数，以及关键帧的最小/最大间隔（最大间隔即原来的 gop_size）
+const int kSceneLookahead = 8;
+const int kMinKeyint = 12;
+const int kMaxKeyint = 250;
+}
+
+EncoderThread::EncoderThread(QObject* parent) : QThread(parent) {
+    m_control.setInterruptGrace(kFinalizeGraceMs);
+}
+
+EncoderThread::~EncoderThread() {
+    m_control.cancel();
+    wait();
+}
 
 void EncoderThread::setParams(const QString& inputYuv, const QString& outputFile,
     int width, int height, int bitRate, int frameNum, int codecType) {
@@ -15,19 +44,28 @@ void EncoderThread::setParams(const QString& inputYuv, const QString& outputFile
     m_bitRate = bitRate;
     m_frameNum = frameNum;
     m_codecType = codecType;
+    // 在启动线程前复位，避免 start() 之后立即取消的请求被覆盖
+    m_control.reset();
+    m_cancelled = false;
+    m_outputFinalized = false;
+    m_metrics.reset(frameNum, 25.0);
 }
 
 void EncoderThread::printError(const char* msg, int errnum) {
     char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
     av_strerror(errnum, err_buf, sizeof(err_buf));
-    emit encodeLog(QString("%1: %2").arg(msg).arg(err_buf));
+    log(LogError, QString("%1: %2").arg(msg).arg(err_buf));
+}
+
+void EncoderThread::log(LogLevel level, const QString& text) {
+    LogSink::instance().write(level, "encode", text);
 }
 
 int EncoderThread::flushEncoder(AVFormatContext* fmt_ctx, AVCodecContext* enc_ctx, int stream_idx) {
     int ret = 0;
     AVPacket* pkt = av_packet_alloc();
     if (!pkt) {
-        emit encodeLog("Failed to allocate packet");
+        log(LogError, "Failed to allocate packet");
         return AVERROR(ENOMEM);
     }
 
@@ -35,6 +73,7 @@ int EncoderThread::flushEncoder(AVFormatContext* fmt_ctx, AVCodecContext* enc_ct
         av_packet_free(&pkt);
         return 0;
     }
+    DUAN_TRACE_SCOPE("flush");
 
     while (1) {
         ret = avcodec_send_frame(enc_ctx, NULL);
@@ -56,10 +95,16 @@ int EncoderThread::flushEncoder(AVFormatContext* fmt_ctx, AVCodecContext* enc_ct
             return ret;
         }
 
+        if (m_analyzer) {
+            m_analyzer->addPacket(pkt->data, pkt->size, pkt->pts);
+        }
         av_packet_rescale_ts(pkt, enc_ctx->time_base, fmt_ctx->streams[stream_idx]->time_base);
         pkt->stream_index = stream_idx;
 
-        emit encodeLog(QString("Flush Encoder: Succeed to encode 1 frame! size:%1").arg(pkt->size));
+        if (LogSink::instance().accepts(LogDebug)) {
+            log(LogDebug, QString("Flush Encoder: Succeed to encode 1 frame! size:%1").arg(pkt->size));
+        }
+        m_metrics.addPacket(pkt->size);
 
         ret = av_interleaved_write_frame(fmt_ctx, pkt);
         av_packet_unref(pkt);
@@ -84,53 +129,122 @@ void EncoderThread::run() {
     AVPacket* pkt = NULL;
     uint8_t* picture_buf = NULL;
     FILE* in_file = NULL;
+    FrameBufferPool frame_pool;
+    FrameMemory::PageMode page_mode = FrameMemory::SmallPages;
+    FilterChain filters;
+    QString filter_error;
+    int64_t filter_us = 0;
+    int filtered_frames = 0;
+    SliceDispatcher slices((AVCodecID)m_codecType);
+    AvioSliceSink* slice_sink = NULL;
+    BitstreamAnalyzer analyzer((AVCodecID)m_codecType);
+    QString report_error;
+    RtpSender rtp_sender;
+    QString rtp_error;
+    bool dispatch_slices = false;
+    SceneDetector scenes;
+    QString scene_error;
+    bool scene_key = false;
+    int64_t encode_start = 0;
+    int encoded_frames = 0;
+    uint64_t saved_affinity = 0;
+    int progress = 0;
+    int last_progress = -1;
 
     int ret = 0;
     int frame_count = 0;
     int y_size = 0;
+    int64_t cpu_start = currentThreadCpuNs();
+
+    DUAN_TRACE_THREAD("encoder");
+    m_metrics.running.store(true, std::memory_order_relaxed);
 
-    // YUVļ
+    // 打开输入YUV文件
     in_file = fopen(m_inputYuv.toUtf8().constData(), "rb");
     if (!in_file) {
-        emit encodeLog(QString("Could not open input file '%1'").arg(m_inputYuv));
+        log(LogError, QString("Could not open input file '%1'").arg(m_inputYuv));
+        m_metrics.running.store(false, std::memory_order_relaxed);
         emit encodeFinished(false);
         return;
     }
 
-    // ʽ
+    // 先绑定再打开编码器，编码器内部创建的线程（x264/x265 的工作线程）也落在节点上。
+    // Windows 上新线程取进程的亲和性，编码期间整个进程绑到节点，结束时恢复
+    if (m_numaNode >= 0) {
+        if (FrameMemory::pinNewThreadsToNode(m_numaNode, &saved_affinity)) {
+            log(LogInfo, QString("Encoder and its worker threads pinned to NUMA node %1").arg(m_numaNode));
+        }
+        else if (FrameMemory::pinCurrentThreadToNode(m_numaNode)) {
+            log(LogWarning, QString("Only the feeding thread is pinned to NUMA node %1; encoder worker threads are not").arg(m_numaNode));
+        }
+        else {
+            log(LogWarning, QString("Could not pin the encoder to NUMA node %1").arg(m_numaNode));
+        }
+    }
+
+    // 编码前滤镜：按原始尺寸读入，编码器按滤镜链的输出尺寸配置
+    if (!filters.configure(m_filterSpec, m_width, m_height, &filter_error)) {
+        log(LogError, QString("Invalid filter chain '%1': %2").arg(m_filterSpec, filter_error));
+        ret = AVERROR(EINVAL);
+        goto cleanup;
+    }
+    if (!filters.isEmpty()) {
+        log(LogInfo, QString("Pre-encode filters: %1").arg(filters.describe()));
+    }
+
+    // 场景切换预分析读原始输入，与滤镜无关；帧内刷新模式没有关键帧可放
+    if (m_sceneDetect && m_lowLatency) {
+        log(LogWarning, "Scene-cut keyframes are not used in low-latency mode (intra refresh replaces keyframes)");
+    }
+    else if (m_sceneDetect) {
+        if (scenes.start(m_inputYuv, m_width, m_height, m_frameNum, kSceneLookahead, kMinKeyint, kMaxKeyint,
+            &scene_error)) {
+            log(LogInfo, QString("Scene lookahead: %1 frames ahead, keyframe interval %2-%3 (%4)")
+                .arg(kSceneLookahead).arg(kMinKeyint).arg(kMaxKeyint).arg(scenes.usesAvx2() ? "AVX2" : "scalar"));
+        }
+        else {
+            log(LogWarning, QString("Scene detection disabled: %1").arg(scene_error));
+        }
+    }
+
+    // 创建输出格式上下文
     ret = avformat_alloc_output_context2(&fmt_ctx, NULL, NULL, m_outputFile.toUtf8().constData());
     if (ret < 0) {
         printError("Could not create output context", ret);
         goto cleanup;
     }
+    fmt_ctx->interrupt_callback = m_control.interruptCallback();
 
-    // ұ
+    // 查找编码器
     codec = avcodec_find_encoder((AVCodecID)m_codecType);
     if (!codec) {
-        emit encodeLog("Could not find encoder");
+        log(LogError, "Could not find encoder");
+        ret = AVERROR_ENCODER_NOT_FOUND;
         goto cleanup;
     }
 
-    // Ƶ
+    // 创建视频流
     video_stream = avformat_new_stream(fmt_ctx, NULL);
     if (!video_stream) {
-        emit encodeLog("Could not create video stream");
+        log(LogError, "Could not create video stream");
+        ret = AVERROR(ENOMEM);
         goto cleanup;
     }
 
-    // 
+    // 分配编码器上下文
     codec_ctx = avcodec_alloc_context3(codec);
     if (!codec_ctx) {
-        emit encodeLog("Could not allocate codec context");
+        log(LogError, "Could not allocate codec context");
+        ret = AVERROR(ENOMEM);
         goto cleanup;
     }
 
-    // ñ
+    // 设置编码器参数
     codec_ctx->codec_id = (AVCodecID)m_codecType;
     codec_ctx->codec_type = AVMEDIA_TYPE_VIDEO;
     codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    codec_ctx->width = m_width;
-    codec_ctx->height = m_height;
+    codec_ctx->width = filters.outputWidth();
+    codec_ctx->height = filters.outputHeight();
     codec_ctx->bit_rate = m_bitRate;
     codec_ctx->gop_size = 250;
     codec_ctx->time_base.num = 1;
@@ -142,7 +256,7 @@ void EncoderThread::run() {
         codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     }
 
-    // ñѡ
+    // 设置编码器选项
     if (codec_ctx->codec_id == AV_CODEC_ID_H264) {
         av_opt_set(codec_ctx->priv_data, "preset", "slow", 0);
         av_opt_set(codec_ctx->priv_data, "tune", "zerolatency", 0);
@@ -152,14 +266,52 @@ void EncoderThread::run() {
         av_opt_set(codec_ctx->priv_data, "tune", "zero-latency", 0);
     }
 
-    // 򿪱
+    // 低延迟：用周期性帧内刷新代替 IDR，一帧分多个切片，VBV 限制在一帧以内，避免关键帧突发
+    if (m_lowLatency) {
+        codec_ctx->gop_size = kIntraRefreshPeriod;
+        codec_ctx->max_b_frames = 0;
+        codec_ctx->slices = m_slices;
+        codec_ctx->rc_max_rate = m_bitRate;
+        codec_ctx->rc_buffer_size = m_bitRate / 25;
+        if (codec_ctx->codec_id == AV_CODEC_ID_H264) {
+            av_opt_set(codec_ctx->priv_data, "intra-refresh", "1", 0);
+            av_opt_set(codec_ctx->priv_data, "x264-params", "scenecut=0", 0);
+        }
+        else if (codec_ctx->codec_id == AV_CODEC_ID_HEVC) {
+            QByteArray params = QString("intra-refresh=1:scenecut=0:slices=%1").arg(m_slices).toUtf8();
+            av_opt_set(codec_ctx->priv_data, "x265-params", params.constData(), 0);
+        }
+        log(LogInfo, QString("Low-latency mode: intra refresh every %1 frames, %2 slices per frame")
+            .arg(kIntraRefreshPeriod).arg(m_slices));
+    }
+
+    // 关键帧全部由预分析放置：编码器的周期间隔放宽到推迟上限之外，关掉它自己的场景检测，强制的 I 帧编成 IDR
+    if (scenes.isRunning()) {
+        codec_ctx->gop_size = kMaxKeyint + kSceneLookahead + 1;
+        av_opt_set(codec_ctx->priv_data, "forced-idr", "1", 0);
+        if (codec_ctx->codec_id == AV_CODEC_ID_H264) {
+            av_opt_set(codec_ctx->priv_data, "x264-params", "scenecut=0", 0);
+        }
+        else if (codec_ctx->codec_id == AV_CODEC_ID_HEVC) {
+            av_opt_set(codec_ctx->priv_data, "x265-params", "scenecut=0", 0);
+        }
+    }
+
+    // 打开编码器
     ret = avcodec_open2(codec_ctx, codec, NULL);
     if (ret < 0) {
         printError("Could not open codec", ret);
         goto cleanup;
     }
 
-    // Ʊ
+    // 逐包码流分析；有全局头时参数集只在 extradata 里，先交给分析器
+    if (!m_analysisReport.isEmpty()) {
+        analyzer.setFrameRate(25.0);
+        analyzer.addExtradata(codec_ctx->extradata, codec_ctx->extradata_size);
+        m_analyzer = &analyzer;
+    }
+
+    // 复制编码器参数到流
     ret = avcodec_parameters_from_context(video_stream->codecpar, codec_ctx);
     if (ret < 0) {
         printError("Could not copy codec parameters", ret);
@@ -167,89 +319,179 @@ void EncoderThread::run() {
     }
     video_stream->time_base = codec_ctx->time_base;
 
-    // ӡʽϢ
+    // 打印格式信息
     av_dump_format(fmt_ctx, 0, m_outputFile.toUtf8().constData(), 1);
 
-    // ļIO
+    // 打开输出文件IO
     if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&fmt_ctx->pb, m_outputFile.toUtf8().constData(), AVIO_FLAG_WRITE);
+        ret = avio_open2(&fmt_ctx->pb, m_outputFile.toUtf8().constData(), AVIO_FLAG_WRITE,
+            &fmt_ctx->interrupt_callback, NULL);
         if (ret < 0) {
             printError("Could not open output file", ret);
             goto cleanup;
         }
     }
 
-    // дļͷ
+    // 写入文件头
     ret = avformat_write_header(fmt_ctx, NULL);
     if (ret < 0) {
         printError("Error writing header", ret);
         goto cleanup;
     }
 
-    // ֡ṹ
+    // 裸 Annex-B 输出时切片绕过复用器直接写 IO；容器格式需要整帧，只统计切片延迟
+    if (m_lowLatency) {
+        if (fmt_ctx->pb && (!strcmp(fmt_ctx->oformat->name, "h264") || !strcmp(fmt_ctx->oformat->name, "hevc"))) {
+            slice_sink = new AvioSliceSink(fmt_ctx->pb);
+            slices.addSink(slice_sink);
+        }
+        else {
+            log(LogWarning, QString("Slices are written per frame for '%1' output; use .h264/.265 for slice output")
+                .arg(fmt_ctx->oformat->name));
+        }
+    }
+
+    // RTP 实时预览与文件输出并行，切片同样在取到包后立即分包发出
+    if (!m_rtpTarget.isEmpty()) {
+        if (!rtp_sender.open(m_rtpTarget, (AVCodecID)m_codecType, m_bitRate, 25.0, m_rtpJitterMs, m_rtpMtu,
+            &rtp_error)) {
+            log(LogError, QString("Could not start RTP output: %1").arg(rtp_error));
+            ret = AVERROR(EINVAL);
+            goto cleanup;
+        }
+        rtp_sender.setParameterSets(codec_ctx->extradata, codec_ctx->extradata_size);
+        slices.addSink(&rtp_sender);
+        log(LogInfo, QString("Streaming RTP to %1 (jitter budget %2 ms, MTU %3)")
+            .arg(m_rtpTarget).arg(m_rtpJitterMs).arg(m_rtpMtu));
+    }
+    dispatch_slices = m_lowLatency || rtp_sender.isOpen();
+
+    // 分配帧结构
     frame = av_frame_alloc();
     if (!frame) {
-        emit encodeLog("Could not allocate frame");
+        log(LogError, "Could not allocate frame");
+        ret = AVERROR(ENOMEM);
         goto cleanup;
     }
-    frame->format = codec_ctx->pix_fmt;
-    frame->width = codec_ctx->width;
-    frame->height = codec_ctx->height;
 
-    ret = av_frame_get_buffer(frame, 32);
+    // 帧缓冲来自大页池，行宽和平面首地址按 64 字节对齐
+    ret = frame_pool.init(codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt, m_numaNode);
+    if (ret >= 0) {
+        ret = frame_pool.getFrame(frame);
+    }
     if (ret < 0) {
         printError("Could not allocate frame buffer", ret);
         goto cleanup;
     }
 
-    // ݰ
+    // 分配数据包
     pkt = av_packet_alloc();
     if (!pkt) {
-        emit encodeLog("Could not allocate packet");
+        log(LogError, "Could not allocate packet");
+        ret = AVERROR(ENOMEM);
         goto cleanup;
     }
 
-    // YUVݴС
-    y_size = codec_ctx->width * codec_ctx->height;
-    picture_buf = (uint8_t*)av_malloc(y_size * 3 / 2);
+    // 计算YUV数据大小（输入尺寸，有滤镜时与编码尺寸不同）
+    y_size = m_width * m_height;
+    picture_buf = (uint8_t*)FrameMemory::allocate(y_size * 3 / 2, m_numaNode, &page_mode);
     if (!picture_buf) {
-        emit encodeLog("Could not allocate picture buffer");
+        log(LogError, "Could not allocate picture buffer");
+        ret = AVERROR(ENOMEM);
         goto cleanup;
     }
+    log(LogInfo, QString("Frame buffers: %1x%2, input %3, encoder frames %4")
+        .arg(codec_ctx->width).arg(codec_ctx->height)
+        .arg(FrameMemory::pageModeName(page_mode)).arg(FrameMemory::pageModeName(frame_pool.pageMode())));
 
-    // ѭ
+    // 编码主循环
+    encode_start = av_gettime_relative();
     for (int i = 0; i < m_frameNum; i++) {
-        // ȡYUV
-        size_t read_size = fread(picture_buf, 1, y_size * 3 / 2, in_file);
+        m_metrics.cpuNs.store(currentThreadCpuNs() - cpu_start, std::memory_order_relaxed);
+
+        // 暂停时在这里等待；取消则停止送帧，转入下面的冲刷和写文件尾
+        if (!m_control.waitIfPaused()) {
+            m_cancelled = true;
+            log(LogWarning, QString("Cancel requested at frame %1, finalizing partial output...").arg(i));
+            break;
+        }
+        DUAN_TRACE_SCOPE("frame");
+
+        // 读取YUV数据
+        size_t read_size = 0;
+        {
+            DUAN_TRACE_SCOPE("read");
+            read_size = fread(picture_buf, 1, y_size * 3 / 2, in_file);
+        }
         if (read_size != y_size * 3 / 2) {
-            emit encodeLog(QString("Warning: Not enough data for frame %1").arg(i));
+            log(LogWarning, QString("Warning: Not enough data for frame %1").arg(i));
             break;
         }
 
-        // ȷ֡д
-        ret = av_frame_make_writable(frame);
-        if (ret < 0) {
-            printError("Could not make frame writable", ret);
-            goto cleanup;
+        // 编码器仍引用上一帧时从池里换一块，不用 av_frame_make_writable 以免退回普通分配
+        if (!av_frame_is_writable(frame)) {
+            av_frame_unref(frame);
+            ret = frame_pool.getFrame(frame);
+            if (ret < 0) {
+                printError("Could not make frame writable", ret);
+                goto cleanup;
+            }
         }
 
-        // YUV
-        memcpy(frame->data[0], picture_buf, y_size);
-        memcpy(frame->data[1], picture_buf + y_size, y_size / 4);
-        memcpy(frame->data[2], picture_buf + y_size * 5 / 4, y_size / 4);
+        // 填充YUV数据
+        if (!filters.isEmpty()) {
+            // 滤镜链最后一级直接写入编码帧，不再另外拷贝
+            DUAN_TRACE_SCOPE("filter");
+            int64_t filter_start = av_gettime_relative();
+            ret = filters.process(picture_buf, frame);
+            filter_us += av_gettime_relative() - filter_start;
+            filtered_frames++;
+            if (ret < 0) {
+                printError("Pre-encode filter failed", ret);
+                goto cleanup;
+            }
+        }
+        else {
+            DUAN_TRACE_SCOPE("memcpy");
+            // 目标行宽按 64 字节对齐，与输入行宽不同，逐行拷贝
+            av_image_copy_plane(frame->data[0], frame->linesize[0], picture_buf, codec_ctx->width,
+                codec_ctx->width, codec_ctx->height);
+            av_image_copy_plane(frame->data[1], frame->linesize[1], picture_buf + y_size, codec_ctx->width / 2,
+                codec_ctx->width / 2, codec_ctx->height / 2);
+            av_image_copy_plane(frame->data[2], frame->linesize[2], picture_buf + y_size * 5 / 4, codec_ctx->width / 2,
+                codec_ctx->width / 2, codec_ctx->height / 2);
+        }
 
         frame->pts = i;
+        // 帧从池里复用，类型每次都要重设；预分析跟不上时在这里等待，等待时间计入报告
+        frame->pict_type = AV_PICTURE_TYPE_NONE;
+        if (scenes.isRunning()) {
+            DUAN_TRACE_SCOPE("lookahead_wait");
+            if (scenes.waitDecision(i, &scene_key) && scene_key) {
+                frame->pict_type = AV_PICTURE_TYPE_I;
+            }
+        }
+        encoded_frames++;
+        if (dispatch_slices) {
+            slices.frameSubmitted(frame->pts);
+        }
 
-        // ֡
-        ret = avcodec_send_frame(codec_ctx, frame);
+        // 发送帧到编码器
+        {
+            DUAN_TRACE_SCOPE("send_frame");
+            ret = avcodec_send_frame(codec_ctx, frame);
+        }
         if (ret < 0) {
             printError("Error sending frame to encoder", ret);
             break;
         }
 
-        // ձݰ
+        // 接收编码后的数据包
         while (ret >= 0) {
-            ret = avcodec_receive_packet(codec_ctx, pkt);
+            {
+                DUAN_TRACE_SCOPE("receive_packet");
+                ret = avcodec_receive_packet(codec_ctx, pkt);
+            }
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
                 break;
 
@@ -258,15 +500,44 @@ void EncoderThread::run() {
                 goto cleanup;
             }
 
+            // 低延迟模式或 RTP 输出时逐片分发，时间戳仍是编码器时间基
+            if (dispatch_slices) {
+                ret = slices.dispatch(pkt);
+                if (ret < 0) {
+                    printError("Error writing slice", ret);
+                    goto cleanup;
+                }
+            }
+
+            if (m_analyzer) {
+                DUAN_TRACE_SCOPE("analyze");
+                m_analyzer->addPacket(pkt->data, pkt->size, pkt->pts);
+            }
+
             av_packet_rescale_ts(pkt, codec_ctx->time_base, video_stream->time_base);
             pkt->stream_index = video_stream->index;
 
             frame_count++;
-            emit encodeLog(QString("Encoded frame: %1 size:%2").arg(frame_count).arg(pkt->size));
-            emit encodeProgress(frame_count, m_frameNum);
+            // 逐包日志只在调试级别开启时格式化
+            if (LogSink::instance().accepts(LogDebug)) {
+                log(LogDebug, QString("Encoded frame: %1 size:%2").arg(frame_count).arg(pkt->size));
+            }
+            // 只在百分比变化时通知界面，逐包发信号会在高帧率下塞满界面的事件队列
+            progress = m_frameNum > 0 ? (int)((int64_t)frame_count * 100 / m_frameNum) : 0;
+            if (progress != last_progress) {
+                last_progress = progress;
+                emit encodeProgress(frame_count, m_frameNum);
+            }
+            m_metrics.addPacket(pkt->size);
 
-            ret = av_interleaved_write_frame(fmt_ctx, pkt);
-            av_packet_unref(pkt);
+            if (slice_sink) {
+                av_packet_unref(pkt);
+            }
+            else {
+                DUAN_TRACE_SCOPE("mux");
+                ret = av_interleaved_write_frame(fmt_ctx, pkt);
+                av_packet_unref(pkt);
+            }
 
             if (ret < 0) {
                 printError("Error writing packet", ret);
@@ -275,24 +546,81 @@ void EncoderThread::run() {
         }
     }
 
-    // ˢ±
+    if (m_lowLatency) {
+        log(LogInfo, QString("Low-latency slices: %1").arg(slices.report()));
+    }
+    if (scenes.isRunning()) {
+        double encode_ms = encoded_frames > 0 ? (av_gettime_relative() - encode_start) / 1000.0 / encoded_frames : 0.0;
+        scenes.stop();
+        // 取消或输入不足时，分析线程放出的结论可能多于实际编码的帧
+        scenes.clipToFrames(encoded_frames);
+        log(LogInfo, QString("Scene lookahead: %1; encoding %2 ms/frame")
+            .arg(scenes.report()).arg(encode_ms, 0, 'f', 2));
+        if (!m_cutList.isEmpty()) {
+            if (scenes.writeCutList(m_cutList, 25.0, &report_error)) {
+                log(LogInfo, QString("Cut list written to %1").arg(m_cutList));
+            }
+            else {
+                log(LogWarning, QString("Could not write cut list '%1': %2").arg(m_cutList, report_error));
+            }
+        }
+    }
+    if (filtered_frames > 0) {
+        log(LogInfo, QString("Pre-encode filters: %1 ms/frame over %2 frames")
+            .arg(filter_us / 1000.0 / filtered_frames, 0, 'f', 2).arg(filtered_frames));
+    }
+
+    // 刷新编码器
     ret = flushEncoder(fmt_ctx, codec_ctx, video_stream->index);
     if (ret < 0) {
-        emit encodeLog("Flushing encoder failed");
+        log(LogError, "Flushing encoder failed");
         goto cleanup;
     }
 
-    // дļβ
-    av_write_trailer(fmt_ctx);
-    emit encodeLog("Encoding completed successfully!");
-    emit encodeFinished(true);
+    // 冲刷出的包不再实时发送；等发送队列排空后统计
+    if (rtp_sender.isOpen()) {
+        rtp_sender.close();
+        log(LogInfo, QString("RTP: %1").arg(rtp_sender.report()));
+    }
+
+    if (m_analyzer) {
+        log(LogInfo, QString("Bitstream: %1").arg(analyzer.summary()));
+        if (analyzer.writeReport(m_analysisReport, &report_error)) {
+            log(LogInfo, QString("Bitstream report written to %1").arg(m_analysisReport));
+        }
+        else {
+            log(LogWarning, QString("Could not write bitstream report '%1': %2").arg(m_analysisReport, report_error));
+        }
+    }
+
+    // 写入文件尾
+    ret = av_write_trailer(fmt_ctx);
+    if (ret < 0) {
+        printError("Error writing trailer", ret);
+        goto cleanup;
+    }
+    m_outputFinalized = true;
+    if (m_cancelled) {
+        log(LogWarning, QString("Encoding cancelled: %1 frames written, output finalized %2 ms after the request")
+            .arg(frame_count).arg(m_control.msSinceCancel(), 0, 'f', 1));
+        emit encodeFinished(false);
+    }
+    else {
+        log(LogInfo, "Encoding completed successfully!");
+        emit encodeFinished(true);
+    }
 
 cleanup:
-    // Դ
-    av_free(picture_buf);
+    // 资源清理
+    rtp_sender.close();
+    scenes.stop();
+    delete slice_sink;
+    m_analyzer = NULL;
+    FrameMemory::release(picture_buf, y_size * 3 / 2);
     av_packet_free(&pkt);
     av_frame_free(&frame);
     avcodec_free_context(&codec_ctx);
+    frame_pool.uninit();
 
     if (fmt_ctx) {
         if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
@@ -305,6 +633,10 @@ cleanup:
         fclose(in_file);
     }
 
+    FrameMemory::restoreProcessAffinity(saved_affinity);
+    m_metrics.cpuNs.store(currentThreadCpuNs() - cpu_start, std::memory_order_relaxed);
+    m_metrics.running.store(false, std::memory_order_relaxed);
+
     if (ret < 0) {
         emit encodeFinished(false);
     }
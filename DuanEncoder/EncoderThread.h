@@ -2,6 +2,12 @@
 #include <QThread>
 #include <QString>
 #include <QObject>
+#include "JobControl.h"
+#include "Metrics.h"
+#include "LogSink.h"
+#include "FrameMemory.h"
+
+class BitstreamAnalyzer;
 
 extern "C" {
 #include <libavutil/opt.h>
@@ -18,27 +24,59 @@ class EncoderThread : public QThread {
     Q_OBJECT
 public:
     explicit EncoderThread(QObject* parent = nullptr);
+    ~EncoderThread() override;
 
-    // ñ
+    // 设置编码参数
     void setParams(const QString& inputYuv, const QString& outputFile,
         int width, int height, int bitRate, int frameNum,
         int codecType = AV_CODEC_ID_H264);
 
+    // 暂停/继续/取消，可在任意线程调用；取消后仍会冲刷编码器并写文件尾，是否写成见 outputFinalized()
+    void pauseEncoding() { m_control.pause(); }
+    void resumeEncoding() { m_control.resume(); }
+    void cancelEncoding() { m_control.cancel(); }
+    bool isPaused() const { return m_control.isPaused(); }
+    bool wasCancelled() const { return m_cancelled; }
+    // 文件尾已写入、输出可正常播放；取消后冲刷或写文件尾失败时为 false
+    bool outputFinalized() const { return m_outputFinalized; }
+    // 绑定到 NUMA 节点（-1 不绑定）：编码线程及其之后创建的编码器线程、帧缓冲都放在该节点上
+    void setNumaNode(int node) { m_numaNode = node; }
+    // 编码前滤镜链描述（见 FilterChain），空串表示直接编码原始帧；宽高仍填输入文件的尺寸
+    void setFilters(const QString& spec) { m_filterSpec = spec; }
+    // 低延迟模式：帧内刷新代替 IDR、每帧 slices 个切片，切片产生后立即写出并统计延迟
+    void setLowLatency(bool enabled, int slices = 4) { m_lowLatency = enabled; m_slices = slices; }
+    // 编码时逐包分析码流，结束后写入报告（.json 为 JSON，否则为二进制），空串表示不分析
+    void setAnalysisReport(const QString& path) { m_analysisReport = path; }
+    // 同时把码流按 RTP 发到 host:port（空串不发送）；jitterMs 为大帧摊开发送的时间上限，mtu 为 UDP 负载上限
+    void setRtpOutput(const QString& target, int jitterMs = 50, int mtu = 1400) {
+        m_rtpTarget = target;
+        m_rtpJitterMs = jitterMs;
+        m_rtpMtu = mtu;
+    }
+    // 场景切换预分析：在切换处强制关键帧，推迟与之相邻的周期 IDR；cutListPath 非空时写出切换列表（JSON）
+    void setSceneDetection(bool enabled, const QString& cutListPath = QString()) {
+        m_sceneDetect = enabled;
+        m_cutList = cutListPath;
+    }
+    // 界面定时采样，不依赖逐帧信号
+    const EncodeMetrics& metrics() const { return m_metrics; }
+
 protected:
-    void run() override; // ִ߳к
+    void run() override; // 线程执行函数
 
 signals:
-    void encodeProgress(int current, int total); // ȸ
-    void encodeLog(const QString& log);          // ־
-    void encodeFinished(bool success);           // ֪ͨ
+    void encodeProgress(int current, int total); // 进度更新
+    void encodeFinished(bool success);           // 完成通知
 
 private:
-    // 
+    // 错误处理函数
     void printError(const char* msg, int errnum);
-    // ˢ±
+    // 日志直接写入 LogSink，由界面成批取出
+    void log(LogLevel level, const QString& text);
+    // 刷新编码器
     int flushEncoder(AVFormatContext* fmt_ctx, AVCodecContext* enc_ctx, int stream_idx);
 
-    // 
+    // 编码参数
     QString m_inputYuv;
     QString m_outputFile;
     int m_width = 480;
@@ -46,4 +84,20 @@ private:
     int m_bitRate = 400000;
     int m_frameNum = 100;
     int m_codecType = AV_CODEC_ID_H264;
+    int m_numaNode = -1;
+    QString m_filterSpec;
+    bool m_lowLatency = false;
+    int m_slices = 4;
+    QString m_analysisReport;
+    BitstreamAnalyzer* m_analyzer = nullptr;   // 只在 run() 期间指向其局部对象
+    QString m_rtpTarget;
+    int m_rtpJitterMs = 50;
+    int m_rtpMtu = 1400;
+    bool m_sceneDetect = false;
+    QString m_cutList;
+
+    JobControl m_control;
+    EncodeMetrics m_metrics;
+    bool m_cancelled = false;
+    bool m_outputFinalized = false;
 };
\ No newline at end of file
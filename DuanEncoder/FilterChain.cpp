@@ -0,0 +1,498 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "FilterChain.h"
+#include "Simd.h"
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+namespace {
+const int kTileRows = 64;          // 每块的亮度行数，取偶数保证色度行对齐
+const int kRowPadding = 64;        // 临时行尾部留白，gather 一次读 4 字节会越过行尾
+const int kDefaultDenoise = 6;
+
+// ---- 标量内核 ----
+
+void copyRowC(uint8_t* dst, const uint8_t* src, int width) {
+    memcpy(dst, src, width);
+}
+
+// 2x2 盒式滤波，输出 width 个像素
+void halfRowC(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = (uint8_t)((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+// 纵向插值：weight 为 6 位定点（0~64），对应 row1 的比重
+void lerpRowC(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int width, int weight) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = (uint8_t)((row0[x] * (64 - weight) + row1[x] * weight + 32) >> 6);
+    }
+}
+
+// 横向插值：按坐标表从 src 取相邻两点
+void hscaleRowC(uint8_t* dst, const uint8_t* src, const int32_t* index, const uint32_t* weight, int width) {
+    for (int x = 0; x < width; x++) {
+        int i = index[x];
+        int w0 = weight[x] & 0xff;
+        int w1 = (weight[x] >> 8) & 0xff;
+        dst[x] = (uint8_t)((src[i] * w0 + src[i + 1] * w1 + 32) >> 6);
+    }
+}
+
+// 与上一帧差值不超过 threshold 的像素视为噪声，和上一帧取平均；差值大的是运动，保持原样
+void denoiseRowC(uint8_t* cur, const uint8_t* prev, int width, int threshold) {
+    for (int x = 0; x < width; x++) {
+        int diff = cur[x] > prev[x] ? cur[x] - prev[x] : prev[x] - cur[x];
+        if (diff <= threshold) {
+            cur[x] = (uint8_t)((cur[x] + prev[x] + 1) >> 1);
+        }
+    }
+}
+
+#ifdef DUAN_X86
+// ---- AVX2 内核：每次处理 32（横向插值为 16）个输出像素，尾部交给标量 ----
+
+DUAN_AVX2_TARGET void copyRowAvx2(uint8_t* dst, const uint8_t* src, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_loadu_si256((const __m256i*)(src + x)));
+    }
+    copyRowC(dst + x, src + x, width - x);
+}
+
+DUAN_AVX2_TARGET void halfRowAvx2(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int width) {
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i round = _mm256_set1_epi16(2);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        // maddubs 乘 1 即相邻两字节相加，两行再相加得到 2x2 之和
+        __m256i a0 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2 * x)), ones);
+        __m256i a1 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2 * x + 32)), ones);
+        __m256i b0 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2 * x)), ones);
+        __m256i b1 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2 * x + 32)), ones);
+        __m256i s0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a0, b0), round), 2);
+        __m256i s1 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a1, b1), round), 2);
+        // packus 按 128 位通道交错，换回顺序
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + x), packed);
+    }
+    halfRowC(dst + x, row0 + 2 * x, row1 + 2 * x, width - x);
+}
+
+DUAN_AVX2_TARGET void lerpRowAvx2(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int width, int weight) {
+    // 交错后的字节对 [row0, row1] 与权重对 [64-w, w] 做 maddubs
+    const __m256i weights = _mm256_set1_epi16((short)((weight << 8) | (64 - weight)));
+    const __m256i round = _mm256_set1_epi16(32);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(row0 + x));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(row1 + x));
+        __m256i lo = _mm256_maddubs_epi16(_mm256_unpacklo_epi8(a, b), weights);
+        __m256i hi = _mm256_maddubs_epi16(_mm256_unpackhi_epi8(a, b), weights);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 6);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 6);
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    lerpRowC(dst + x, row0 + x, row1 + x, width - x, weight);
+}
+
+DUAN_AVX2_TARGET void hscaleRowAvx2(uint8_t* dst, const uint8_t* src, const int32_t* index, const uint32_t* weight, int width) {
+    const __m256i round = _mm256_set1_epi16(32);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        // 每个 32 位元素取 src[i..i+3]，权重为 [64-f, f, 0, 0]，结果落在低 16 位
+        __m256i g0 = _mm256_i32gather_epi32((const int*)src, _mm256_loadu_si256((const __m256i*)(index + x)), 1);
+        __m256i g1 = _mm256_i32gather_epi32((const int*)src, _mm256_loadu_si256((const __m256i*)(index + x + 8)), 1);
+        __m256i s0 = _mm256_maddubs_epi16(g0, _mm256_loadu_si256((const __m256i*)(weight + x)));
+        __m256i s1 = _mm256_maddubs_epi16(g1, _mm256_loadu_si256((const __m256i*)(weight + x + 8)));
+        s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, round), 6);
+        s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, round), 6);
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(s0, s1), 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i*)(dst + x), bytes);
+    }
+    hscaleRowC(dst + x, src, index + x, weight + x, width - x);
+}
+
+DUAN_AVX2_TARGET void denoiseRowAvx2(uint8_t* cur, const uint8_t* prev, int width, int threshold) {
+    const __m256i limit = _mm256_set1_epi8((char)threshold);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(cur + x));
+        __m256i p = _mm256_loadu_si256((const __m256i*)(prev + x));
+        // 无符号绝对差：两个方向的饱和减法取或
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(c, p), _mm256_subs_epu8(p, c));
+        __m256i still = _mm256_cmpeq_epi8(_mm256_min_epu8(diff, limit), diff);
+        _mm256_storeu_si256((__m256i*)(cur + x), _mm256_blendv_epi8(c, _mm256_avg_epu8(c, p), still));
+    }
+    denoiseRowC(cur + x, prev + x, width - x, threshold);
+}
+#endif
+
+struct Kernels {
+    void (*copyRow)(uint8_t*, const uint8_t*, int);
+    void (*halfRow)(uint8_t*, const uint8_t*, const uint8_t*, int);
+    void (*lerpRow)(uint8_t*, const uint8_t*, const uint8_t*, int, int);
+    void (*hscaleRow)(uint8_t*, const uint8_t*, const int32_t*, const uint32_t*, int);
+    void (*denoiseRow)(uint8_t*, const uint8_t*, int, int);
+};
+
+const Kernels kScalarKernels = { copyRowC, halfRowC, lerpRowC, hscaleRowC, denoiseRowC };
+#ifdef DUAN_X86
+const Kernels kAvx2Kernels = { copyRowAvx2, halfRowAvx2, lerpRowAvx2, hscaleRowAvx2, denoiseRowAvx2 };
+#endif
+
+const Kernels& kernels(bool avx2) {
+#ifdef DUAN_X86
+    if (avx2) return kAvx2Kernels;
+#endif
+    (void)avx2;
+    return kScalarKernels;
+}
+
+// 输出坐标映射到源坐标（像素中心对齐），拆成整数下标和 6 位小数
+void mapAxis(int src, int dst, int pos, int* index, int* weight) {
+    double at = (pos + 0.5) * src / dst - 0.5;
+    if (at < 0) at = 0;
+    int base = (int)at;
+    int limit = src > 1 ? src - 2 : 0;
+    if (base > limit) base = limit;
+    int frac = src > 1 ? (int)((at - base) * 64 + 0.5) : 0;
+    *index = base;
+    *weight = std::min(frac, 64);
+}
+
+bool parseInt(const QString& text, int* value) {
+    bool ok = false;
+    *value = text.trimmed().toInt(&ok);
+    return ok;
+}
+}
+
+FilterChain::FilterChain() {
+    m_history = av_frame_alloc();
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+FilterChain::~FilterChain() {
+    m_pool.waitForDone();
+    clear();
+    av_frame_free(&m_history);
+}
+
+void FilterChain::clear() {
+    for (Stage& stage : m_stages) {
+        av_frame_free(&stage.buffer);
+    }
+    m_stages.clear();
+    m_bufferPools.clear();
+    m_denoise = 0;
+    if (m_history) av_frame_unref(m_history);
+}
+
+bool FilterChain::configure(const QString& spec, int inWidth, int inHeight, QString* error) {
+    int curWidth = inWidth;
+    int curHeight = inHeight;
+    int lastWriter = -1;
+
+    clear();
+    m_inWidth = inWidth;
+    m_inHeight = inHeight;
+    m_outWidth = inWidth;
+    m_outHeight = inHeight;
+    m_avx2 = cpuHasAvx2();
+
+    const QStringList items = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString& item : items) {
+        QString name = item.section('=', 0, 0).trimmed().toLower();
+        QStringList args = item.section('=', 1).split(':', Qt::SkipEmptyParts);
+        int values[4] = { 0 };
+
+        if (m_denoise > 0) {
+            *error = "denoise must be the last filter";
+            goto fail;
+        }
+        for (int i = 0; i < args.size() && i < 4; i++) {
+            if (!parseInt(args[i], &values[i])) {
+                *error = QString("Invalid number '%1' in '%2'").arg(args[i], item);
+                goto fail;
+            }
+        }
+
+        if (name == "crop") {
+            if (args.size() != 2 && args.size() != 4) {
+                *error = "crop expects w:h or w:h:x:y";
+                goto fail;
+            }
+            Stage stage;
+            stage.type = Crop;
+            stage.inWidth = curWidth;
+            stage.inHeight = curHeight;
+            stage.outWidth = values[0] & ~1;
+            stage.outHeight = values[1] & ~1;
+            stage.x = (args.size() == 4 ? values[2] : (curWidth - stage.outWidth) / 2) & ~1;
+            stage.y = (args.size() == 4 ? values[3] : (curHeight - stage.outHeight) / 2) & ~1;
+            if (stage.outWidth < 2 || stage.outHeight < 2 || stage.x < 0 || stage.y < 0
+                || stage.x + stage.outWidth > curWidth || stage.y + stage.outHeight > curHeight) {
+                *error = QString("crop %1 does not fit in %2x%3").arg(item).arg(curWidth).arg(curHeight);
+                goto fail;
+            }
+            m_stages.push_back(stage);
+            curWidth = stage.outWidth;
+            curHeight = stage.outHeight;
+        }
+        else if (name == "scale") {
+            if (args.size() != 2 || values[0] < 2 || values[1] < 2) {
+                *error = "scale expects w:h";
+                goto fail;
+            }
+            addScale(values[0] & ~1, values[1] & ~1, &curWidth, &curHeight);
+        }
+        else if (name == "denoise") {
+            m_denoise = args.isEmpty() ? kDefaultDenoise : values[0];
+            if (m_denoise < 1 || m_denoise > 255) {
+                *error = "denoise strength must be 1-255";
+                goto fail;
+            }
+        }
+        else {
+            *error = QString("Unknown filter '%1'").arg(name);
+            goto fail;
+        }
+    }
+    m_outWidth = curWidth;
+    m_outHeight = curHeight;
+
+    // 最后一个会写像素的阶段直接写编码帧，之前的每个阶段各用一块池化缓冲
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        if (m_stages[i].type != Crop) lastWriter = (int)i;
+    }
+    for (int i = 0; i < lastWriter; i++) {
+        Stage& stage = m_stages[i];
+        if (stage.type == Crop) continue;
+        std::unique_ptr<FrameBufferPool> pool(new FrameBufferPool());
+        stage.buffer = av_frame_alloc();
+        if (!stage.buffer || pool->init(stage.outWidth, stage.outHeight, AV_PIX_FMT_YUV420P, -1) < 0
+            || pool->getFrame(stage.buffer) < 0) {
+            *error = "Failed to allocate filter buffers";
+            goto fail;
+        }
+        m_bufferPools.push_back(std::move(pool));
+    }
+    return true;
+
+fail:
+    clear();
+    m_outWidth = inWidth;
+    m_outHeight = inHeight;
+    return false;
+}
+
+void FilterChain::addScale(int width, int height, int* curWidth, int* curHeight) {
+    // 比例不小于 2 时先逐级对半：盒式滤波比双线性便宜，大比例下也不会漏采样产生混叠
+    while (*curWidth >= width * 2 && *curHeight >= height * 2) {
+        Stage stage;
+        stage.type = Half;
+        stage.inWidth = *curWidth;
+        stage.inHeight = *curHeight;
+        stage.outWidth = (*curWidth / 2) & ~1;
+        stage.outHeight = (*curHeight / 2) & ~1;
+        m_stages.push_back(stage);
+        *curWidth = stage.outWidth;
+        *curHeight = stage.outHeight;
+    }
+    if (*curWidth == width && *curHeight == height) return;
+
+    Stage stage;
+    stage.type = Bilinear;
+    stage.inWidth = *curWidth;
+    stage.inHeight = *curHeight;
+    stage.outWidth = width;
+    stage.outHeight = height;
+    buildTable(&stage.table[0], *curWidth, *curHeight, width, height);
+    buildTable(&stage.table[1], *curWidth / 2, *curHeight / 2, width / 2, height / 2);
+    m_stages.push_back(stage);
+    *curWidth = width;
+    *curHeight = height;
+}
+
+void FilterChain::buildTable(ScaleTable* table, int srcWidth, int srcHeight, int dstWidth, int dstHeight) {
+    int index = 0;
+    int weight = 0;
+
+    table->srcWidth = srcWidth;
+    table->xIndex.resize(dstWidth);
+    table->xWeight.resize(dstWidth);
+    for (int x = 0; x < dstWidth; x++) {
+        mapAxis(srcWidth, dstWidth, x, &index, &weight);
+        table->xIndex[x] = index;
+        table->xWeight[x] = (uint32_t)((64 - weight) | (weight << 8));
+    }
+    table->yIndex.resize(dstHeight);
+    table->yWeight.resize(dstHeight);
+    for (int y = 0; y < dstHeight; y++) {
+        mapAxis(srcHeight, dstHeight, y, &index, &weight);
+        table->yIndex[y] = index;
+        table->yWeight[y] = weight;
+    }
+}
+
+FilterChain::Planes FilterChain::planesOf(AVFrame* frame, int width, int height) {
+    Planes planes = {};
+    for (int i = 0; i < 3; i++) {
+        planes.data[i] = frame->data[i];
+        planes.linesize[i] = frame->linesize[i];
+    }
+    planes.width = width;
+    planes.height = height;
+    return planes;
+}
+
+void FilterChain::runTiles(int height, const std::function<void(int, int, int)>& fn) {
+    int tiles = (height + kTileRows - 1) / kTileRows;
+    auto runTile = [&fn, height](int tile) {
+        int y0 = tile * kTileRows;
+        int y1 = std::min(height, y0 + kTileRows);
+        fn(0, y0, y1);
+        fn(1, y0 / 2, y1 / 2);
+        fn(2, y0 / 2, y1 / 2);
+    };
+
+    // 第一块在当前线程做，其余交给线程池；各块写入的行互不重叠
+    for (int tile = 1; tile < tiles; tile++) {
+        m_pool.start([&runTile, tile]() { runTile(tile); });
+    }
+    if (tiles > 0) runTile(0);
+    m_pool.waitForDone();
+}
+
+void FilterChain::runStage(Stage& stage, const Planes& src, const Planes& dst) {
+    const Kernels& k = kernels(m_avx2);
+    runTiles(stage.outHeight, [&](int plane, int y0, int y1) {
+        const int shift = plane ? 1 : 0;
+        const int srcWidth = src.width >> shift;
+        const int srcHeight = src.height >> shift;
+        const int dstWidth = stage.outWidth >> shift;
+        const uint8_t* in = src.data[plane];
+        const int inStride = src.linesize[plane];
+        uint8_t* out = dst.data[plane];
+        const int outStride = dst.linesize[plane];
+
+        if (stage.type == Half) {
+            for (int y = y0; y < y1; y++) {
+                k.halfRow(out + (size_t)y * outStride, in + (size_t)(2 * y) * inStride,
+                    in + (size_t)(2 * y + 1) * inStride, dstWidth);
+            }
+            return;
+        }
+
+        // 双线性：先纵向插值到临时行，再按坐标表横向取点
+        const ScaleTable& table = stage.table[plane ? 1 : 0];
+        thread_local std::vector<uint8_t> row;
+        if ((int)row.size() < srcWidth + kRowPadding) row.assign(srcWidth + kRowPadding, 0);
+        for (int y = y0; y < y1; y++) {
+            int top = table.yIndex[y];
+            int bottom = std::min(top + 1, srcHeight - 1);
+            k.lerpRow(row.data(), in + (size_t)top * inStride, in + (size_t)bottom * inStride, srcWidth, table.yWeight[y]);
+            k.hscaleRow(out + (size_t)y * outStride, row.data(), table.xIndex.data(), table.xWeight.data(), dstWidth);
+        }
+    });
+}
+
+int FilterChain::process(const uint8_t* src, AVFrame* dst) {
+    const Kernels& k = kernels(m_avx2);
+    const int ySize = m_inWidth * m_inHeight;
+    Planes out = planesOf(dst, m_outWidth, m_outHeight);
+    Planes cur = {};
+    int lastWriter = -1;
+    int ret = 0;
+
+    cur.data[0] = (uint8_t*)src;
+    cur.data[1] = (uint8_t*)src + ySize;
+    cur.data[2] = (uint8_t*)src + ySize * 5 / 4;
+    cur.linesize[0] = m_inWidth;
+    cur.linesize[1] = m_inWidth / 2;
+    cur.linesize[2] = m_inWidth / 2;
+    cur.width = m_inWidth;
+    cur.height = m_inHeight;
+
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        if (m_stages[i].type != Crop) lastWriter = (int)i;
+    }
+
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        Stage& stage = m_stages[i];
+        if (stage.type == Crop) {
+            // 裁剪只移动平面起点，不拷贝
+            cur.data[0] += (size_t)stage.y * cur.linesize[0] + stage.x;
+            cur.data[1] += (size_t)(stage.y / 2) * cur.linesize[1] + stage.x / 2;
+            cur.data[2] += (size_t)(stage.y / 2) * cur.linesize[2] + stage.x / 2;
+            cur.width = stage.outWidth;
+            cur.height = stage.outHeight;
+            continue;
+        }
+        Planes next = (int)i == lastWriter ? out : planesOf(stage.buffer, stage.outWidth, stage.outHeight);
+        runStage(stage, cur, next);
+        cur = next;
+    }
+
+    // 没有缩放时按块把（裁剪后的）输入拷进编码帧
+    if (lastWriter < 0) {
+        runTiles(m_outHeight, [&](int plane, int y0, int y1) {
+            const int width = plane ? m_outWidth / 2 : m_outWidth;
+            for (int y = y0; y < y1; y++) {
+                k.copyRow(out.data[plane] + (size_t)y * out.linesize[plane],
+                    cur.data[plane] + (size_t)y * cur.linesize[plane], width);
+            }
+        });
+    }
+
+    if (m_denoise > 0) {
+        // 首帧没有历史，原样输出
+        if (m_history->buf[0]) {
+            Planes prev = planesOf(m_history, m_outWidth, m_outHeight);
+            runTiles(m_outHeight, [&](int plane, int y0, int y1) {
+                const int width = plane ? m_outWidth / 2 : m_outWidth;
+                for (int y = y0; y < y1; y++) {
+                    k.denoiseRow(out.data[plane] + (size_t)y * out.linesize[plane],
+                        prev.data[plane] + (size_t)y * prev.linesize[plane], width, m_denoise);
+                }
+            });
+        }
+        // 只增加引用计数；编码循环发现这帧不可写后会从池里换一块新缓冲
+        av_frame_unref(m_history);
+        ret = av_frame_ref(m_history, dst);
+        if (ret < 0) return ret;
+    }
+    return 0;
+}
+
+void FilterChain::reset() {
+    av_frame_unref(m_history);
+}
+
+QString FilterChain::describe() const {
+    QStringList parts;
+    for (const Stage& stage : m_stages) {
+        switch (stage.type) {
+        case Crop:
+            parts << QString("crop %1x%2+%3+%4").arg(stage.outWidth).arg(stage.outHeight).arg(stage.x).arg(stage.y);
+            break;
+        case Half:
+            parts << QString("half %1x%2").arg(stage.outWidth).arg(stage.outHeight);
+            break;
+        case Bilinear:
+            parts << QString("bilinear %1x%2").arg(stage.outWidth).arg(stage.outHeight);
+            break;
+        }
+    }
+    if (m_denoise > 0) parts << QString("denoise %1").arg(m_denoise);
+    return QString("%1x%2 -> %3 (%4, %5 threads)").arg(m_inWidth).arg(m_inHeight)
+        .arg(parts.join(" -> ")).arg(m_avx2 ? "AVX2" : "scalar").arg(m_pool.maxThreadCount());
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include <QString>
+#include <QThreadPool>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "FrameMemory.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// 编码前滤镜链：在读入原始帧和 avcodec_send_frame 之间裁剪、缩小、时域降噪，
+// 省掉先用 ffmpeg 单独跑一遍滤镜、再写读一遍整个文件。描述语法与 -vf 相同：
+//   crop=w:h[:x:y]   裁剪，只移动平面指针不拷贝；x/y 缺省为居中
+//   scale=w:h        缩放：先按 2:1 盒式滤波逐级对半，剩下的比例用双线性
+//   denoise[=s]      时域降噪：与上一输出帧相差不超过 s（默认 6）的像素取平均
+// 每一级按行分块在线程池里并行；最后一级直接写进编码器的池化帧，降噪在该帧上原地进行。
+// 内核有 AVX2 和标量两套，运行时按 CPU 选择。只处理 YUV420P，尺寸都取偶数
+class FilterChain {
+public:
+    FilterChain();
+    ~FilterChain();
+
+    // 解析描述并按输入尺寸推出输出尺寸；描述为空时不做任何处理
+    bool configure(const QString& spec, int inWidth, int inHeight, QString* error);
+    bool isEmpty() const { return m_stages.empty() && m_denoise <= 0; }
+    int outputWidth() const { return m_outWidth; }
+    int outputHeight() const { return m_outHeight; }
+    bool usesAvx2() const { return m_avx2; }
+    QString describe() const;
+
+    // src 为连续存放的一帧 YUV420P（输入尺寸），结果写入 dst（输出尺寸，已分配好缓冲）
+    int process(const uint8_t* src, AVFrame* dst);
+    // 丢弃降噪历史帧
+    void reset();
+
+private:
+    enum StageType { Crop, Half, Bilinear };
+
+    struct Planes {
+        uint8_t* data[3];
+        int linesize[3];
+        int width;     // 亮度尺寸，色度为一半
+        int height;
+    };
+
+    // 双线性的坐标表：源下标和 6 位定点权重，亮度和色度各一份
+    struct ScaleTable {
+        std::vector<int32_t> xIndex;
+        std::vector<uint32_t> xWeight;   // 字节 [64-fx, fx, 0, 0]，直接喂给 maddubs
+        std::vector<int32_t> yIndex;
+        std::vector<int> yWeight;
+        int srcWidth = 0;
+    };
+
+    struct Stage {
+        StageType type = Crop;
+        int inWidth = 0;
+        int inHeight = 0;
+        int outWidth = 0;
+        int outHeight = 0;
+        int x = 0;                       // 裁剪起点
+        int y = 0;
+        AVFrame* buffer = nullptr;       // 中间结果，最后一级直接写 dst，不分配
+        ScaleTable table[2];
+    };
+
+    void clear();
+    void addScale(int width, int height, int* curWidth, int* curHeight);
+    static void buildTable(ScaleTable* table, int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+    static Planes planesOf(AVFrame* frame, int width, int height);
+    // 按行分块并行：fn(平面号, 起始行, 结束行)，色度行号已折半
+    void runTiles(int height, const std::function<void(int, int, int)>& fn);
+    void runStage(Stage& stage, const Planes& src, const Planes& dst);
+
+    std::vector<Stage> m_stages;
+    int m_inWidth = 0;
+    int m_inHeight = 0;
+    int m_outWidth = 0;
+    int m_outHeight = 0;
+    int m_denoise = 0;                   // 降噪阈值，0 表示关闭
+    bool m_avx2 = false;
+    AVFrame* m_history = nullptr;        // 上一输出帧（引用编码器池中的缓冲，不拷贝）
+    std::vector<std::unique_ptr<FrameBufferPool>> m_bufferPools;   // 每个中间尺寸一个
+    QThreadPool m_pool;
+};
\ No newline at end of file
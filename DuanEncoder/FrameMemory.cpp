@@ -0,0 +1,422 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "FrameMemory.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/error.h>
+}
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#endif
+
+namespace {
+std::atomic<bool> g_hugePages{ true };
+const size_t kHugePageSize = 2 * 1024 * 1024;
+// 防止基准测试里的遍历被优化掉
+volatile uint64_t g_benchSink = 0;
+
+size_t roundUp(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+#ifdef _WIN32
+// 大页需要“锁定内存页”权限（SeLockMemoryPrivilege），账户没有该权限时退回普通页
+bool enableLockMemoryPrivilege() {
+    static const bool enabled = [] {
+        HANDLE token = NULL;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return false;
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool ok = LookupPrivilegeValueW(NULL, L"SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)
+            && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+            && GetLastError() == ERROR_SUCCESS;
+        CloseHandle(token);
+        return ok;
+    }();
+    return enabled;
+}
+#else
+// 把映射绑定到一个 NUMA 节点，须在首次访问之前调用。直接走系统调用，不依赖 libnuma
+void bindToNode(void* ptr, size_t bytes, int node) {
+#ifdef SYS_mbind
+    if (node < 0 || node >= (int)(sizeof(unsigned long) * 8)) return;
+    unsigned long mask = 1UL << node;
+    const int kMpolBind = 2;  // numaif.h 中的 MPOL_BIND
+    syscall(SYS_mbind, ptr, bytes, kMpolBind, &mask, sizeof(mask) * 8, 0);
+#else
+    (void)ptr;
+    (void)bytes;
+    (void)node;
+#endif
+}
+#endif
+
+// 用户态 dTLB 读缺失计数（Linux perf_event），其他平台或没有权限时不可用
+class TlbCounter {
+public:
+    TlbCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~TlbCounter() {
+#ifdef __linux__
+        if (m_fd >= 0) close(m_fd);
+#endif
+    }
+    bool valid() const { return m_fd >= 0; }
+    void start() {
+#ifdef __linux__
+        if (m_fd < 0) return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    int64_t stop() {
+        int64_t count = -1;
+#ifdef __linux__
+        if (m_fd < 0) return -1;
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+        return count;
+    }
+
+private:
+    int m_fd = -1;
+};
+}
+
+namespace FrameMemory {
+void setHugePagesEnabled(bool enabled) {
+    g_hugePages.store(enabled, std::memory_order_relaxed);
+}
+
+bool hugePagesEnabled() {
+    return g_hugePages.load(std::memory_order_relaxed);
+}
+
+const char* pageModeName(PageMode mode) {
+    switch (mode) {
+    case ExplicitHugePages:    return "explicit huge pages";
+    case TransparentHugePages: return "transparent huge pages";
+    default:                   return "4 KB pages";
+    }
+}
+
+void* allocate(size_t bytes, int numaNode, PageMode* mode) {
+    // 统一按 2 MB 取整，release 时用同样的规则算出映射长度
+    size_t rounded = roundUp(std::max<size_t>(bytes, 1), kHugePageSize);
+    bool huge = hugePagesEnabled();
+    PageMode used = SmallPages;
+    void* ptr = nullptr;
+
+#ifdef _WIN32
+    DWORD node = numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE;
+    SIZE_T large = GetLargePageMinimum();
+    if (huge && large > 0 && enableLockMemoryPrivilege()) {
+        ptr = VirtualAllocExNuma(GetCurrentProcess(), NULL, roundUp(bytes, large),
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+        if (ptr) used = ExplicitHugePages;
+    }
+    if (!ptr) {
+        ptr = VirtualAllocExNuma(GetCurrentProcess(), NULL, rounded, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+        if (!ptr) return nullptr;
+        // 提前触碰每一页，缺页发生在这里而不是编码循环里
+        memset(ptr, 0, rounded);
+    }
+#else
+#ifdef MAP_HUGETLB
+    if (huge) {
+        // 显式大页需要系统预留（vm.nr_hugepages），没有时 mmap 直接失败
+        void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            ptr = p;
+            used = ExplicitHugePages;
+        }
+    }
+#endif
+    if (!ptr) {
+        // 多映射一个大页再裁掉首尾，起始地址按 2 MB 对齐，透明大页才能整页映射
+        size_t span = rounded + kHugePageSize;
+        uint8_t* base = (uint8_t*)mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == (uint8_t*)MAP_FAILED) return nullptr;
+        uint8_t* aligned = (uint8_t*)roundUp((size_t)base, kHugePageSize);
+        if (aligned > base) munmap(base, aligned - base);
+        size_t tail = (size_t)((base + span) - (aligned + rounded));
+        if (tail > 0) munmap(aligned + rounded, tail);
+        ptr = aligned;
+#ifdef MADV_HUGEPAGE
+        if (huge) {
+            if (madvise(ptr, rounded, MADV_HUGEPAGE) == 0) used = TransparentHugePages;
+        }
+        else {
+            // 对比基线：即使系统 THP 设为 always 也只用普通页
+            madvise(ptr, rounded, MADV_NOHUGEPAGE);
+        }
+#endif
+    }
+    bindToNode(ptr, rounded, numaNode);
+    // 提前触碰每一页：缺页和大页合并发生在这里，首次访问也落在绑定的节点上
+    memset(ptr, 0, rounded);
+#endif
+
+    if (mode) *mode = used;
+    return ptr;
+}
+
+void release(void* ptr, size_t bytes) {
+    if (!ptr) return;
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, roundUp(std::max<size_t>(bytes, 1), kHugePageSize));
+#endif
+}
+
+int numaNodeCount() {
+#ifdef _WIN32
+    ULONG highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest)) return 1;
+    return (int)highest + 1;
+#else
+    QDir dir("/sys/devices/system/node");
+    return std::max(1, (int)dir.entryList(QStringList() << "node*", QDir::Dirs).size());
+#endif
+}
+
+bool pinCurrentThreadToNode(int node) {
+    if (node < 0) return false;
+#ifdef _WIN32
+    // Windows 上新线程不继承创建者的亲和性，只绑定调用线程自身；要带上新线程用 pinNewThreadsToNode
+    GROUP_AFFINITY affinity = {};
+    if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity) || affinity.Mask == 0) return false;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) != 0;
+#else
+    QFile file(QString("/sys/devices/system/node/node%1/cpulist").arg(node));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    // 格式如 "0-7,16-23"
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const QByteArray& range : file.readAll().trimmed().split(',')) {
+        QList<QByteArray> ends = range.split('-');
+        bool ok = false;
+        int first = ends[0].toInt(&ok);
+        if (!ok) continue;
+        int last = ends.size() > 1 ? ends[1].toInt() : first;
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    // pid 为 0 表示调用线程
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+bool pinNewThreadsToNode(int node, uint64_t* previous) {
+    *previous = 0;
+    if (!pinCurrentThreadToNode(node)) return false;
+#ifdef _WIN32
+    GROUP_AFFINITY affinity = {};
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    USHORT groups[4] = { 0 };
+    USHORT groupCount = 4;
+    HANDLE process = GetCurrentProcess();
+
+    // 进程亲和性掩码只作用于进程所在的那个处理器组
+    if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity)) return false;
+    if (!GetProcessGroupAffinity(process, &groupCount, groups) || groupCount != 1 || groups[0] != affinity.Group) return false;
+    if (!GetProcessAffinityMask(process, &processMask, &systemMask)) return false;
+    if (!SetProcessAffinityMask(process, affinity.Mask)) return false;
+    *previous = processMask;
+#endif
+    return true;
+}
+
+void restoreProcessAffinity(uint64_t previous) {
+#ifdef _WIN32
+    if (previous) SetProcessAffinityMask(GetCurrentProcess(), (DWORD_PTR)previous);
+#else
+    (void)previous;
+#endif
+}
+
+QString runBenchmark(int width, int height, int frames, int numaNode) {
+    QStringList lines;
+    bool saved = hugePagesEnabled();
+    size_t frame_bytes = (size_t)width * height * 3 / 2;
+    bool counter_valid = false;
+
+    if (numaNode >= 0 && !pinCurrentThreadToNode(numaNode)) {
+        lines << QString("warning: unable to pin to NUMA node %1").arg(numaNode);
+    }
+    lines << QString("frame path: %1x%2 YUV420P, %3 frames, NUMA node %4")
+        .arg(width).arg(height).arg(frames).arg(numaNode >= 0 ? QString::number(numaNode) : QString("any"));
+    lines << QString("%1 %2 %3 %4").arg("pages", -24).arg("ms/frame", 9).arg("copy GB/s", 10).arg("dTLB misses/frame", 18);
+
+    for (int pass = 0; pass < 2; pass++) {
+        setHugePagesEnabled(pass == 1);
+        uint8_t* src = (uint8_t*)allocate(frame_bytes, numaNode);
+        AVFrame* frame = av_frame_alloc();
+        FrameBufferPool pool;
+        if (!src || !frame || pool.init(width, height, AV_PIX_FMT_YUV420P, numaNode) < 0 || pool.getFrame(frame) < 0) {
+            lines << "allocation failed";
+            av_frame_free(&frame);
+            release(src, frame_bytes);
+            continue;
+        }
+        for (size_t i = 0; i < frame_bytes; i++) {
+            src[i] = (uint8_t)((i * 2654435761u) >> 24);
+        }
+
+        TlbCounter counter;
+        QElapsedTimer timer;
+        uint64_t checksum = 0;
+        counter.start();
+        timer.start();
+        for (int f = 0; f < frames; f++) {
+            // 与编码循环相同：把读入的一帧逐行拷进编码帧的各平面
+            const uint8_t* plane = src;
+            for (int p = 0; p < 3; p++) {
+                int plane_w = p ? width / 2 : width;
+                int plane_h = p ? height / 2 : height;
+                for (int y = 0; y < plane_h; y++) {
+                    memcpy(frame->data[p] + (size_t)y * frame->linesize[p], plane + (size_t)y * plane_w, plane_w);
+                }
+                plane += (size_t)plane_w * plane_h;
+            }
+            // 按宏块列自上而下遍历亮度（运动搜索、块分析的典型顺序），每一步跨一整行，最考验 TLB
+            const uint8_t* luma = frame->data[0];
+            for (int x = 0; x + 16 <= width; x += 16) {
+                for (int y = 0; y < height; y++) {
+                    checksum += luma[(size_t)y * frame->linesize[0] + x];
+                }
+            }
+        }
+        double ms = timer.nsecsElapsed() / 1e6;
+        int64_t misses = counter.stop();
+        counter_valid = counter_valid || counter.valid();
+        g_benchSink = g_benchSink + checksum;
+
+        double per_frame = frames > 0 ? ms / frames : 0.0;
+        double gbps = ms > 0 ? frame_bytes * (double)frames / (ms / 1000.0) / 1e9 : 0.0;
+        lines << QString("%1 %2 %3 %4").arg(pageModeName(pool.pageMode()), -24)
+            .arg(per_frame, 9, 'f', 2).arg(gbps, 10, 'f', 2)
+            .arg(misses >= 0 ? QString::number(misses / std::max(1, frames)) : QString("n/a"), 18);
+
+        av_frame_free(&frame);
+        pool.uninit();
+        release(src, frame_bytes);
+    }
+    setHugePagesEnabled(saved);
+
+    if (!counter_valid) {
+        lines << "dTLB counter unavailable (Linux perf_event only; check /proc/sys/kernel/perf_event_paranoid)";
+    }
+    return lines.join('\n');
+}
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    uninit();
+}
+
+int FrameBufferPool::init(int width, int height, AVPixelFormat format, int numaNode) {
+    ptrdiff_t linesizes[4] = { 0 };
+    size_t sizes[4] = { 0 };
+    int ret = 0;
+
+    uninit();
+    m_width = width;
+    m_height = height;
+    m_format = format;
+    m_numaNode = numaNode;
+
+    ret = av_image_fill_linesizes(m_linesize, format, width);
+    if (ret < 0) return ret;
+    for (int i = 0; i < 4; i++) {
+        m_linesize[i] = (int)roundUp(m_linesize[i], FrameMemory::kAlign);
+        linesizes[i] = m_linesize[i];
+    }
+    ret = av_image_fill_plane_sizes(sizes, format, height, linesizes);
+    if (ret < 0) return ret;
+
+    // 各平面首地址也按 64 字节对齐
+    m_size = 0;
+    for (int i = 0; i < 4; i++) {
+        m_offset[i] = m_size;
+        m_size += roundUp(sizes[i], FrameMemory::kAlign);
+    }
+
+    m_pool = av_buffer_pool_init2(m_size, this, &FrameBufferPool::allocBuffer, NULL);
+    return m_pool ? 0 : AVERROR(ENOMEM);
+}
+
+void FrameBufferPool::uninit() {
+    // 仍被编码器引用的缓冲在最后一个引用释放时才归还，释放回调不依赖本对象
+    av_buffer_pool_uninit(&m_pool);
+}
+
+int FrameBufferPool::getFrame(AVFrame* frame) {
+    if (!m_pool) return AVERROR(EINVAL);
+    AVBufferRef* buf = av_buffer_pool_get(m_pool);
+    if (!buf) return AVERROR(ENOMEM);
+
+    frame->buf[0] = buf;
+    frame->format = m_format;
+    frame->width = m_width;
+    frame->height = m_height;
+    for (int i = 0; i < 4 && m_linesize[i] > 0; i++) {
+        frame->data[i] = buf->data + m_offset[i];
+        frame->linesize[i] = m_linesize[i];
+    }
+    return 0;
+}
+
+AVBufferRef* FrameBufferPool::allocBuffer(void* opaque, size_t size) {
+    FrameBufferPool* pool = (FrameBufferPool*)opaque;
+    FrameMemory::PageMode mode = FrameMemory::SmallPages;
+    void* ptr = FrameMemory::allocate(size, pool->m_numaNode, &mode);
+    if (!ptr) return NULL;
+    pool->m_mode.store(mode, std::memory_order_relaxed);
+
+    // 释放时只需要长度，直接放在 opaque 里
+    AVBufferRef* buf = av_buffer_create((uint8_t*)ptr, size, &FrameBufferPool::freeBuffer, (void*)(uintptr_t)size, 0);
+    if (!buf) {
+        FrameMemory::release(ptr, size);
+    }
+    return buf;
+}
+
+void FrameBufferPool::freeBuffer(void* opaque, uint8_t* data) {
+    FrameMemory::release(data, (size_t)(uintptr_t)opaque);
+}
\ No newline at end of file
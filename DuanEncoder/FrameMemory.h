@@ -0,0 +1,72 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+// 大帧（4K/8K）缓冲区：优先用大页（先试显式大页，再退到透明大页），按 64 字节对齐，可绑定到 NUMA 节点。
+// 一帧 8K YUV420P 约 48 MB，用 4 KB 页要一万多个 TLB 项，换成 2 MB 页只要二十几个
+namespace FrameMemory {
+enum PageMode {
+    SmallPages = 0,
+    TransparentHugePages = 1,   // Linux THP（madvise），由内核尽量合并
+    ExplicitHugePages = 2,      // Linux MAP_HUGETLB / Windows MEM_LARGE_PAGES
+};
+
+const int kAlign = 64;
+
+// 进程级开关，关闭后只用普通页，便于对比
+void setHugePagesEnabled(bool enabled);
+bool hugePagesEnabled();
+
+// numaNode < 0 表示不绑定节点；失败返回 nullptr
+void* allocate(size_t bytes, int numaNode, PageMode* mode = nullptr);
+void release(void* ptr, size_t bytes);
+const char* pageModeName(PageMode mode);
+
+int numaNodeCount();
+// 把当前线程绑到节点的 CPU 上。Linux 上之后由该线程创建的线程（如 x264 的工作线程）继承这个绑定，
+// Windows 上不继承
+bool pinCurrentThreadToNode(int node);
+// 让进程之后新建的线程也落在节点上：Linux 上即绑定当前线程；Windows 上新线程取进程的亲和性，
+// 改的是整个进程（节点须在进程所在的处理器组内）。previous 保存原来的进程掩码，交给 restoreProcessAffinity
+bool pinNewThreadsToNode(int node, uint64_t* previous);
+void restoreProcessAffinity(uint64_t previous);
+
+// 4K 帧处理路径（拷贝进编码帧 + 按宏块列遍历）在普通页和大页下的吞吐与 dTLB 缺失对比，结果按行输出
+QString runBenchmark(int width, int height, int frames, int numaNode);
+}
+
+// 按帧尺寸分配的 AVBufferPool，缓冲来自 FrameMemory。每个平面的行宽和起始地址都按 64 字节对齐；
+// 编码器放开引用后缓冲回到池里复用，不会退回 av_frame_get_buffer 的普通分配
+class FrameBufferPool {
+public:
+    FrameBufferPool() = default;
+    ~FrameBufferPool();
+
+    int init(int width, int height, AVPixelFormat format, int numaNode);
+    void uninit();
+    // frame 须为空帧，取一块空闲缓冲并填好 data/linesize
+    int getFrame(AVFrame* frame);
+    FrameMemory::PageMode pageMode() const { return (FrameMemory::PageMode)m_mode.load(std::memory_order_relaxed); }
+
+private:
+    static AVBufferRef* allocBuffer(void* opaque, size_t size);
+    static void freeBuffer(void* opaque, uint8_t* data);
+
+    AVBufferPool* m_pool = nullptr;
+    int m_width = 0;
+    int m_height = 0;
+    AVPixelFormat m_format = AV_PIX_FMT_NONE;
+    int m_numaNode = -1;
+    int m_linesize[4] = { 0 };
+    size_t m_offset[4] = { 0 };
+    size_t m_size = 0;
+    std::atomic<int> m_mode{ FrameMemory::SmallPages };
+};
\ No newline at end of file
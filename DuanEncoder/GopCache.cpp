@@ -0,0 +1,274 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "GopCache.h"
+#include <QMutexLocker>
+
+GopCache::GopCache(size_t budgetBytes) : m_budget(budgetBytes) {}
+
+GopCache::~GopCache() {
+    clear();
+}
+
+void GopCache::setBudget(size_t budgetBytes) {
+    QMutexLocker locker(&m_mutex);
+    m_budget = budgetBytes;
+    evictLocked(0);
+}
+
+size_t GopCache::budget() const {
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+bool GopCache::contains(int gopIndex) const {
+    QMutexLocker locker(&m_mutex);
+    return m_index.find(gopIndex) != m_index.end();
+}
+
+bool GopCache::lookup(int gopIndex, int frameInGop, AVFrame* dst) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_index.find(gopIndex);
+    if (it == m_index.end() || frameInGop < 0 ||
+        frameInGop >= (int)it->second->frames.size()) {
+        m_misses++;
+        return false;
+    }
+
+    // 移到表头，标记为最近使用
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    if (av_frame_ref(dst, it->second->frames[frameInGop]) < 0) {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    return true;
+}
+
+void GopCache::insert(int gopIndex, std::vector<AVFrame*>& frames) {
+    Entry entry;
+    entry.gopIndex = gopIndex;
+    for (AVFrame* f : frames) {
+        entry.bytes += frameBytes(f);
+    }
+    entry.frames.swap(frames);
+
+    QMutexLocker locker(&m_mutex);
+    // 单个GOP超过预算时不缓存
+    if (entry.bytes > m_budget) {
+        freeFrames(entry.frames);
+        return;
+    }
+
+    auto it = m_index.find(gopIndex);
+    if (it != m_index.end()) {
+        m_used -= it->second->bytes;
+        freeFrames(it->second->frames);
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+
+    evictLocked(entry.bytes);
+    m_used += entry.bytes;
+    m_lru.push_front(std::move(entry));
+    m_index[gopIndex] = m_lru.begin();
+}
+
+void GopCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    for (Entry& e : m_lru) {
+        freeFrames(e.frames);
+    }
+    m_lru.clear();
+    m_index.clear();
+    m_used = 0;
+    m_hits = 0;
+    m_misses = 0;
+}
+
+size_t GopCache::memoryUsed() const {
+    QMutexLocker locker(&m_mutex);
+    return m_used;
+}
+
+int GopCache::gopCount() const {
+    QMutexLocker locker(&m_mutex);
+    return (int)m_lru.size();
+}
+
+double GopCache::hitRate() const {
+    QMutexLocker locker(&m_mutex);
+    uint64_t total = m_hits + m_misses;
+    return total ? (double)m_hits / total : 0.0;
+}
+
+uint64_t GopCache::hits() const {
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+uint64_t GopCache::misses() const {
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+size_t GopCache::frameBytes(const AVFrame* frame) {
+    size_t bytes = 0;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+        bytes += frame->buf[i]->size;
+    }
+    return bytes;
+}
+
+void GopCache::freeFrames(std::vector<AVFrame*>& frames) {
+    for (AVFrame*& f : frames) {
+        av_frame_free(&f);
+    }
+    frames.clear();
+}
+
+void GopCache::evictLocked(size_t incoming) {
+    while (!m_lru.empty() && m_used + incoming > m_budget) {
+        Entry& victim = m_lru.back();
+        m_used -= victim.bytes;
+        freeFrames(victim.frames);
+        m_index.erase(victim.gopIndex);
+        m_lru.pop_back();
+    }
+}
+
+GopDecoder::~GopDecoder() {
+    close();
+}
+
+int GopDecoder::open(const QString& path) {
+    const AVCodec* codec = nullptr;
+    int ret = 0;
+    m_fmtCtx = avformat_alloc_context();
+    if (!m_fmtCtx) return AVERROR(ENOMEM);
+    m_fmtCtx->interrupt_callback = m_interrupt;
+
+    ret = avformat_open_input(&m_fmtCtx, path.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0) goto fail;
+
+    ret = avformat_find_stream_info(m_fmtCtx, nullptr);
+    if (ret < 0) goto fail;
+
+    ret = av_find_best_stream(m_fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (ret < 0) goto fail;
+    m_streamIndex = ret;
+
+    m_codecCtx = avcodec_alloc_context3(codec);
+    if (!m_codecCtx) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = avcodec_parameters_to_context(m_codecCtx, m_fmtCtx->streams[m_streamIndex]->codecpar);
+    if (ret < 0) goto fail;
+
+    // 与播放解码器保持相同的降分辨率设置，缓存帧尺寸一致
+    m_codecCtx->lowres = m_lowres;
+    ret = avcodec_open2(m_codecCtx, codec, nullptr);
+    if (ret < 0) goto fail;
+
+    m_pkt = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    if (!m_pkt || !m_frame) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    // 裸流按字节定位最准确，MP4等容器按DTS定位
+    m_byteSeek = !(m_fmtCtx->iformat->flags & AVFMT_NO_BYTE_SEEK);
+    return 0;
+
+fail:
+    close();
+    return ret;
+}
+
+void GopDecoder::close() {
+    if (m_frame) av_frame_free(&m_frame);
+    if (m_pkt) av_packet_free(&m_pkt);
+    if (m_codecCtx) avcodec_free_context(&m_codecCtx);
+    if (m_fmtCtx) avformat_close_input(&m_fmtCtx);
+    m_streamIndex = -1;
+}
+
+int GopDecoder::receiveFrames(std::vector<AVFrame*>& frames) {
+    while (1) {
+        int ret = avcodec_receive_frame(m_codecCtx, m_frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+        if (ret < 0) return ret;
+
+        // 只增加引用计数，不拷贝像素数据
+        AVFrame* clone = av_frame_clone(m_frame);
+        av_frame_unref(m_frame);
+        if (!clone) return AVERROR(ENOMEM);
+        frames.push_back(clone);
+    }
+}
+
+int GopDecoder::decode(const GopInfo& gop, std::vector<AVFrame*>& frames) {
+    int ret = 0;
+    int sent = 0;
+    bool started = false;
+
+    if (!isOpen()) return AVERROR(EINVAL);
+
+    if (m_byteSeek) {
+        ret = av_seek_frame(m_fmtCtx, -1, gop.pos, AVSEEK_FLAG_BYTE);
+    }
+    else {
+        ret = av_seek_frame(m_fmtCtx, m_streamIndex, gop.dts, AVSEEK_FLAG_BACKWARD);
+    }
+    if (ret < 0) return ret;
+    avcodec_flush_buffers(m_codecCtx);
+
+    while (sent < gop.frameCount) {
+        ret = av_read_frame(m_fmtCtx, m_pkt);
+        if (ret < 0) break;
+
+        if (m_pkt->stream_index != m_streamIndex) {
+            av_packet_unref(m_pkt);
+            continue;
+        }
+
+        // 定位点可能早于目标GOP，跳过直到其起始关键帧
+        if (!started) {
+            bool reached = m_byteSeek ? (m_pkt->pos >= gop.pos) : (m_pkt->dts >= gop.dts);
+            if (!reached || (!(m_pkt->flags & AV_PKT_FLAG_KEY) && gop.firstFrame > 0)) {
+                av_packet_unref(m_pkt);
+                continue;
+            }
+            started = true;
+        }
+
+        ret = avcodec_send_packet(m_codecCtx, m_pkt);
+        av_packet_unref(m_pkt);
+        if (ret < 0) break;
+        sent++;
+
+        ret = receiveFrames(frames);
+        if (ret < 0) break;
+    }
+
+    // 冲刷出GOP剩余的帧，再复位解码器供下次使用
+    if (ret >= 0 || ret == AVERROR_EOF) {
+        avcodec_send_packet(m_codecCtx, nullptr);
+        ret = receiveFrames(frames);
+    }
+    avcodec_flush_buffers(m_codecCtx);
+
+    if (ret < 0) {
+        GopCache::freeFrames(frames);
+        return ret;
+    }
+    if (frames.empty()) return AVERROR_INVALIDDATA;
+
+    // 闭合GOP的输出帧数不会超过包数
+    while ((int)frames.size() > gop.frameCount) {
+        av_frame_free(&frames.back());
+        frames.pop_back();
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <QString>
+#include <QMutex>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+}
+
+// GOP 索引项，播放时按读到的关键帧包逐个记录
+struct GopInfo {
+    int64_t pos = -1;               // 关键帧包在文件中的字节位置
+    int64_t dts = AV_NOPTS_VALUE;   // 关键帧包的DTS（不支持按字节定位的格式使用）
+    int firstFrame = 0;             // GOP首帧的显示序号
+    int frameCount = 0;             // GOP内的帧数（视频包数）
+};
+
+// 已解码GOP的LRU缓存，保存引用计数的AVFrame，按内存预算淘汰
+class GopCache {
+public:
+    explicit GopCache(size_t budgetBytes = 512u * 1024 * 1024);
+    ~GopCache();
+
+    void setBudget(size_t budgetBytes);
+    size_t budget() const;
+
+    bool contains(int gopIndex) const;
+    // 命中时把帧引用到dst，并更新LRU顺序
+    bool lookup(int gopIndex, int frameInGop, AVFrame* dst);
+    // 接管frames中帧的所有权，调用后frames被清空
+    void insert(int gopIndex, std::vector<AVFrame*>& frames);
+    void clear();
+
+    size_t memoryUsed() const;
+    int gopCount() const;
+    double hitRate() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+    static size_t frameBytes(const AVFrame* frame);
+    static void freeFrames(std::vector<AVFrame*>& frames);
+
+private:
+    struct Entry {
+        int gopIndex = -1;
+        std::vector<AVFrame*> frames;
+        size_t bytes = 0;
+    };
+
+    void evictLocked(size_t incoming);
+
+    mutable QMutex m_mutex;
+    std::list<Entry> m_lru;   // 表头为最近使用
+    std::unordered_map<int, std::list<Entry>::iterator> m_index;
+    size_t m_budget;
+    size_t m_used = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+// 独立的解复用+解码器，按GOP索引定位并整段解码，供同步取帧和后台预取使用
+class GopDecoder {
+public:
+    GopDecoder() = default;
+    ~GopDecoder();
+
+    void setLowres(int lowres) { m_lowres = lowres; }
+    // 挂到解复用上下文，停止播放时打开和读包可以立即返回
+    void setInterruptCallback(const AVIOInterruptCB& cb) { m_interrupt = cb; }
+    int open(const QString& path);
+    void close();
+    bool isOpen() const { return m_codecCtx != nullptr; }
+
+    int decode(const GopInfo& gop, std::vector<AVFrame*>& frames);
+
+private:
+    int receiveFrames(std::vector<AVFrame*>& frames);
+
+    AVFormatContext* m_fmtCtx = nullptr;
+    AVCodecContext* m_codecCtx = nullptr;
+    AVPacket* m_pkt = nullptr;
+    AVFrame* m_frame = nullptr;
+    int m_streamIndex = -1;
+    int m_lowres = 0;
+    bool m_byteSeek = true;
+    AVIOInterruptCB m_interrupt{ nullptr, nullptr };
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "JobControl.h"
+#include <QMutexLocker>
+
+JobControl::JobControl() : m_state(Running), m_graceMs(0), m_cancelNs(-1) {
+    m_clock.start();
+}
+
+void JobControl::reset() {
+    QMutexLocker locker(&m_mutex);
+    m_cancelNs.store(-1, std::memory_order_relaxed);
+    m_state.store(Running, std::memory_order_release);
+}
+
+void JobControl::pause() {
+    int expected = Running;
+    m_state.compare_exchange_strong(expected, Paused, std::memory_order_acq_rel);
+}
+
+void JobControl::resume() {
+    QMutexLocker locker(&m_mutex);
+    int expected = Paused;
+    if (m_state.compare_exchange_strong(expected, Running, std::memory_order_acq_rel)) {
+        m_resumed.wakeAll();
+    }
+}
+
+void JobControl::cancel() {
+    QMutexLocker locker(&m_mutex);
+    if (m_state.exchange(Cancelled, std::memory_order_acq_rel) != Cancelled) {
+        m_cancelNs.store(m_clock.nsecsElapsed(), std::memory_order_release);
+    }
+    // 暂停中的线程也要立刻醒来处理取消
+    m_resumed.wakeAll();
+}
+
+bool JobControl::waitIfPaused() {
+    if (state() == Running) return true;
+
+    QMutexLocker locker(&m_mutex);
+    while (state() == Paused) {
+        m_resumed.wait(&m_mutex);
+    }
+    return state() != Cancelled;
+}
+
+double JobControl::msSinceCancel() const {
+    qint64 at = m_cancelNs.load(std::memory_order_acquire);
+    if (at < 0) return 0.0;
+    return (m_clock.nsecsElapsed() - at) / 1000000.0;
+}
+
+int JobControl::interruptCb(void* opaque) {
+    // FFmpeg 在阻塞读写的重试循环里轮询，这里只能做无锁的原子读取
+    JobControl* control = static_cast<JobControl*>(opaque);
+    if (control->state() != Cancelled) return 0;
+    int grace = control->m_graceMs.load(std::memory_order_relaxed);
+    return grace <= 0 || control->msSinceCancel() >= grace;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <atomic>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+// 编码/播放线程共用的控制面：原子状态 + 暂停等待 + FFmpeg 阻塞IO中断回调。
+// GUI线程调用 pause/resume/cancel，工作线程在循环中检查或挂到 interrupt_callback 上
+class JobControl {
+public:
+    enum State { Running = 0, Paused = 1, Cancelled = 2 };
+
+    JobControl();
+
+    // 每次开始新任务前复位为 Running
+    void reset();
+    void pause();
+    void resume();
+    void cancel();
+
+    State state() const { return (State)m_state.load(std::memory_order_acquire); }
+    bool isCancelled() const { return state() == Cancelled; }
+    bool isPaused() const { return state() == Paused; }
+
+    // 暂停时阻塞直到恢复或取消；返回 false 表示已取消
+    bool waitIfPaused();
+
+    // 取消后阻塞IO还能继续的时间：读输入填 0 立即中断；写输出留出收尾时间，
+    // 超时仍未完成（如网络输出卡住）才强制中断，保证取消延迟有上限
+    void setInterruptGrace(int ms) { m_graceMs.store(ms, std::memory_order_relaxed); }
+    AVIOInterruptCB interruptCallback() { return AVIOInterruptCB{ &JobControl::interruptCb, this }; }
+
+    // 从 cancel() 到现在经过的时间，用于报告取消延迟
+    double msSinceCancel() const;
+
+private:
+    static int interruptCb(void* opaque);
+
+    std::atomic<int> m_state;
+    std::atomic<int> m_graceMs;
+    std::atomic<qint64> m_cancelNs;
+    QElapsedTimer m_clock;
+    QMutex m_mutex;
+    QWaitCondition m_resumed;
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "LogModel.h"
+#include <QColor>
+#include <QDateTime>
+#include <algorithm>
+
+LogModel::LogModel(QObject* parent) : QAbstractListModel(parent) {}
+
+int LogModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : (int)m_rows.size();
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= (int)m_rows.size()) return QVariant();
+    const LogEntry& entry = m_rows[index.row()];
+
+    if (role == Qt::DisplayRole) {
+        // 显示时才格式化，不可见的行不产生开销
+        return QString("%1 [%2] %3")
+            .arg(QDateTime::fromMSecsSinceEpoch(entry.msecs).toString("hh:mm:ss.zzz"))
+            .arg(entry.source).arg(entry.text);
+    }
+    if (role == Qt::ForegroundRole) {
+        switch (entry.level) {
+        case LogDebug:   return QColor(Qt::gray);
+        case LogWarning: return QColor(200, 120, 0);
+        case LogError:   return QColor(Qt::red);
+        default:         return QVariant();
+        }
+    }
+    return QVariant();
+}
+
+void LogModel::appendBatch(std::vector<LogEntry>& entries) {
+    if (entries.empty()) return;
+
+    // 先丢弃超出上限的旧行
+    int overflow = (int)(m_rows.size() + entries.size()) - kMaxRows;
+    if (overflow > 0) {
+        int remove = std::min(overflow, (int)m_rows.size());
+        if (remove > 0) {
+            beginRemoveRows(QModelIndex(), 0, remove - 1);
+            m_rows.erase(m_rows.begin(), m_rows.begin() + remove);
+            endRemoveRows();
+        }
+    }
+
+    // 单批超过上限时只保留最后 kMaxRows 条
+    size_t skip = entries.size() > (size_t)kMaxRows ? entries.size() - kMaxRows : 0;
+    int first = (int)m_rows.size();
+    beginInsertRows(QModelIndex(), first, first + (int)(entries.size() - skip) - 1);
+    for (size_t i = skip; i < entries.size(); i++) {
+        m_rows.push_back(std::move(entries[i]));
+    }
+    endInsertRows();
+    entries.clear();
+}
+
+void LogModel::clear() {
+    beginResetModel();
+    m_rows.clear();
+    endResetModel();
+}
\ No newline at end of file
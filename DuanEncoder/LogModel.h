@@ -0,0 +1,26 @@
+#pragma once
+#include <QAbstractListModel>
+#include <deque>
+#include <vector>
+#include "LogSink.h"
+
+// 日志列表模型，配合 QListView（uniformItemSizes）只绘制可见行；
+// 行数有上限，超出后成批丢弃最旧的行，内存不随任务长度增长
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    static const int kMaxRows = 50000;
+
+    explicit LogModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    // 一次插入一批，视图只收到一次 rowsInserted
+    void appendBatch(std::vector<LogEntry>& entries);
+    void clear();
+
+private:
+    std::deque<LogEntry> m_rows;
+};
\ No newline at end of file
@@ -0,0 +1,61 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "LogSink.h"
+#include <QDateTime>
+
+LogSink& LogSink::instance() {
+    static LogSink sink;
+    return sink;
+}
+
+LogSink::LogSink() : m_cells(new Cell[kCapacity]) {
+    for (uint32_t i = 0; i < kCapacity; i++) {
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogSink::write(LogLevel level, const char* source, const QString& text) {
+    if (!accepts(level)) return true;
+
+    // 有界 MPMC 队列（按序号占位）：CAS 抢到槽位后写入，再发布序号
+    uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    while (1) {
+        cell = &m_cells[pos & (kCapacity - 1)];
+        uint64_t seq = cell->seq.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            // 界面来不及取，丢弃并计数
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->entry.level = level;
+    cell->entry.msecs = QDateTime::currentMSecsSinceEpoch();
+    cell->entry.source = source;
+    cell->entry.text = text;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+int LogSink::drain(std::vector<LogEntry>& out, int maxCount) {
+    int count = 0;
+    while (count < maxCount) {
+        Cell* cell = &m_cells[m_dequeuePos & (kCapacity - 1)];
+        uint64_t seq = cell->seq.load(std::memory_order_acquire);
+        if (seq != m_dequeuePos + 1) break;
+
+        out.push_back(std::move(cell->entry));
+        cell->entry.text = QString();
+        cell->seq.store(m_dequeuePos + kCapacity, std::memory_order_release);
+        m_dequeuePos++;
+        count++;
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum LogLevel {
+    LogDebug = 0,    // 逐帧/逐包的细节，默认关闭
+    LogInfo = 1,
+    LogWarning = 2,
+    LogError = 3,
+};
+
+struct LogEntry {
+    int level = LogInfo;
+    qint64 msecs = 0;              // 写入时刻（自纪元起的毫秒）
+    const char* source = "";       // 静态字符串：encode / play / mosaic / ui ...
+    QString text;
+};
+
+// 有界的多写者日志环：工作线程无锁写入，界面线程定时成批取出。
+// 环满时丢弃新消息并计数，不阻塞工作线程；低于最低级别的消息在格式化前即可跳过
+class LogSink {
+public:
+    static const uint32_t kCapacity = 1u << 14;
+
+    static LogSink& instance();
+
+    bool accepts(LogLevel level) const { return level >= m_minLevel.load(std::memory_order_relaxed); }
+    void setMinLevel(LogLevel level) { m_minLevel.store(level, std::memory_order_relaxed); }
+    LogLevel minLevel() const { return (LogLevel)m_minLevel.load(std::memory_order_relaxed); }
+
+    bool write(LogLevel level, const char* source, const QString& text);
+    // 只允许一个线程（界面线程）调用，最多取 maxCount 条追加到 out
+    int drain(std::vector<LogEntry>& out, int maxCount);
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    LogSink();
+
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        LogEntry entry;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(64) std::atomic<uint64_t> m_enqueuePos{ 0 };
+    alignas(64) uint64_t m_dequeuePos = 0;
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<int> m_minLevel{ LogInfo };
+};
\ No newline at end of file
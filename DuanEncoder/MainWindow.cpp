@@ -1,14 +1,17 @@
-#include "stdafx.h"  //  #include "pch.h"Ԥͷ
+#include "stdafx.h"  // 或 #include "pch.h"（根据你的预编译头）
 #include "MainWindow.h"
+#include "FilterChain.h"
+#include <QScrollBar>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
 {
-    // ========== ȫ壬 ==========
+    // ========== 设置全局字体，解决乱码 ==========
     QFont font = this->font();
-    font.setFamily("Microsoft YaHei"); //  "SimHei"WindowsϵͳĬ壩
+    font.setFamily("Microsoft YaHei"); // 或 "SimHei"（Windows系统默认中文字体）
     this->setFont(font);
-    QApplication::setFont(font); // ȫӦ
+    QApplication::setFont(font); // 全局应用字体
     // ========== Window Basic Settings ==========
     this->setWindowTitle("Duan Qt + FFmpeg Encoder And Player");
     this->resize(700, 600);
@@ -49,7 +52,7 @@ MainWindow::MainWindow(QWidget* parent)
     // Width setting
     paramLayout->addWidget(new QLabel("Video Width: "), 0, 0);
     widthSpin = new QSpinBox(this);
-    widthSpin->setRange(160, 1920);
+    widthSpin->setRange(160, 7680);   // 最高 8K
     widthSpin->setValue(480);
     widthSpin->setSuffix(" px");
     paramLayout->addWidget(widthSpin, 0, 1);
@@ -57,7 +60,7 @@ MainWindow::MainWindow(QWidget* parent)
     // Height setting
     paramLayout->addWidget(new QLabel("Video Height: "), 0, 2);
     heightSpin = new QSpinBox(this);
-    heightSpin->setRange(120, 1080);
+    heightSpin->setRange(120, 4320);
     heightSpin->setValue(272);
     heightSpin->setSuffix(" px");
     paramLayout->addWidget(heightSpin, 0, 3);
@@ -65,7 +68,7 @@ MainWindow::MainWindow(QWidget* parent)
     // Bitrate setting
     paramLayout->addWidget(new QLabel("Bitrate: "), 1, 0);
     bitRateSpin = new QSpinBox(this);
-    bitRateSpin->setRange(100, 10000);
+    bitRateSpin->setRange(100, 200000);
     bitRateSpin->setValue(400);
     bitRateSpin->setSuffix(" kbps");
     paramLayout->addWidget(bitRateSpin, 1, 1);
@@ -84,6 +87,70 @@ MainWindow::MainWindow(QWidget* parent)
     codecCombo->addItem("H.265 (HEVC)", AV_CODEC_ID_HEVC);
     paramLayout->addWidget(codecCombo, 2, 1);
 
+    // Encode worker processes
+    paramLayout->addWidget(new QLabel("Worker Processes: "), 2, 2);
+    workersSpin = new QSpinBox(this);
+    workersSpin->setRange(0, 16);
+    workersSpin->setValue(0);
+    workersSpin->setSpecialValueText("In-process");
+    workersSpin->setToolTip("Encode segments in separate worker processes; a crashing encoder only restarts its worker");
+    paramLayout->addWidget(workersSpin, 2, 3);
+
+    // Large-frame memory placement
+    paramLayout->addWidget(new QLabel("NUMA Node: "), 3, 0);
+    numaCombo = new QComboBox(this);
+    numaCombo->addItem("Any", -1);
+    for (int node = 0, count = FrameMemory::numaNodeCount(); count > 1 && node < count; node++) {
+        numaCombo->addItem(QString("Node %1").arg(node), node);
+    }
+    numaCombo->setToolTip("Pin the encoder threads and their frame buffers to one NUMA node");
+    paramLayout->addWidget(numaCombo, 3, 1);
+    hugePagesCheck = new QCheckBox("Huge-page frame buffers", this);
+    hugePagesCheck->setChecked(FrameMemory::hugePagesEnabled());
+    paramLayout->addWidget(hugePagesCheck, 3, 2, 1, 2);
+
+    // Pre-encode filter chain (in-process encoder only)
+    paramLayout->addWidget(new QLabel("Filters: "), 4, 0);
+    filterEdit = new QLineEdit(this);
+    filterEdit->setPlaceholderText("e.g. crop=3840:1600,scale=1920:800,denoise=6");
+    filterEdit->setToolTip("Crop, downscale and denoise frames before encoding; width/height above are the input size");
+    paramLayout->addWidget(filterEdit, 4, 1, 1, 3);
+
+    // Low-latency (remote view) mode
+    lowLatencyCheck = new QCheckBox("Low latency (intra refresh)", this);
+    lowLatencyCheck->setToolTip("Replace periodic IDR frames with intra refresh and write each slice as soon as it is encoded");
+    paramLayout->addWidget(lowLatencyCheck, 5, 0, 1, 2);
+    paramLayout->addWidget(new QLabel("Slices per Frame: "), 5, 2);
+    slicesSpin = new QSpinBox(this);
+    slicesSpin->setRange(1, 32);
+    slicesSpin->setValue(4);
+    paramLayout->addWidget(slicesSpin, 5, 3);
+
+    analysisCheck = new QCheckBox("Bitstream report (.analysis.json)", this);
+    analysisCheck->setToolTip("Record frame types, sizes, NAL units and QP while encoding, next to the output file");
+    paramLayout->addWidget(analysisCheck, 6, 0, 1, 2);
+    paramLayout->addWidget(new QLabel("Stream RTP to: "), 6, 2);
+    rtpTargetEdit = new QLineEdit(this);
+    rtpTargetEdit->setPlaceholderText("host:port, e.g. 127.0.0.1:5004");
+    rtpTargetEdit->setToolTip("Also send the encoded stream as paced RTP/UDP; play it with rtp://@:5004");
+    paramLayout->addWidget(rtpTargetEdit, 6, 3);
+
+    paramLayout->addWidget(new QLabel("RTP Jitter Budget (ms): "), 7, 0);
+    rtpJitterSpin = new QSpinBox(this);
+    rtpJitterSpin->setRange(5, 1000);
+    rtpJitterSpin->setValue(50);
+    rtpJitterSpin->setToolTip("Large frames are spread over at most this long instead of being sent in one burst");
+    paramLayout->addWidget(rtpJitterSpin, 7, 1);
+    paramLayout->addWidget(new QLabel("RTP MTU: "), 7, 2);
+    rtpMtuSpin = new QSpinBox(this);
+    rtpMtuSpin->setRange(576, 9000);
+    rtpMtuSpin->setValue(1400);
+    paramLayout->addWidget(rtpMtuSpin, 7, 3);
+
+    sceneCheck = new QCheckBox("Scene-cut keyframes (.cuts.json)", this);
+    sceneCheck->setToolTip("Analyze frames ahead of the encoder, force keyframes on scene cuts and export the cut list next to the output file");
+    paramLayout->addWidget(sceneCheck, 8, 0, 1, 2);
+
     mainLayout->addWidget(paramGroup);
 
     // ========== Progress Bar Area ==========
@@ -94,58 +161,205 @@ MainWindow::MainWindow(QWidget* parent)
     progressLayout->addWidget(progressBar);
     mainLayout->addLayout(progressLayout);
 
+    // ========== Live Metrics Area ==========
+    // Worker threads only bump atomic counters; the panel samples them on a timer
+    QGroupBox* metricsGroup = new QGroupBox("Live metrics", this);
+    QGridLayout* metricsLayout = new QGridLayout();
+    metricsGroup->setLayout(metricsLayout);
+    encodeFpsLabel = new QLabel("-", this);
+    bitrateLabel = new QLabel("-", this);
+    etaLabel = new QLabel("-", this);
+    encodeCpuLabel = new QLabel("-", this);
+    packetHistLabel = new QLabel("-", this);
+    decodeFpsLabel = new QLabel("-", this);
+    renderFpsLabel = new QLabel("-", this);
+    droppedLabel = new QLabel("-", this);
+    playCpuLabel = new QLabel("-", this);
+    metricsLayout->addWidget(new QLabel("Encode fps:"), 0, 0);
+    metricsLayout->addWidget(encodeFpsLabel, 0, 1);
+    metricsLayout->addWidget(new QLabel("Bitrate:"), 0, 2);
+    metricsLayout->addWidget(bitrateLabel, 0, 3);
+    metricsLayout->addWidget(new QLabel("ETA:"), 0, 4);
+    metricsLayout->addWidget(etaLabel, 0, 5);
+    metricsLayout->addWidget(new QLabel("Encoder CPU:"), 0, 6);
+    metricsLayout->addWidget(encodeCpuLabel, 0, 7);
+    metricsLayout->addWidget(new QLabel("Packet sizes:"), 1, 0);
+    metricsLayout->addWidget(packetHistLabel, 1, 1, 1, 7);
+    metricsLayout->addWidget(new QLabel("Decode fps:"), 2, 0);
+    metricsLayout->addWidget(decodeFpsLabel, 2, 1);
+    metricsLayout->addWidget(new QLabel("Render fps:"), 2, 2);
+    metricsLayout->addWidget(renderFpsLabel, 2, 3);
+    metricsLayout->addWidget(new QLabel("Dropped:"), 2, 4);
+    metricsLayout->addWidget(droppedLabel, 2, 5);
+    metricsLayout->addWidget(new QLabel("Player CPU:"), 2, 6);
+    metricsLayout->addWidget(playCpuLabel, 2, 7);
+    mainLayout->addWidget(metricsGroup);
+
     // ========== Log Area ==========
-    QGroupBox* logGroup = new QGroupBox("Encoding Log", this);
+    QGroupBox* logGroup = new QGroupBox("Log", this);
     QVBoxLayout* logLayout = new QVBoxLayout();
     logGroup->setLayout(logLayout);
-    logEdit = new QTextEdit(this);
-    logEdit->setReadOnly(true);
-    logEdit->setPlaceholderText("Encoding log will be displayed here...");
-    logLayout->addWidget(logEdit);
+    QHBoxLayout* logLevelLayout = new QHBoxLayout();
+    logLevelLayout->addWidget(new QLabel("Level:"));
+    logLevelCombo = new QComboBox(this);
+    logLevelCombo->addItem("Debug", LogDebug);
+    logLevelCombo->addItem("Info", LogInfo);
+    logLevelCombo->addItem("Warning", LogWarning);
+    logLevelCombo->addItem("Error", LogError);
+    logLevelCombo->setCurrentIndex(logLevelCombo->findData(LogSink::instance().minLevel()));
+    logLevelLayout->addWidget(logLevelCombo);
+    logLevelLayout->addStretch();
+    logDroppedLabel = new QLabel(this);
+    logLevelLayout->addWidget(logDroppedLabel);
+    logLayout->addLayout(logLevelLayout);
+    m_logModel = new LogModel(this);
+    logView = new QListView(this);
+    logView->setModel(m_logModel);
+    logView->setUniformItemSizes(true);   // 行高一致，滚动时不必逐行测量
+    logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    logView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    logLayout->addWidget(logView);
     mainLayout->addWidget(logGroup);
 
     // ========== Control Button ==========
     startEncodeBtn = new QPushButton("Start Encoding", this);
     startEncodeBtn->setMinimumHeight(40);
     startEncodeBtn->setStyleSheet("QPushButton { font-size: 14px; }");
-    mainLayout->addWidget(startEncodeBtn);
+    pauseEncodeBtn = new QPushButton("Pause", this);
+    pauseEncodeBtn->setMinimumHeight(40);
+    pauseEncodeBtn->setEnabled(false);
+    cancelEncodeBtn = new QPushButton("Cancel", this);
+    cancelEncodeBtn->setMinimumHeight(40);
+    cancelEncodeBtn->setToolTip("Stop encoding; frames already encoded are flushed and the output is finalized");
+    cancelEncodeBtn->setEnabled(false);
+    QHBoxLayout* encodeCtrlLayout = new QHBoxLayout();
+    encodeCtrlLayout->addWidget(startEncodeBtn, 1);
+    encodeCtrlLayout->addWidget(pauseEncodeBtn);
+    encodeCtrlLayout->addWidget(cancelEncodeBtn);
+    traceCheck = new QCheckBox("Record trace", this);
+    traceCheck->setToolTip("Record per-stage timing spans of the encoder and player threads");
+    traceCheck->setChecked(Tracer::isEnabled());
+    exportTraceBtn = new QPushButton("Export trace", this);
+    exportTraceBtn->setMinimumHeight(40);
+    exportTraceBtn->setToolTip("Write the recorded spans as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)");
+    encodeCtrlLayout->addWidget(traceCheck);
+    encodeCtrlLayout->addWidget(exportTraceBtn);
+    mainLayout->addLayout(encodeCtrlLayout);
 
     QGroupBox* playGroup = new QGroupBox("Video playback", this);
+    QVBoxLayout* playGroupLayout = new QVBoxLayout();
     QHBoxLayout* playLayout = new QHBoxLayout();
-    playGroup->setLayout(playLayout);
+    QHBoxLayout* rawLayout = new QHBoxLayout();
+    playGroup->setLayout(playGroupLayout);
+    playGroupLayout->addLayout(playLayout);
+    playGroupLayout->addLayout(rawLayout);
 
     playLayout->addWidget(new QLabel("Playing the file: "));
     playFileEdit = new QLineEdit(this);
-    playFileEdit->setPlaceholderText("Select a video file to play");
+    playFileEdit->setPlaceholderText("Select a video file to play, or rtp://@:5004 for a live stream");
     selectPlayFileBtn = new QPushButton("Select a file", this);
     startPlayBtn = new QPushButton("Start playback", this);
+    pausePlayBtn = new QPushButton("Pause", this);
+    pausePlayBtn->setEnabled(false);
+    stopPlayBtn = new QPushButton("Stop", this);
+    stopPlayBtn->setEnabled(false);
+    playlistBtn = new QPushButton("Playlist", this);
+    playlistBtn->setToolTip("Play several files back to back; the next file is opened while the current one plays");
+    mosaicPlayBtn = new QPushButton("Mosaic playback", this);
+    mosaicPlayBtn->setToolTip("Play up to 16 files side by side in one window");
+    thumbnailBtn = new QPushButton("Thumbnails", this);
+    thumbnailBtn->setToolTip("Write a keyframe sprite sheet (.png) and timestamp map (.json) next to the file");
+    gopCacheSpin = new QSpinBox(this);
+    gopCacheSpin->setRange(64, 8192);
+    gopCacheSpin->setValue(512);
+    gopCacheSpin->setPrefix("GOP cache ");
+    gopCacheSpin->setSuffix(" MB");
+    gopCacheSpin->setToolTip("Memory budget for decoded GOPs used by frame stepping and reverse playback");
 
     playLayout->addWidget(playFileEdit);
     playLayout->addWidget(selectPlayFileBtn);
+    playLayout->addWidget(gopCacheSpin);
     playLayout->addWidget(startPlayBtn);
+    playLayout->addWidget(pausePlayBtn);
+    playLayout->addWidget(stopPlayBtn);
+    playLayout->addWidget(playlistBtn);
+    playLayout->addWidget(mosaicPlayBtn);
+    playLayout->addWidget(thumbnailBtn);
+
+    // Raw YUV playback uses the width/height of the encoding panel
+    rawLayout->addWidget(new QLabel(".yuv files: "));
+    rawFormatCombo = new QComboBox(this);
+    rawFormatCombo->addItem("yuv420p", AV_PIX_FMT_YUV420P);
+    rawFormatCombo->addItem("nv12", AV_PIX_FMT_NV12);
+    rawFormatCombo->addItem("nv21", AV_PIX_FMT_NV21);
+    rawFormatCombo->addItem("yuyv422", AV_PIX_FMT_YUYV422);
+    rawFormatCombo->addItem("uyvy422", AV_PIX_FMT_UYVY422);
+    rawFpsSpin = new QSpinBox(this);
+    rawFpsSpin->setRange(1, 240);
+    rawFpsSpin->setValue(25);
+    rawFpsSpin->setSuffix(" fps");
+    rawStartFrameSpin = new QSpinBox(this);
+    rawStartFrameSpin->setRange(0, 10000000);
+    rawStartFrameSpin->setPrefix("start frame ");
+    rawLayout->addWidget(rawFormatCombo);
+    rawLayout->addWidget(rawFpsSpin);
+    rawLayout->addWidget(rawStartFrameSpin);
+    rawLayout->addStretch();
     mainLayout->addWidget(playGroup);
 
     // ========== Signal-Slot Connection ==========
     connect(selectInputBtn, &QPushButton::clicked, this, &MainWindow::on_selectInputBtn_clicked);
     connect(selectOutputBtn, &QPushButton::clicked, this, &MainWindow::on_selectOutputBtn_clicked);
     connect(startEncodeBtn, &QPushButton::clicked, this, &MainWindow::on_startEncodeBtn_clicked);
+    connect(pauseEncodeBtn, &QPushButton::clicked, this, &MainWindow::on_pauseEncodeBtn_clicked);
+    connect(cancelEncodeBtn, &QPushButton::clicked, this, &MainWindow::on_cancelEncodeBtn_clicked);
+    connect(traceCheck, &QCheckBox::toggled, this, [](bool checked) { Tracer::setEnabled(checked); });
+    connect(exportTraceBtn, &QPushButton::clicked, this, &MainWindow::on_exportTraceBtn_clicked);
     connect(codecCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
         this, &MainWindow::on_codecCombo_currentIndexChanged);
 
     connect(selectPlayFileBtn, &QPushButton::clicked, this, &MainWindow::on_selectPlayFileBtn_clicked);
     connect(startPlayBtn, &QPushButton::clicked, this, &MainWindow::on_startPlayBtn_clicked);
+    connect(pausePlayBtn, &QPushButton::clicked, this, &MainWindow::on_pausePlayBtn_clicked);
+    connect(stopPlayBtn, &QPushButton::clicked, this, &MainWindow::on_stopPlayBtn_clicked);
+    connect(playlistBtn, &QPushButton::clicked, this, &MainWindow::on_playlistBtn_clicked);
+    connect(mosaicPlayBtn, &QPushButton::clicked, this, &MainWindow::on_mosaicPlayBtn_clicked);
+    connect(thumbnailBtn, &QPushButton::clicked, this, &MainWindow::on_thumbnailBtn_clicked);
 
     // Initialize encoder thread
     m_encoderThread = new EncoderThread(this);
     connect(m_encoderThread, &EncoderThread::encodeProgress, this, &MainWindow::updateProgress);
-    connect(m_encoderThread, &EncoderThread::encodeLog, this, &MainWindow::updateLog);
     connect(m_encoderThread, &EncoderThread::encodeFinished, this, &MainWindow::onEncodeFinished);
+    m_encodePool = new EncodePool(this);
+    connect(m_encodePool, &EncodePool::encodeProgress, this, &MainWindow::updateProgress);
+    connect(m_encodePool, &EncodePool::encodeFinished, this, &MainWindow::onEncodeFinished);
 
     // Initialize decoder thread
     m_playerThread = new PlayerThread(this);
-    connect(m_playerThread, &PlayerThread::playLog, this, &MainWindow::updatePlayLog);
     connect(m_playerThread, &PlayerThread::playError, this, &MainWindow::onPlayError);
     connect(m_playerThread, &PlayerThread::playFinished, this, &MainWindow::onPlayFinished);
+
+    // Initialize mosaic player thread
+    m_mosaicThread = new MosaicPlayerThread(this);
+    connect(m_mosaicThread, &MosaicPlayerThread::playError, this, &MainWindow::onPlayError);
+    connect(m_mosaicThread, &MosaicPlayerThread::playFinished, this, &MainWindow::onPlayFinished);
+
+    // Initialize thumbnail generator
+    m_thumbGenerator = new ThumbnailGenerator(this);
+    connect(m_thumbGenerator, &ThumbnailGenerator::thumbLog, this, &MainWindow::updateThumbLog);
+    connect(m_thumbGenerator, &ThumbnailGenerator::thumbFinished, this, &MainWindow::onThumbnailFinished);
+
+    // 定时采样工作线程的计数器
+    m_metricsTimer = new QTimer(this);
+    connect(m_metricsTimer, &QTimer::timeout, this, &MainWindow::sampleMetrics);
+    m_metricsClock.start();
+    m_metricsTimer->start(500);
+
+    // 工作线程只写日志环，界面每 100 ms 成批取一次，避免每行一个跨线程信号
+    connect(logLevelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::on_logLevelCombo_currentIndexChanged);
+    m_logTimer = new QTimer(this);
+    connect(m_logTimer, &QTimer::timeout, this, &MainWindow::drainLog);
+    m_logTimer->start(100);
 }
 
 MainWindow::~MainWindow()
@@ -153,9 +367,88 @@ MainWindow::~MainWindow()
     // No need to manually release widgets (Qt parent-child mechanism)
 }
 
+void MainWindow::sampleMetrics()
+{
+    qint64 now_ms = m_metricsClock.elapsed();
+    double dt = (now_ms - m_lastSampleMs) / 1000.0;
+    if (dt <= 0) return;
+    m_lastSampleMs = now_ms;
+
+    // 编码：最近一个采样周期的速度，ETA 用平滑后的帧率
+    const EncodeMetrics& enc = m_usePool ? m_encodePool->metrics() : m_encoderThread->metrics();
+    int64_t frames = enc.frames.load(std::memory_order_relaxed);
+    int64_t bytes = enc.bytes.load(std::memory_order_relaxed);
+    int64_t cpu_ns = enc.cpuNs.load(std::memory_order_relaxed);
+    if (frames < m_lastEncFrames) {
+        // 新任务开始，计数器已复位
+        m_lastEncFrames = 0;
+        m_lastEncBytes = 0;
+        m_lastEncCpuNs = 0;
+        m_encodeFpsAvg = 0.0;
+    }
+    if (enc.running.load(std::memory_order_relaxed) || frames != m_lastEncFrames) {
+        int64_t d_frames = frames - m_lastEncFrames;
+        double fps = d_frames / dt;
+        m_encodeFpsAvg = m_encodeFpsAvg > 0 ? m_encodeFpsAvg * 0.7 + fps * 0.3 : fps;
+        int64_t remaining = std::max<int64_t>(0, enc.totalFrames.load(std::memory_order_relaxed) - frames);
+        encodeFpsLabel->setText(QString::number(fps, 'f', 1));
+        if (d_frames > 0) {
+            double kbps = (bytes - m_lastEncBytes) * 8.0 * enc.frameRate.load(std::memory_order_relaxed) / d_frames / 1000.0;
+            bitrateLabel->setText(QString("%1 kbps").arg(kbps, 0, 'f', 0));
+        }
+        etaLabel->setText(m_encodeFpsAvg > 0.1 ? QString("%1 s").arg(remaining / m_encodeFpsAvg, 0, 'f', 1) : "-");
+        encodeCpuLabel->setText(QString("%1 s (%2%)").arg(cpu_ns / 1e9, 0, 'f', 1)
+            .arg((cpu_ns - m_lastEncCpuNs) / 1e7 / dt, 0, 'f', 0));
+
+        // 包大小分布：每个桶一个高度字符，悬停显示具体数量
+        int64_t counts[EncodeMetrics::kSizeBuckets];
+        int64_t max_count = 0;
+        for (int i = 0; i < EncodeMetrics::kSizeBuckets; i++) {
+            counts[i] = enc.sizeBuckets[i].load(std::memory_order_relaxed);
+            max_count = std::max(max_count, counts[i]);
+        }
+        QString hist;
+        QString tip;
+        for (int i = 0; i < EncodeMetrics::kSizeBuckets; i++) {
+            int level = max_count ? (int)((counts[i] * 8 + max_count - 1) / max_count) : 0;
+            // U+2581..U+2588 为八级高度的方块字符
+            QChar bar = level > 0 ? QChar(0x2580 + level) : QChar(' ');
+            hist += QString("%1%2  ").arg(EncodeMetrics::bucketLabel(i)).arg(bar);
+            tip += QString("%1: %2\n").arg(EncodeMetrics::bucketLabel(i)).arg(counts[i]);
+        }
+        packetHistLabel->setText(hist);
+        packetHistLabel->setToolTip(tip.trimmed());
+    }
+    m_lastEncFrames = frames;
+    m_lastEncBytes = bytes;
+    m_lastEncCpuNs = cpu_ns;
+
+    // 播放：单路与拼接播放互斥，取正在运行的那个
+    const PlaybackMetrics& play = m_mosaicThread->metrics().running.load(std::memory_order_relaxed)
+        ? m_mosaicThread->metrics() : m_playerThread->metrics();
+    int64_t decoded = play.decoded.load(std::memory_order_relaxed);
+    int64_t rendered = play.rendered.load(std::memory_order_relaxed);
+    int64_t play_cpu = play.cpuNs.load(std::memory_order_relaxed);
+    if (decoded < m_lastDecoded || rendered < m_lastRendered) {
+        m_lastDecoded = 0;
+        m_lastRendered = 0;
+        m_lastPlayCpuNs = 0;
+    }
+    if (play.running.load(std::memory_order_relaxed)) {
+        decodeFpsLabel->setText(QString::number((decoded - m_lastDecoded) / dt, 'f', 1));
+        renderFpsLabel->setText(QString::number((rendered - m_lastRendered) / dt, 'f', 1));
+        droppedLabel->setText(QString::number(play.dropped.load(std::memory_order_relaxed)));
+        playCpuLabel->setText(QString("%1 s (%2%)").arg(play_cpu / 1e9, 0, 'f', 1)
+            .arg((play_cpu - m_lastPlayCpuNs) / 1e7 / dt, 0, 'f', 0));
+    }
+    m_lastDecoded = decoded;
+    m_lastRendered = rendered;
+    m_lastPlayCpuNs = play_cpu;
+}
+
 void MainWindow::on_selectInputBtn_clicked()
 {
-    // ֺ (;;)  Qt ļ﷨ڷָͬļѡ
+    // 连续两个分号 (;;) 是 Qt 文件过滤器的语法规则，用于分隔不同的文件类型选项
     QString path = QFileDialog::getOpenFileName(this,
         "Select YUV File", "", "YUV Files (*.yuv);;All Files (*.*)");
     if (!path.isEmpty()) {
@@ -200,20 +493,78 @@ void MainWindow::on_startEncodeBtn_clicked()
     int height = heightSpin->value();
     int bitRate = bitRateSpin->value() * 1000; // kbps to bps
     int frameNum = frameNumSpin->value();
+    QString filters = filterEdit->text().trimmed();
+
+    if (workersSpin->value() > 0 && !filters.isEmpty()) {
+        QMessageBox::warning(this, "Parameter Error", "Pre-encode filters are only supported by the in-process encoder!");
+        return;
+    }
+    if (workersSpin->value() > 0 && lowLatencyCheck->isChecked()) {
+        QMessageBox::warning(this, "Parameter Error", "Low-latency mode is only supported by the in-process encoder!");
+        return;
+    }
+    if (workersSpin->value() > 0 && analysisCheck->isChecked()) {
+        QMessageBox::warning(this, "Parameter Error", "Bitstream reports are only supported by the in-process encoder!");
+        return;
+    }
+    if (workersSpin->value() > 0 && sceneCheck->isChecked()) {
+        QMessageBox::warning(this, "Parameter Error", "Scene-cut keyframes are only supported by the in-process encoder!");
+        return;
+    }
+    if (workersSpin->value() > 0 && !rtpTargetEdit->text().trimmed().isEmpty()) {
+        QMessageBox::warning(this, "Parameter Error", "RTP streaming is only supported by the in-process encoder!");
+        return;
+    }
+    if (!filters.isEmpty()) {
+        // 先按输入尺寸试配一次：拼写错误或裁剪越界在这里报出，不必等编码线程启动
+        QString filter_error;
+        if (!FilterChain().configure(filters, width, height, &filter_error)) {
+            QMessageBox::warning(this, "Parameter Error", QString("Invalid pre-encode filters: %1").arg(filter_error));
+            return;
+        }
+    }
 
     // Disable controls to prevent duplicate operations
     startEncodeBtn->setEnabled(false);
     selectInputBtn->setEnabled(false);
     selectOutputBtn->setEnabled(false);
     codecCombo->setEnabled(false);
+    workersSpin->setEnabled(false);
+    numaCombo->setEnabled(false);
+    hugePagesCheck->setEnabled(false);
+    filterEdit->setEnabled(false);
+    lowLatencyCheck->setEnabled(false);
+    slicesSpin->setEnabled(false);
+    analysisCheck->setEnabled(false);
+    rtpTargetEdit->setEnabled(false);
+    rtpJitterSpin->setEnabled(false);
+    rtpMtuSpin->setEnabled(false);
+    sceneCheck->setEnabled(false);
+    pauseEncodeBtn->setText("Pause");
+    pauseEncodeBtn->setEnabled(true);
+    cancelEncodeBtn->setEnabled(true);
 
     // Clear log and progress
-    logEdit->clear();
+    m_logModel->clear();
     progressBar->setValue(0);
 
     // Set thread parameters and start encoding
-    m_encoderThread->setParams(input, output, width, height, bitRate, frameNum, m_currentCodec);
-    m_encoderThread->start();
+    FrameMemory::setHugePagesEnabled(hugePagesCheck->isChecked());
+    m_usePool = workersSpin->value() > 0;
+    if (m_usePool) {
+        m_encodePool->setParams(input, output, width, height, bitRate, frameNum, m_currentCodec, workersSpin->value());
+        m_encodePool->start();
+    }
+    else {
+        m_encoderThread->setParams(input, output, width, height, bitRate, frameNum, m_currentCodec);
+        m_encoderThread->setNumaNode(numaCombo->currentData().toInt());
+        m_encoderThread->setFilters(filters);
+        m_encoderThread->setLowLatency(lowLatencyCheck->isChecked(), slicesSpin->value());
+        m_encoderThread->setAnalysisReport(analysisCheck->isChecked() ? output + ".analysis.json" : QString());
+        m_encoderThread->setSceneDetection(sceneCheck->isChecked(), output + ".cuts.json");
+        m_encoderThread->setRtpOutput(rtpTargetEdit->text().trimmed(), rtpJitterSpin->value(), rtpMtuSpin->value());
+        m_encoderThread->start();
+    }
 }
 
 void MainWindow::updateProgress(int current, int total)
@@ -222,13 +573,28 @@ void MainWindow::updateProgress(int current, int total)
     progressBar->setValue(current);
 }
 
-void MainWindow::updateLog(const QString& log)
+void MainWindow::drainLog()
 {
-    logEdit->append(log);
-    // Auto scroll to last line
-    QTextCursor cursor = logEdit->textCursor();
-    cursor.movePosition(QTextCursor::End);
-    logEdit->setTextCursor(cursor);
+    // 每次最多取 5000 条，日志洪峰时界面也不会卡住，剩下的留给下一次
+    const int kMaxPerTick = 5000;
+    m_logBatch.clear();
+    if (LogSink::instance().drain(m_logBatch, kMaxPerTick) > 0) {
+        // 只有停在底部时才自动滚动，用户往上翻看时不打扰
+        QScrollBar* bar = logView->verticalScrollBar();
+        bool atBottom = bar->value() >= bar->maximum();
+        m_logModel->appendBatch(m_logBatch);
+        if (atBottom) {
+            logView->scrollToBottom();
+        }
+    }
+
+    uint64_t dropped = LogSink::instance().dropped();
+    logDroppedLabel->setText(dropped > 0 ? QString("%1 lines dropped").arg(dropped) : QString());
+}
+
+void MainWindow::on_logLevelCombo_currentIndexChanged(int index)
+{
+    LogSink::instance().setMinLevel((LogLevel)logLevelCombo->itemData(index).toInt());
 }
 
 void MainWindow::onEncodeFinished(bool success)
@@ -238,15 +604,82 @@ void MainWindow::onEncodeFinished(bool success)
     selectInputBtn->setEnabled(true);
     selectOutputBtn->setEnabled(true);
     codecCombo->setEnabled(true);
+    workersSpin->setEnabled(true);
+    numaCombo->setEnabled(true);
+    hugePagesCheck->setEnabled(true);
+    filterEdit->setEnabled(true);
+    lowLatencyCheck->setEnabled(true);
+    slicesSpin->setEnabled(true);
+    analysisCheck->setEnabled(true);
+    rtpTargetEdit->setEnabled(true);
+    rtpJitterSpin->setEnabled(true);
+    rtpMtuSpin->setEnabled(true);
+    sceneCheck->setEnabled(true);
+    pauseEncodeBtn->setText("Pause");
+    pauseEncodeBtn->setEnabled(false);
+    cancelEncodeBtn->setEnabled(false);
 
     if (success) {
         QMessageBox::information(this, "Encode Success", "Video encoding completed! Output file saved.");
     }
+    else if (m_usePool ? m_encodePool->wasCancelled() : m_encoderThread->wasCancelled()) {
+        // 取消后能否留下可播放的文件取决于冲刷/合并是否成功，以编码端的结果为准
+        if (m_usePool ? m_encodePool->outputFinalized() : m_encoderThread->outputFinalized()) {
+            QMessageBox::information(this, "Encode Cancelled", "Encoding was cancelled. The frames encoded so far were saved as a complete file.");
+        }
+        else {
+            QMessageBox::warning(this, "Encode Cancelled", "Encoding was cancelled, but the output could not be finalized. The output file is missing or incomplete; check log for details.");
+        }
+    }
     else {
         QMessageBox::critical(this, "Encode Failed", "Video encoding error! Check log for details.");
     }
 }
 
+void MainWindow::on_pauseEncodeBtn_clicked()
+{
+    bool paused = m_usePool ? m_encodePool->isPaused() : m_encoderThread->isPaused();
+    if (paused) {
+        if (m_usePool) m_encodePool->resumeEncoding();
+        else m_encoderThread->resumeEncoding();
+        pauseEncodeBtn->setText("Pause");
+    }
+    else {
+        if (m_usePool) m_encodePool->pauseEncoding();
+        else m_encoderThread->pauseEncoding();
+        pauseEncodeBtn->setText("Resume");
+    }
+}
+
+void MainWindow::on_cancelEncodeBtn_clicked()
+{
+    pauseEncodeBtn->setEnabled(false);
+    cancelEncodeBtn->setEnabled(false);
+    if (m_usePool) {
+        m_encodePool->cancelEncoding();
+    }
+    else {
+        m_encoderThread->cancelEncoding();
+    }
+}
+
+void MainWindow::on_exportTraceBtn_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this,
+        "Export trace", "duan_trace.json", "Chrome trace (*.json);;All files (*.*)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    int64_t events = Tracer::exportChromeTrace(path, &error);
+    if (events < 0) {
+        QMessageBox::critical(this, "Export trace", "Unable to write the trace: " + error);
+        return;
+    }
+    LogSink::instance().write(LogInfo, "trace", QString("%1 spans written to %2").arg(events).arg(path));
+}
+
 void MainWindow::on_codecCombo_currentIndexChanged(int index)
 {
     m_currentCodec = codecCombo->itemData(index).toInt();
@@ -267,7 +700,7 @@ void MainWindow::on_codecCombo_currentIndexChanged(int index)
 void MainWindow::on_selectPlayFileBtn_clicked()
 {
     QString path = QFileDialog::getOpenFileName(this,
-        "Select a video file", "", "Video file (*.h264 *.h265 *.mp4 *.avi);;All files (*.*)");
+        "Select a video file", "", "Video file (*.h264 *.h265 *.mp4 *.avi *.yuv);;All files (*.*)");
     if (!path.isEmpty()) {
         playFileEdit->setText(path);
     }
@@ -281,36 +714,136 @@ void MainWindow::on_startPlayBtn_clicked()
         return;
     }
 
-    // òŰťֹظ
+    // 禁用播放按钮防止重复点击
     startPlayBtn->setEnabled(false);
     selectPlayFileBtn->setEnabled(false);
+    playlistBtn->setEnabled(false);
+    mosaicPlayBtn->setEnabled(false);
+    pausePlayBtn->setText("Pause");
+    pausePlayBtn->setEnabled(true);
+    stopPlayBtn->setEnabled(true);
 
     m_playerThread->setFilePath(playFile);
-    m_playerThread->start();
+    // .yuv has no container: play it raw with the encoder panel's width/height
+    m_playerThread->setRawYuv(playFile.endsWith(".yuv", Qt::CaseInsensitive),
+        widthSpin->value(), heightSpin->value(), rawFormatCombo->currentData().toInt(),
+        rawFpsSpin->value(), rawStartFrameSpin->value());
+    m_playerThread->setGopCacheBudget(gopCacheSpin->value());
+    // 播放线程常驻，第二次起不再重新初始化SDL和窗口
+    m_playerThread->requestPlayback();
 }
 
-void MainWindow::updatePlayLog(const QString& log)
+void MainWindow::on_pausePlayBtn_clicked()
 {
-    logEdit->append("[play] " + log);
-    QTextCursor cursor = logEdit->textCursor();
-    cursor.movePosition(QTextCursor::End);
-    logEdit->setTextCursor(cursor);
+    if (m_playerThread->isPlaybackPaused()) {
+        m_playerThread->resumePlayback();
+        pausePlayBtn->setText("Pause");
+    }
+    else {
+        m_playerThread->pausePlayback();
+        pausePlayBtn->setText("Resume");
+    }
+}
+
+void MainWindow::on_stopPlayBtn_clicked()
+{
+    pausePlayBtn->setEnabled(false);
+    stopPlayBtn->setEnabled(false);
+    m_playerThread->stopPlayback();
+}
+
+void MainWindow::on_playlistBtn_clicked()
+{
+    QStringList files = QFileDialog::getOpenFileNames(this,
+        "Select video files to play in order", "", "Video file (*.h264 *.h265 *.mp4 *.avi);;All files (*.*)");
+    if (files.isEmpty()) {
+        return;
+    }
+
+    startPlayBtn->setEnabled(false);
+    selectPlayFileBtn->setEnabled(false);
+    playlistBtn->setEnabled(false);
+    mosaicPlayBtn->setEnabled(false);
+    pausePlayBtn->setText("Pause");
+    pausePlayBtn->setEnabled(true);
+    stopPlayBtn->setEnabled(true);
+
+    m_playerThread->setPlaylist(files);
+    m_playerThread->setRawYuv(false, 0, 0);
+    m_playerThread->setGopCacheBudget(gopCacheSpin->value());
+    m_playerThread->requestPlayback();
+}
+
+void MainWindow::on_mosaicPlayBtn_clicked()
+{
+    QStringList files = QFileDialog::getOpenFileNames(this,
+        "Select video files to compare", "", "Video file (*.h264 *.h265 *.mp4 *.avi);;All files (*.*)");
+    if (files.isEmpty()) {
+        return;
+    }
+    if (files.size() > MosaicPlayerThread::kMaxStreams) {
+        QMessageBox::warning(this, "Parameter error",
+            QString("At most %1 files can be played side by side.").arg(MosaicPlayerThread::kMaxStreams));
+        return;
+    }
+
+    startPlayBtn->setEnabled(false);
+    selectPlayFileBtn->setEnabled(false);
+    playlistBtn->setEnabled(false);
+    mosaicPlayBtn->setEnabled(false);
+
+    m_mosaicThread->setFiles(files);
+    m_mosaicThread->start();
 }
 
 void MainWindow::onPlayError(const QString& error)
 {
-    logEdit->append("[Playback error] " + error);
+    LogSink::instance().write(LogError, "play", error);
     QMessageBox::critical(this, "Playback error", error);
 
-    // ָť״̬
+    // 恢复按钮状态
     startPlayBtn->setEnabled(true);
     selectPlayFileBtn->setEnabled(true);
+    playlistBtn->setEnabled(true);
+    mosaicPlayBtn->setEnabled(true);
+    pausePlayBtn->setEnabled(false);
+    stopPlayBtn->setEnabled(false);
 }
 
 void MainWindow::onPlayFinished()
 {
-    logEdit->append("[play] Playback ended");
-    // ָť״̬
+    LogSink::instance().write(LogInfo, "play", "Playback ended");
+    // 恢复按钮状态
     startPlayBtn->setEnabled(true);
     selectPlayFileBtn->setEnabled(true);
+    playlistBtn->setEnabled(true);
+    mosaicPlayBtn->setEnabled(true);
+    pausePlayBtn->setEnabled(false);
+    stopPlayBtn->setEnabled(false);
+}
+
+void MainWindow::on_thumbnailBtn_clicked()
+{
+    QString file = playFileEdit->text().trimmed();
+    if (file.isEmpty()) {
+        QMessageBox::warning(this, "Parameter error", "Please select a video file first!");
+        return;
+    }
+
+    thumbnailBtn->setEnabled(false);
+    m_thumbGenerator->setParams(file, file + ".thumbs");
+    m_thumbGenerator->start();
+}
+
+void MainWindow::updateThumbLog(const QString& log)
+{
+    LogSink::instance().write(LogInfo, "thumb", log);
+}
+
+void MainWindow::onThumbnailFinished(bool success)
+{
+    thumbnailBtn->setEnabled(true);
+    if (!success) {
+        QMessageBox::critical(this, "Thumbnail error", "Thumbnail generation failed! Check log for details.");
+    }
 }
\ No newline at end of file
@@ -5,21 +5,29 @@
 #include <QPushButton>
 #include <QSpinBox>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QProgressBar>
-#include <QTextEdit>
+#include <QListView>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <QLabel>
 #include <QFileDialog>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QMessageBox>
 #include "EncoderThread.h"
+#include "EncodePool.h"
 #include "PlayerThread.h"
+#include "MosaicPlayerThread.h"
+#include "ThumbnailGenerator.h"
+#include "Tracer.h"
+#include "LogModel.h"
 /*
-һƵ빤ߵͼν棬˱̵߳Ľ߼
+构建一个音视频编码工具的图形界面，并集成了编码线程的交互逻辑
 */
-// MainWindow ̳ Qt  QMainWindow߱ڵԣ˵Ĳȣ
-// Q_OBJECTQt ĺĺ꣬ʹźŲۻƵУԪϵͳMeta-Object System֧źšۡȹ
+// MainWindow 继承自 Qt 的主窗口类 QMainWindow，具备主窗口的所有特性（如菜单栏、工具栏、中心部件等）
+// Q_OBJECT：Qt 的核心宏，必须添加在使用信号槽机制的类中，用于启用元对象系统（Meta-Object System），支持信号、槽、反射等功能
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
@@ -27,43 +35,108 @@ public:
     MainWindow(QWidget* parent = nullptr);
     ~MainWindow();
 
-// ۺ
+// 槽函数
 private slots:
-    void on_selectInputBtn_clicked();      // ѡYUVļ
-    void on_selectOutputBtn_clicked();     // ѡļ
-    void on_startEncodeBtn_clicked();      // ʼ
-    void updateProgress(int current, int total); // ½
-    void updateLog(const QString& log);    // ־
-    void onEncodeFinished(bool success);   // ɴ
-    void on_codecCombo_currentIndexChanged(int index); // ѡ
+    void on_selectInputBtn_clicked();      // 选择输入YUV文件
+    void on_selectOutputBtn_clicked();     // 选择输出文件
+    void on_startEncodeBtn_clicked();      // 开始编码
+    void updateProgress(int current, int total); // 更新进度条
+    void onEncodeFinished(bool success);   // 编码完成处理
+    void on_codecCombo_currentIndexChanged(int index); // 编码器选择
+    void on_pauseEncodeBtn_clicked();      // 暂停/继续编码
+    void on_cancelEncodeBtn_clicked();     // 取消编码，保留已编码部分
+    void on_exportTraceBtn_clicked();      // 导出分阶段耗时 trace
 
-    // Ӳزۺ
+    // 新添加播放相关槽函数
     void on_selectPlayFileBtn_clicked();
     void on_startPlayBtn_clicked();
-    void updatePlayLog(const QString& log);
+    void on_pausePlayBtn_clicked();
+    void on_stopPlayBtn_clicked();
     void onPlayError(const QString& error);
     void onPlayFinished();
+    void on_playlistBtn_clicked();        // 多个文件依次无缝播放
+    void on_mosaicPlayBtn_clicked();      // 多路拼接对比播放
+    void on_thumbnailBtn_clicked();       // 生成关键帧缩略图条
+    void updateThumbLog(const QString& log);
+    void onThumbnailFinished(bool success);
+    void sampleMetrics();                 // 定时采样性能计数器
+    void drainLog();                      // 定时从日志环中成批取出
+    void on_logLevelCombo_currentIndexChanged(int index);
 
 private:
-    EncoderThread* m_encoderThread;        // ̶ָ߳
+    EncoderThread* m_encoderThread;        // 编码线程对象指针
+    EncodePool* m_encodePool;              // 多进程编码
+    bool m_usePool = false;                // 本次编码是否走工作进程
     PlayerThread* m_playerThread;
-    int m_currentCodec = AV_CODEC_ID_H264; // ĬH.264
+    MosaicPlayerThread* m_mosaicThread;
+    ThumbnailGenerator* m_thumbGenerator;
+    int m_currentCodec = AV_CODEC_ID_H264; // 默认H.264编码器
 
-    // ؼԱ
-    QLineEdit* inputEdit;                 // ļ·ʾ
-    QLineEdit* outputEdit;                // ļ·ʾ
-    QPushButton* selectInputBtn;          // ѡļť
-    QPushButton* selectOutputBtn;         // ѡļť
-    QSpinBox* widthSpin;                  // Ƶ
-    QSpinBox* heightSpin;                 // Ƶ߶
-    QSpinBox* bitRateSpin;                // 
-    QSpinBox* frameNumSpin;               // ֡
-    QComboBox* codecCombo;                // ѡ
-    QProgressBar* progressBar;            // 
-    QTextEdit* logEdit;                   // ־ʾı
-    QPushButton* startEncodeBtn;          // ʼ밴ť
+    // 界面控件成员变量
+    QLineEdit* inputEdit;                 // 输入文件路径显示框
+    QLineEdit* outputEdit;                // 输出文件路径显示框
+    QPushButton* selectInputBtn;          // 选择输入文件按钮
+    QPushButton* selectOutputBtn;         // 选择输出文件按钮
+    QSpinBox* widthSpin;                  // 视频宽度输入框（整数）
+    QSpinBox* heightSpin;                 // 视频高度输入框（整数）
+    QSpinBox* bitRateSpin;                // 码率输入框（整数）
+    QSpinBox* frameNumSpin;               // 编码帧数输入框（整数）
+    QComboBox* codecCombo;                // 编码器选择下拉框
+    QSpinBox* workersSpin;                // 编码工作进程数，0 为进程内编码
+    QComboBox* numaCombo;                 // 编码线程和帧缓冲绑定的 NUMA 节点
+    QCheckBox* hugePagesCheck;            // 帧缓冲是否使用大页
+    QLineEdit* filterEdit;                // 编码前滤镜链
+    QCheckBox* lowLatencyCheck;           // 帧内刷新 + 逐片输出
+    QSpinBox* slicesSpin;                 // 每帧切片数
+    QCheckBox* analysisCheck;             // 编码时输出码流分析报告
+    QLineEdit* rtpTargetEdit;             // RTP 实时预览的目标地址
+    QSpinBox* rtpJitterSpin;              // RTP 发送的抖动预算（毫秒）
+    QSpinBox* rtpMtuSpin;                 // RTP 包大小上限
+    QCheckBox* sceneCheck;                // 场景切换处放关键帧并导出切换列表
+    QProgressBar* progressBar;            // 编码进度条
+    QListView* logView;                   // 日志列表（只绘制可见行）
+    LogModel* m_logModel;
+    QComboBox* logLevelCombo;             // 最低日志级别
+    QLabel* logDroppedLabel;              // 日志环满时丢弃的条数
+    QTimer* m_logTimer;
+    std::vector<LogEntry> m_logBatch;
+    QPushButton* startEncodeBtn;          // 开始编码按钮
+    QPushButton* pauseEncodeBtn;          // 暂停/继续编码按钮
+    QPushButton* cancelEncodeBtn;         // 取消编码按钮
+    QCheckBox* traceCheck;                // 是否记录 trace
+    QPushButton* exportTraceBtn;          // 导出 trace 按钮
 
     QLineEdit* playFileEdit;
     QPushButton* selectPlayFileBtn;
     QPushButton* startPlayBtn;
+    QPushButton* pausePlayBtn;
+    QPushButton* stopPlayBtn;
+    QPushButton* playlistBtn;
+    QPushButton* mosaicPlayBtn;
+    QPushButton* thumbnailBtn;
+    // 实时性能面板
+    QLabel* encodeFpsLabel;
+    QLabel* bitrateLabel;
+    QLabel* etaLabel;
+    QLabel* encodeCpuLabel;
+    QLabel* packetHistLabel;
+    QLabel* decodeFpsLabel;
+    QLabel* renderFpsLabel;
+    QLabel* droppedLabel;
+    QLabel* playCpuLabel;
+    QTimer* m_metricsTimer;
+    QElapsedTimer m_metricsClock;
+    qint64 m_lastSampleMs = 0;
+    int64_t m_lastEncFrames = 0;
+    int64_t m_lastEncBytes = 0;
+    int64_t m_lastEncCpuNs = 0;
+    double m_encodeFpsAvg = 0.0;
+    int64_t m_lastDecoded = 0;
+    int64_t m_lastRendered = 0;
+    int64_t m_lastPlayCpuNs = 0;
+
+    QSpinBox* gopCacheSpin;               // 逐帧后退用的GOP缓存上限（MB）
+    QComboBox* rawFormatCombo;            // 裸YUV播放的像素格式
+    QSpinBox* rawFpsSpin;                 // 裸YUV播放帧率
+    QSpinBox* rawStartFrameSpin;          // 裸YUV播放起始帧号
 };
\ No newline at end of file
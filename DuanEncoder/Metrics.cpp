@@ -0,0 +1,87 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Metrics.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+int64_t currentThreadCpuNs() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    // FILETIME 单位为 100ns
+    return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int64_t currentProcessCpuNs() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+EncodeMetrics::EncodeMetrics() {
+    for (auto& bucket : sizeBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void EncodeMetrics::reset(int64_t total, double rate) {
+    totalFrames.store(total, std::memory_order_relaxed);
+    frameRate.store(rate, std::memory_order_relaxed);
+    frames.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    cpuNs.store(0, std::memory_order_relaxed);
+    for (auto& bucket : sizeBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void EncodeMetrics::addPacket(int size) {
+    frames.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    sizeBuckets[bucketOf(size)].fetch_add(1, std::memory_order_relaxed);
+}
+
+int EncodeMetrics::bucketOf(int size) {
+    int bucket = 0;
+    for (int limit = 512; bucket < kSizeBuckets - 1 && size >= limit; limit <<= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+const char* EncodeMetrics::bucketLabel(int bucket) {
+    static const char* labels[kSizeBuckets] = {
+        "<512B", "<1K", "<2K", "<4K", "<8K", "<16K", "<32K", "<64K", "<128K", ">=128K"
+    };
+    return labels[bucket];
+}
+
+void PlaybackMetrics::reset() {
+    decoded.store(0, std::memory_order_relaxed);
+    rendered.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    cpuNs.store(0, std::memory_order_relaxed);
+}
\ No newline at end of file
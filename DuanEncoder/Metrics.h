@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// 当前线程已消耗的CPU时间（纳秒），工作线程自己调用后写入计数器
+int64_t currentThreadCpuNs();
+// 当前进程所有线程的CPU时间（纳秒），编码工作进程上报用
+int64_t currentProcessCpuNs();
+
+// 编码线程原子累加、界面定时采样的计数器；只用 relaxed 原子操作，不发信号
+struct EncodeMetrics {
+    static const int kSizeBuckets = 10;   // 包大小按2的幂分桶：<512B, <1K, ... <128K, >=128K
+
+    EncodeMetrics();
+    void reset(int64_t totalFrames, double frameRate);
+    void addPacket(int size);
+    static int bucketOf(int size);
+    static const char* bucketLabel(int bucket);
+
+    std::atomic<bool> running{ false };
+    std::atomic<int64_t> totalFrames{ 0 };
+    std::atomic<int64_t> frames{ 0 };      // 已输出的包（一帧一包）
+    std::atomic<int64_t> bytes{ 0 };
+    std::atomic<int64_t> cpuNs{ 0 };
+    std::atomic<double> frameRate{ 25.0 };
+    std::atomic<int64_t> sizeBuckets[kSizeBuckets];
+};
+
+// 播放线程（单路或多路拼接）的计数器
+struct PlaybackMetrics {
+    void reset();
+
+    std::atomic<bool> running{ false };
+    std::atomic<int64_t> decoded{ 0 };
+    std::atomic<int64_t> rendered{ 0 };
+    std::atomic<int64_t> dropped{ 0 };     // 拼接播放为丢弃的帧，单路播放为错过显示时刻的帧
+    std::atomic<int64_t> cpuNs{ 0 };
+};
\ No newline at end of file
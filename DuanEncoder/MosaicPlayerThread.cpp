@@ -0,0 +1,407 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "MosaicPlayerThread.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 每路最多缓存的已解码帧数，队列满时该路解码任务暂停，不占用线程池
+const int kMaxQueuedFrames = 6;
+const int kMaxWindowWidth = 1600;
+const int kMaxWindowHeight = 900;
+}
+
+MosaicPlayerThread::MosaicPlayerThread(QObject* parent)
+    : QThread(parent) {}
+
+MosaicPlayerThread::~MosaicPlayerThread() {
+    stopPlayback();
+    wait();
+}
+
+void MosaicPlayerThread::setFiles(const QStringList& files) {
+    m_files = files.mid(0, kMaxStreams);
+}
+
+void MosaicPlayerThread::stopPlayback() {
+    m_stopFlag = true;
+}
+
+void MosaicPlayerThread::printError(const char* msg, int errnum) {
+    char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+    av_strerror(errnum, err_buf, sizeof(err_buf));
+    log(LogError, QString("%1: %2").arg(msg).arg(err_buf));
+}
+
+void MosaicPlayerThread::log(LogLevel level, const QString& text) {
+    LogSink::instance().write(level, "mosaic", text);
+}
+
+bool MosaicPlayerThread::openTile(Tile* tile) {
+    const AVCodec* codec = nullptr;
+    AVStream* stream = nullptr;
+    int ret = avformat_open_input(&tile->fmt_ctx, tile->path.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0) {
+        printError("Unable to open the input file.", ret);
+        return false;
+    }
+
+    ret = avformat_find_stream_info(tile->fmt_ctx, nullptr);
+    if (ret < 0) {
+        printError("Unable to retrieve stream information.", ret);
+        return false;
+    }
+
+    tile->stream_index = av_find_best_stream(tile->fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (tile->stream_index < 0 || !codec) {
+        log(LogError, QString("No video stream found in '%1'.").arg(tile->path));
+        return false;
+    }
+    stream = tile->fmt_ctx->streams[tile->stream_index];
+
+    tile->codec_ctx = avcodec_alloc_context3(codec);
+    if (!tile->codec_ctx) {
+        log(LogError, "Unable to allocate the decoder context.");
+        return false;
+    }
+
+    ret = avcodec_parameters_to_context(tile->codec_ctx, stream->codecpar);
+    if (ret < 0) {
+        printError("Unable to copy codec parameters.", ret);
+        return false;
+    }
+
+    // 所有路共享一个线程池，解码器内部不再开线程，避免线程数超过核数
+    tile->codec_ctx->thread_count = 1;
+    ret = avcodec_open2(tile->codec_ctx, codec, nullptr);
+    if (ret < 0) {
+        printError("Unable to open the decoder.", ret);
+        return false;
+    }
+
+    tile->time_base = stream->time_base;
+    AVRational frame_rate = av_guess_frame_rate(tile->fmt_ctx, stream, nullptr);
+    if (frame_rate.num > 0 && frame_rate.den > 0) {
+        tile->frame_duration = av_q2d(av_inv_q(frame_rate));
+    }
+
+    tile->frame = av_frame_alloc();
+    tile->pkt = av_packet_alloc();
+    if (!tile->frame || !tile->pkt) {
+        log(LogError, "Unable to allocate a frame or packet.");
+        return false;
+    }
+
+    tile->sws_ctx = sws_getContext(tile->codec_ctx->width, tile->codec_ctx->height, tile->codec_ctx->pix_fmt,
+        tile->rect.w, tile->rect.h, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (!tile->sws_ctx) {
+        log(LogError, "Unable to create the image conversion context.");
+        return false;
+    }
+
+    return true;
+}
+
+void MosaicPlayerThread::closeTile(Tile* tile) {
+    for (AVFrame* f : tile->queue) av_frame_free(&f);
+    for (AVFrame* f : tile->freeFrames) av_frame_free(&f);
+    tile->queue.clear();
+    tile->freeFrames.clear();
+    if (tile->sws_ctx) sws_freeContext(tile->sws_ctx);
+    if (tile->frame) av_frame_free(&tile->frame);
+    if (tile->pkt) av_packet_free(&tile->pkt);
+    if (tile->codec_ctx) avcodec_free_context(&tile->codec_ctx);
+    if (tile->fmt_ctx) avformat_close_input(&tile->fmt_ctx);
+}
+
+AVFrame* MosaicPlayerThread::acquireFrame(Tile* tile) {
+    {
+        QMutexLocker locker(&tile->mutex);
+        if (!tile->freeFrames.empty()) {
+            AVFrame* f = tile->freeFrames.back();
+            tile->freeFrames.pop_back();
+            return f;
+        }
+    }
+
+    AVFrame* f = av_frame_alloc();
+    if (!f) return nullptr;
+    f->format = AV_PIX_FMT_YUV420P;
+    f->width = tile->rect.w;
+    f->height = tile->rect.h;
+    if (av_frame_get_buffer(f, 32) < 0) {
+        av_frame_free(&f);
+        return nullptr;
+    }
+    return f;
+}
+
+void MosaicPlayerThread::releaseFrame(Tile* tile, AVFrame* frame) {
+    QMutexLocker locker(&tile->mutex);
+    tile->freeFrames.push_back(frame);
+}
+
+void MosaicPlayerThread::scheduleDecode(Tile* tile) {
+    {
+        QMutexLocker locker(&tile->mutex);
+        if (m_stopFlag || tile->eof || tile->taskQueued ||
+            (int)tile->queue.size() >= kMaxQueuedFrames) {
+            return;
+        }
+        tile->taskQueued = true;
+    }
+    m_decodePool.start([this, tile]() { decodeStep(tile); });
+}
+
+void MosaicPlayerThread::decodeStep(Tile* tile) {
+    // 每个任务只解出一帧就让出线程，重新排到线程池队尾；
+    // 某一路解码慢时只会占用一个线程，其他路照常轮转
+    bool produced = false;
+    while (!m_stopFlag && !tile->eof && !produced) {
+        int ret = avcodec_receive_frame(tile->codec_ctx, tile->frame);
+        if (ret == 0) {
+            AVFrame* out = acquireFrame(tile);
+            if (out) {
+                int64_t ts = tile->frame->best_effort_timestamp;
+                double pts = (ts == AV_NOPTS_VALUE)
+                    ? tile->decodedCount * tile->frame_duration
+                    : ts * av_q2d(tile->time_base);
+                if (tile->firstPts < 0) tile->firstPts = pts;
+                out->pts = (int64_t)std::llround((pts - tile->firstPts) * 1000000.0);
+
+                sws_scale(tile->sws_ctx, (const uint8_t* const*)tile->frame->data, tile->frame->linesize,
+                    0, tile->codec_ctx->height, out->data, out->linesize);
+
+                QMutexLocker locker(&tile->mutex);
+                tile->queue.push_back(out);
+            }
+            tile->decodedCount++;
+            m_metrics.decoded.fetch_add(1, std::memory_order_relaxed);
+            av_frame_unref(tile->frame);
+            produced = true;
+        }
+        else if (ret == AVERROR(EAGAIN) && !tile->inputDone) {
+            ret = av_read_frame(tile->fmt_ctx, tile->pkt);
+            if (ret < 0) {
+                // 读到文件尾，进入冲刷模式
+                avcodec_send_packet(tile->codec_ctx, nullptr);
+                tile->inputDone = true;
+                continue;
+            }
+            if (tile->pkt->stream_index == tile->stream_index) {
+                ret = avcodec_send_packet(tile->codec_ctx, tile->pkt);
+                if (ret < 0 && ret != AVERROR(EAGAIN)) {
+                    printError("send packet to decoder failure.", ret);
+                    tile->eof = true;
+                }
+            }
+            av_packet_unref(tile->pkt);
+        }
+        else {
+            if (ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+                printError("receive decode frame failure", ret);
+            }
+            tile->eof = true;
+        }
+    }
+
+    {
+        QMutexLocker locker(&tile->mutex);
+        tile->taskQueued = false;
+    }
+    scheduleDecode(tile);
+}
+
+void MosaicPlayerThread::reportStats(double elapsed, double interval) {
+    for (size_t i = 0; i < m_tiles.size(); i++) {
+        Tile* tile = m_tiles[i];
+        double fps = interval > 0 ? (tile->shownCount - tile->lastShownCount) / interval : 0.0;
+        tile->lastShownCount = tile->shownCount;
+        log(LogInfo, QString("[%1s] tile %2: %3 fps, shown %4, dropped %5")
+            .arg(elapsed, 0, 'f', 1).arg(i).arg(fps, 0, 'f', 1)
+            .arg(tile->shownCount).arg(tile->droppedCount));
+    }
+}
+
+void MosaicPlayerThread::run() {
+    m_stopFlag = false;
+    int64_t cpu_start = currentThreadCpuNs();
+    int count = m_files.size();
+    int cols = 0;
+    int rows = 0;
+    int tile_w = 0;
+    int tile_h = 0;
+    Uint64 freq = 0;
+    Uint64 start = 0;
+    double last_report = 0.0;
+    SDL_Event event;
+
+    if (count == 0) {
+        emit playError("No files selected for mosaic playback.");
+        emit playFinished();
+        return;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
+        emit playError(QString("SDL init failure: %1").arg(SDL_GetError()));
+        emit playFinished();
+        return;
+    }
+    m_metrics.reset();
+    m_metrics.running.store(true, std::memory_order_relaxed);
+
+    // 计算网格布局，分块宽高取偶数以便YUV420P
+    cols = (int)std::ceil(std::sqrt((double)count));
+    rows = (count + cols - 1) / cols;
+    tile_w = (kMaxWindowWidth / cols) & ~1;
+    tile_h = (kMaxWindowHeight / rows) & ~1;
+
+    m_decodePool.setMaxThreadCount(std::max(1, std::min(QThread::idealThreadCount(), count)));
+
+    for (int i = 0; i < count; i++) {
+        Tile* tile = new Tile();
+        tile->path = m_files[i];
+        tile->rect.x = (i % cols) * tile_w;
+        tile->rect.y = (i / cols) * tile_h;
+        tile->rect.w = tile_w;
+        tile->rect.h = tile_h;
+        m_tiles.push_back(tile);
+        if (!openTile(tile)) {
+            emit playError(QString("Unable to open '%1' for mosaic playback.").arg(tile->path));
+            goto cleanup;
+        }
+        log(LogInfo, QString("tile %1: %2 (%3x%4)").arg(i).arg(tile->path)
+            .arg(tile->codec_ctx->width).arg(tile->codec_ctx->height));
+    }
+
+    m_sdlWindow = SDL_CreateWindow("duan mosaic player", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        cols * tile_w, rows * tile_h, SDL_WINDOW_SHOWN);
+    if (!m_sdlWindow) {
+        emit playError(QString("Unable to create the SDL window.: %1").arg(SDL_GetError()));
+        goto cleanup;
+    }
+
+    m_sdlRenderer = SDL_CreateRenderer(m_sdlWindow, -1, SDL_RENDERER_ACCELERATED);
+    if (!m_sdlRenderer) {
+        emit playError(QString("Unable to create the SDL renderer.: %1").arg(SDL_GetError()));
+        goto cleanup;
+    }
+
+    // 所有分块共用一张纹理（图集），每帧只提交一次渲染
+    m_sdlTexture = SDL_CreateTexture(m_sdlRenderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING,
+        cols * tile_w, rows * tile_h);
+    if (!m_sdlTexture) {
+        emit playError(QString("Unable to create the SDL texture.: %1").arg(SDL_GetError()));
+        goto cleanup;
+    }
+
+    log(LogInfo, QString("mosaic: %1 streams, %2x%3 grid, tile %4x%5, %6 decode threads")
+        .arg(count).arg(cols).arg(rows).arg(tile_w).arg(tile_h).arg(m_decodePool.maxThreadCount()));
+
+    for (Tile* tile : m_tiles) {
+        scheduleDecode(tile);
+    }
+
+    // 等每一路都解出首帧后再启动时钟，避免打开慢的文件一开始就丢帧
+    while (!m_stopFlag) {
+        bool primed = true;
+        for (Tile* tile : m_tiles) {
+            QMutexLocker locker(&tile->mutex);
+            if (tile->queue.empty() && !tile->eof) primed = false;
+        }
+        if (primed) break;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) m_stopFlag = true;
+        }
+        SDL_Delay(1);
+    }
+
+    freq = SDL_GetPerformanceFrequency();
+    start = SDL_GetPerformanceCounter();
+
+    while (!m_stopFlag) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT ||
+                (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE)) {
+                m_stopFlag = true;
+            }
+        }
+
+        // 统一主时钟，各路按自身PTS对齐
+        int64_t now_us = (int64_t)((SDL_GetPerformanceCounter() - start) * 1000000.0 / freq);
+        bool updated = false;
+        bool all_done = true;
+
+        for (Tile* tile : m_tiles) {
+            AVFrame* show = nullptr;
+            {
+                QMutexLocker locker(&tile->mutex);
+                // 取出所有已到期的帧，只显示最新一帧，其余计为丢帧
+                while (!tile->queue.empty() && tile->queue.front()->pts <= now_us) {
+                    if (show) {
+                        tile->freeFrames.push_back(show);
+                        tile->droppedCount++;
+                        m_metrics.dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    show = tile->queue.front();
+                    tile->queue.pop_front();
+                }
+                if (!tile->eof || !tile->queue.empty()) all_done = false;
+            }
+
+            if (show) {
+                SDL_UpdateYUVTexture(m_sdlTexture, &tile->rect,
+                    show->data[0], show->linesize[0],
+                    show->data[1], show->linesize[1],
+                    show->data[2], show->linesize[2]);
+                tile->shownCount++;
+                m_metrics.rendered.fetch_add(1, std::memory_order_relaxed);
+                updated = true;
+                releaseFrame(tile, show);
+            }
+            scheduleDecode(tile);
+        }
+
+        if (updated) {
+            SDL_RenderClear(m_sdlRenderer);
+            SDL_RenderCopy(m_sdlRenderer, m_sdlTexture, nullptr, nullptr);
+            SDL_RenderPresent(m_sdlRenderer);
+        }
+
+        double elapsed = now_us / 1000000.0;
+        if (elapsed - last_report >= 2.0) {
+            reportStats(elapsed, elapsed - last_report);
+            last_report = elapsed;
+        }
+
+        m_metrics.cpuNs.store(currentThreadCpuNs() - cpu_start, std::memory_order_relaxed);
+        if (all_done) break;
+        SDL_Delay(2);
+    }
+
+    reportStats((SDL_GetPerformanceCounter() - start) / (double)freq,
+        (SDL_GetPerformanceCounter() - start) / (double)freq - last_report);
+    log(LogInfo, "mosaic player finished");
+
+cleanup:
+    m_stopFlag = true;
+    m_decodePool.waitForDone();
+    for (Tile* tile : m_tiles) {
+        closeTile(tile);
+        delete tile;
+    }
+    m_tiles.clear();
+
+    if (m_sdlTexture) SDL_DestroyTexture(m_sdlTexture);
+    if (m_sdlRenderer) SDL_DestroyRenderer(m_sdlRenderer);
+    if (m_sdlWindow) SDL_DestroyWindow(m_sdlWindow);
+    m_sdlTexture = nullptr;
+    m_sdlRenderer = nullptr;
+    m_sdlWindow = nullptr;
+
+    SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_TIMER);
+
+    m_metrics.running.store(false, std::memory_order_relaxed);
+    emit playFinished();
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "LogSink.h"
+#include "Metrics.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/error.h>
+#include <libavutil/rational.h>
+#include <libswscale/swscale.h>
+}
+
+// 多路同时播放：各文件共享解码线程池，拼接到同一个 SDL 窗口的纹理中，按PTS同步
+class MosaicPlayerThread : public QThread
+{
+    Q_OBJECT
+public:
+    static const int kMaxStreams = 16;
+
+    explicit MosaicPlayerThread(QObject* parent = nullptr);
+    ~MosaicPlayerThread() override;
+
+    void setFiles(const QStringList& files);
+    void stopPlayback();
+    const PlaybackMetrics& metrics() const { return m_metrics; }
+
+protected:
+    void run() override;
+
+signals:
+    void playError(const QString& error);
+    void playFinished();
+
+private:
+    // 单路流的状态
+    struct Tile {
+        QString path;
+        AVFormatContext* fmt_ctx = nullptr;
+        AVCodecContext* codec_ctx = nullptr;
+        SwsContext* sws_ctx = nullptr;
+        AVFrame* frame = nullptr;
+        AVPacket* pkt = nullptr;
+        int stream_index = -1;
+        AVRational time_base{ 1, 25 };
+        double frame_duration = 0.04;
+        SDL_Rect rect{};
+
+        // 解码任务 -> 渲染线程的帧队列（已缩放为分块尺寸）
+        QMutex mutex;
+        std::deque<AVFrame*> queue;
+        std::vector<AVFrame*> freeFrames;
+        bool taskQueued = false;
+        bool inputDone = false;
+        std::atomic<bool> eof{ false };
+
+        double firstPts = -1.0;
+        int64_t decodedCount = 0;
+        int64_t shownCount = 0;
+        int64_t droppedCount = 0;
+        int64_t lastShownCount = 0;
+    };
+
+    void printError(const char* msg, int errnum);
+    void log(LogLevel level, const QString& text);
+    bool openTile(Tile* tile);
+    void closeTile(Tile* tile);
+    AVFrame* acquireFrame(Tile* tile);
+    void releaseFrame(Tile* tile, AVFrame* frame);
+    void scheduleDecode(Tile* tile);
+    void decodeStep(Tile* tile);
+    void reportStats(double elapsed, double interval);
+
+    QStringList m_files;
+    std::atomic<bool> m_stopFlag{ false };
+    PlaybackMetrics m_metrics;
+    std::vector<Tile*> m_tiles;
+    QThreadPool m_decodePool;
+    SDL_Window* m_sdlWindow = nullptr;
+    SDL_Renderer* m_sdlRenderer = nullptr;
+    SDL_Texture* m_sdlTexture = nullptr;
+};
\ No newline at end of file
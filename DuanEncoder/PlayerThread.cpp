@@ -1,252 +1,1378 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "PlayerThread.h"
+#include "Tracer.h"
 #include <QDebug>
+#include <QMutexLocker>
+#include <QFile>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+// PageUp/PageDown 一次跳转的帧数
+const int kJumpFrames = 25;
+// rtp:// 输入的 AVIOContext 缓冲
+const int kRtpIoBufferSize = 64 * 1024;
+
+// 裸YUV像素格式对应的SDL纹理格式，SDL不支持的格式返回 SDL_PIXELFORMAT_UNKNOWN
+Uint32 sdlFormatFor(AVPixelFormat fmt) {
+    switch (fmt) {
+    case AV_PIX_FMT_YUV420P: return SDL_PIXELFORMAT_IYUV;
+    case AV_PIX_FMT_NV12:    return SDL_PIXELFORMAT_NV12;
+    case AV_PIX_FMT_NV21:    return SDL_PIXELFORMAT_NV21;
+    case AV_PIX_FMT_YUYV422: return SDL_PIXELFORMAT_YUY2;
+    case AV_PIX_FMT_UYVY422: return SDL_PIXELFORMAT_UYVY;
+    default:                 return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+// 记录GOP索引，一个视频包对应一帧
+void indexGopPacket(std::vector<GopInfo>& gops, const AVPacket* pkt) {
+    if ((pkt->flags & AV_PKT_FLAG_KEY) || gops.empty()) {
+        GopInfo gop;
+        gop.pos = pkt->pos;
+        gop.dts = pkt->dts;
+        gop.firstFrame = gops.empty() ? 0 : gops.back().firstFrame + gops.back().frameCount;
+        gops.push_back(gop);
+    }
+    gops.back().frameCount++;
+}
+
+// 两个文件的解码参数一致时，冲刷后的解码器可以直接解下一个文件
+bool sameDecoderConfig(const AVCodecParameters* a, const AVCodecParameters* b) {
+    return a->codec_id == b->codec_id && a->width == b->width && a->height == b->height &&
+        a->format == b->format && a->extradata_size == b->extradata_size &&
+        (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+}
+}
 
 PlayerThread::PlayerThread(QObject* parent)
-    : QThread(parent), m_stopFlag(false), m_sdlWindow(nullptr),
-    m_sdlRenderer(nullptr), m_sdlTexture(nullptr) {}
+    : QThread(parent), m_sdlWindow(nullptr),
+    m_sdlRenderer(nullptr), m_sdlTexture(nullptr) {
+    // 预取任务串行执行，只占用一个后台线程
+    m_prefetchPool.setMaxThreadCount(1);
+    m_primePool.setMaxThreadCount(1);
+}
 
 PlayerThread::~PlayerThread() {
-    stopPlayback();
+    {
+        QMutexLocker locker(&m_requestMutex);
+        m_quit = true;
+        m_control.cancel();
+        m_requestCond.wakeOne();
+    }
     wait();
 }
 
 void PlayerThread::setFilePath(const QString& filePath) {
-    m_filePath = filePath;
+    setPlaylist(QStringList() << filePath);
+}
+
+void PlayerThread::setPlaylist(const QStringList& files) {
+    QMutexLocker locker(&m_requestMutex);
+    m_playlist = files;
+}
+
+void PlayerThread::setRawYuv(bool enabled, int width, int height, int pixFmt, double fps, int startFrame) {
+    m_rawMode = enabled;
+    m_rawWidth = width;
+    m_rawHeight = height;
+    m_rawPixFmt = pixFmt;
+    m_rawFps = fps > 0 ? fps : 25.0;
+    m_rawStartFrame = std::max(0, startFrame);
+}
+
+void PlayerThread::setGopCacheBudget(int megabytes) {
+    m_gopCache.setBudget((size_t)megabytes * 1024 * 1024);
+}
+
+void PlayerThread::requestPlayback() {
+    {
+        QMutexLocker locker(&m_requestMutex);
+        m_hasRequest = true;
+        m_control.reset();
+        m_requestTimer.start();
+        m_requestCond.wakeOne();
+    }
+    if (!isRunning()) {
+        start();
+    }
+}
+
+void PlayerThread::pausePlayback() {
+    m_control.pause();
+}
+
+void PlayerThread::resumePlayback() {
+    m_control.resume();
 }
 
 void PlayerThread::stopPlayback() {
-    m_stopFlag = true;
+    m_control.cancel();
 }
 
 void PlayerThread::printError(const char* msg, int errnum) {
     char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
     av_strerror(errnum, err_buf, sizeof(err_buf));
-    emit playLog(QString("%1: %2").arg(msg).arg(err_buf));
+    log(LogError, QString("%1: %2").arg(msg).arg(err_buf));
+}
+
+void PlayerThread::log(LogLevel level, const QString& text) {
+    LogSink::instance().write(level, "play", text);
+}
+
+int PlayerThread::decodeNextFrame(AVFrame* frame) {
+    // 预解码阶段已经拿到的首帧先交出去
+    if (m_primedFrame) {
+        av_frame_move_ref(frame, m_primedFrame);
+        av_frame_free(&m_primedFrame);
+        return 0;
+    }
+
+    while (!m_control.isCancelled()) {
+        int ret = 0;
+        {
+            DUAN_TRACE_SCOPE("decode");
+            ret = avcodec_receive_frame(m_codecCtx, frame);
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            return ret;
+        }
+
+        if (m_inputEof) {
+            return AVERROR_EOF;
+        }
+
+        // 读取数据包并解码
+        {
+            DUAN_TRACE_SCOPE("demux");
+            ret = av_read_frame(m_fmtCtx, m_pkt);
+        }
+        if (ret < 0) {
+            // 处理解码器中剩余的帧
+            log(LogInfo, "Processing remaining frames...");
+            m_inputEof = true;
+            avcodec_send_packet(m_codecCtx, nullptr);
+            continue;
+        }
+
+        if (m_pkt->stream_index == m_videoStreamIndex) {
+            indexGopPacket(m_gops, m_pkt);
+
+            // 发送数据包到解码器
+            {
+                DUAN_TRACE_SCOPE("decode");
+                ret = avcodec_send_packet(m_codecCtx, m_pkt);
+            }
+            if (ret < 0) {
+                av_packet_unref(m_pkt);
+                printError("send packet to decoder failure.", ret);
+                return ret;
+            }
+        }
+        av_packet_unref(m_pkt);
+    }
+    return AVERROR_EXIT;
+}
+
+void PlayerThread::fitWindowToDisplay(int sourceWidth, int sourceHeight, int* width, int* height) const {
+    // 初始窗口按显示器可用区域缩小，保持宽高比；预解码线程也会调用，不访问SDL
+    *width = sourceWidth;
+    *height = sourceHeight;
+    if (m_displayBounds.w > 0 && m_displayBounds.h > 0 && sourceWidth > 0 && sourceHeight > 0) {
+        double fit = std::min(1.0, std::min(m_displayBounds.w * 0.9 / sourceWidth, m_displayBounds.h * 0.9 / sourceHeight));
+        *width = std::max(2, (int)(sourceWidth * fit));
+        *height = std::max(2, (int)(sourceHeight * fit));
+    }
+}
+
+bool PlayerThread::updateDisplayRect(int* out_w, int* out_h) {
+    if (SDL_GetRendererOutputSize(m_sdlRenderer, out_w, out_h) < 0 || *out_w <= 0 || *out_h <= 0) {
+        return false;
+    }
+
+    // 按码流宽高比适配窗口，居中显示
+    double scale = std::min((double)*out_w / m_sourceWidth, (double)*out_h / m_sourceHeight);
+    m_sdlRect.w = std::max(2, (int)(m_sourceWidth * scale));
+    m_sdlRect.h = std::max(2, (int)(m_sourceHeight * scale));
+    m_sdlRect.x = (*out_w - m_sdlRect.w) / 2;
+    m_sdlRect.y = (*out_h - m_sdlRect.h) / 2;
+    return true;
+}
+
+bool PlayerThread::ensureRenderTarget() {
+    int out_w = 0;
+    int out_h = 0;
+    if (!updateDisplayRect(&out_w, &out_h)) {
+        return m_sdlTexture != nullptr;
+    }
+
+    // 转换目标取显示尺寸，但不超过解码输出尺寸，放大交给GPU
+    int decoded_w = AV_CEIL_RSHIFT(m_sourceWidth, m_lowres);
+    int decoded_h = AV_CEIL_RSHIFT(m_sourceHeight, m_lowres);
+    int target_w = std::min(m_sdlRect.w, decoded_w) & ~1;
+    int target_h = std::min(m_sdlRect.h, decoded_h) & ~1;
+    target_w = std::max(2, target_w);
+    target_h = std::max(2, target_h);
+    if (m_sdlTexture && target_w == m_targetWidth && target_h == m_targetHeight) {
+        return true;
+    }
+
+    // 尺寸确实变化时才重建纹理和缓冲区
+    if (m_sdlTexture) SDL_DestroyTexture(m_sdlTexture);
+    m_sdlTexture = SDL_CreateTexture(m_sdlRenderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, target_w, target_h);
+    if (!m_sdlTexture) {
+        emit playError(QString("Unable to create the SDL texture.: %1").arg(SDL_GetError()));
+        return false;
+    }
+
+    int buffer_size = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, target_w, target_h, 1);
+    av_free(m_outBuffer);
+    m_outBuffer = (uint8_t*)av_malloc(buffer_size * sizeof(uint8_t));
+    if (!m_outBuffer) {
+        emit playError("Unable to allocate the conversion buffer.");
+        return false;
+    }
+    av_image_fill_arrays(m_frameYuv->data, m_frameYuv->linesize, m_outBuffer, AV_PIX_FMT_YUV420P, target_w, target_h, 1);
+
+    m_targetWidth = target_w;
+    m_targetHeight = target_h;
+    log(LogInfo, QString("render target %1x%2 (window %3x%4, decoded %5x%6)")
+        .arg(target_w).arg(target_h).arg(out_w).arg(out_h).arg(decoded_w).arg(decoded_h));
+    return true;
+}
+
+void PlayerThread::calibrateFullSize(AVFrame* frame, int sourceWidth, int sourceHeight, bool synthetic) {
+    // 测一次按码流原始尺寸转换的耗时，作为节省量的对照。
+    // lowres 解码出的帧比原始尺寸小，拿它放大到原始尺寸测的是放大而不是原尺寸转换，
+    // 这时换成同像素格式、原始尺寸的空白帧来测
+    uint8_t* data[4] = { nullptr };
+    int linesize[4] = { 0 };
+    uint8_t* src[4] = { nullptr };
+    int src_linesize[4] = { 0 };
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    SwsContext* full = nullptr;
+    int src_w = synthetic ? sourceWidth : frame->width;
+    int src_h = synthetic ? sourceHeight : frame->height;
+    int src_size = 0;
+
+    if (synthetic) {
+        src_size = av_image_alloc(src, src_linesize, sourceWidth, sourceHeight, format, 32);
+        if (src_size < 0) goto cleanup;
+        memset(src[0], 0, src_size);
+    }
+    else {
+        memcpy(src, frame->data, sizeof(src));
+        memcpy(src_linesize, frame->linesize, sizeof(src_linesize));
+    }
+    full = sws_getContext(src_w, src_h, format,
+        sourceWidth, sourceHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC, nullptr, nullptr, nullptr);
+    if (!full) goto cleanup;
+    if (av_image_alloc(data, linesize, sourceWidth, sourceHeight, AV_PIX_FMT_YUV420P, 32) >= 0) {
+        const int runs = 4;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < runs; i++) {
+            sws_scale(full, (const uint8_t* const*)src, src_linesize, 0, src_h, data, linesize);
+        }
+        m_fullConvertMs = timer.nsecsElapsed() / 1000000.0 / runs;
+        av_freep(&data[0]);
+    }
+
+cleanup:
+    sws_freeContext(full);
+    if (synthetic) av_freep(&src[0]);
+    av_frame_free(&frame);
+}
+
+void PlayerThread::logRenderStats() {
+    double secs = (m_statTimer.elapsed() - m_statLastMs) / 1000.0;
+    if (m_statFrames == 0 || secs <= 0) return;
+
+    double convert_ms = m_statConvertNs / 1000000.0 / m_statFrames;
+    double upload_mbps = m_statUploadBytes / secs / (1024.0 * 1024.0);
+    double full_mbps = (double)m_sourceWidth * m_sourceHeight * 3 / 2 * m_statFrames / secs / (1024.0 * 1024.0);
+    double full_ms = m_fullConvertMs;
+    QString full_convert = full_ms < 0 ? QString("not measured yet")
+        : QString("%1 ms%2").arg(full_ms, 0, 'f', 2).arg(m_lowres > 0 ? " on a blank source-size frame" : "");
+    log(LogInfo, QString("render %1x%2 from %3x%4 (lowres %5): convert %6 ms/frame (full size %7), "
+        "upload %8 MB/s (full size %9 MB/s, %10% saved)")
+        .arg(m_targetWidth).arg(m_targetHeight).arg(m_sourceWidth).arg(m_sourceHeight).arg(m_lowres)
+        .arg(convert_ms, 0, 'f', 2).arg(full_convert)
+        .arg(upload_mbps, 0, 'f', 1).arg(full_mbps, 0, 'f', 1)
+        .arg(full_mbps > 0 ? (1.0 - upload_mbps / full_mbps) * 100.0 : 0.0, 0, 'f', 0));
+
+    m_statLastMs = m_statTimer.elapsed();
+    m_statFrames = 0;
+    m_statConvertNs = 0;
+    m_statUploadBytes = 0;
+}
+
+void PlayerThread::presentFrame(const AVFrame* frame) {
+    QElapsedTimer timer;
+
+    // 保留最后一帧的引用，窗口缩放后暂停状态下也能重绘
+    if (frame != m_lastFrame) {
+        av_frame_unref(m_lastFrame);
+        av_frame_ref(m_lastFrame, frame);
+    }
+    // 对照测量放到预取线程池里，不占显示路径；窗口缩放不影响原始尺寸的转换耗时，每个输入只测一次
+    if (!m_calibrationQueued) {
+        m_calibrationQueued = true;
+        AVFrame* copy = av_frame_clone(frame);
+        if (copy) {
+            int source_w = m_sourceWidth;
+            int source_h = m_sourceHeight;
+            bool synthetic = m_lowres > 0;
+            m_prefetchPool.start([this, copy, source_w, source_h, synthetic]() {
+                DUAN_TRACE_THREAD("gop prefetch");
+                DUAN_TRACE_SCOPE("calibrate_full_size");
+                calibrateFullSize(copy, source_w, source_h, synthetic);
+            });
+        }
+    }
+
+    // 转换图像格式为YUV420P，直接缩放到显示尺寸
+    timer.start();
+    m_swsCtx = sws_getCachedContext(m_swsCtx, frame->width, frame->height, (AVPixelFormat)frame->format,
+        m_targetWidth, m_targetHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC, nullptr, nullptr, nullptr);
+    if (!m_swsCtx) return;
+    {
+        DUAN_TRACE_SCOPE("sws_scale");
+        sws_scale(m_swsCtx, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height, m_frameYuv->data, m_frameYuv->linesize);
+    }
+    m_statConvertNs += timer.nsecsElapsed();
+
+    // 更新纹理并渲染
+    {
+        DUAN_TRACE_SCOPE("upload");
+        SDL_UpdateYUVTexture(m_sdlTexture, nullptr,
+            m_frameYuv->data[0], m_frameYuv->linesize[0],
+            m_frameYuv->data[1], m_frameYuv->linesize[1],
+            m_frameYuv->data[2], m_frameYuv->linesize[2]);
+    }
+    m_statUploadBytes += (int64_t)m_targetWidth * m_targetHeight * 3 / 2;
+
+    {
+        DUAN_TRACE_SCOPE("present");
+        SDL_RenderClear(m_sdlRenderer);
+        SDL_RenderCopy(m_sdlRenderer, m_sdlTexture, nullptr, &m_sdlRect);
+        SDL_RenderPresent(m_sdlRenderer);
+    }
+    notePresented();
+
+    if (m_ttffPending) {
+        reportFirstFrame(m_decoderReused ? "decoder reused" : "new decoder");
+    }
+
+    m_statFrames++;
+    if (m_statTimer.elapsed() - m_statLastMs >= 5000) {
+        logRenderStats();
+    }
+}
+
+void PlayerThread::notePresented() {
+    // 连续播放时两次显示间隔超过两帧，错过的显示时刻计为丢帧；暂停和单步不计
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (m_paused || m_control.isPaused()) {
+        m_lastPresentTick = 0;
+    }
+    else {
+        if (m_lastPresentTick) {
+            double gap_ms = (now - m_lastPresentTick) * 1000.0 / SDL_GetPerformanceFrequency();
+            if (gap_ms > m_frameIntervalMs * 2) {
+                m_metrics.dropped.fetch_add((int64_t)(gap_ms / m_frameIntervalMs) - 1, std::memory_order_relaxed);
+            }
+        }
+        m_lastPresentTick = now;
+    }
+    m_metrics.rendered.fetch_add(1, std::memory_order_relaxed);
+    if (m_rtp) m_rtp->notePresented();
+    m_metrics.cpuNs.store(currentThreadCpuNs() - m_cpuStart, std::memory_order_relaxed);
+}
+
+void PlayerThread::reportFirstFrame(const QString& detail) {
+    m_ttffPending = false;
+    log(LogInfo, QString("time to first frame (%1, %2): %3 ms")
+        .arg(m_ttffKind).arg(detail).arg(m_ttffTimer.nsecsElapsed() / 1000000.0, 0, 'f', 1));
+}
+
+void PlayerThread::drainWindowEvents() {
+    // SDL 事件队列是整个进程共用的，拼接播放等其他窗口的关闭事件不能在这里丢掉
+    const Uint32 window_id = SDL_GetWindowID(m_sdlWindow);
+    std::vector<SDL_Event> others;
+    SDL_Event events[32];
+    int count = 0;
+
+    SDL_PumpEvents();
+    while ((count = SDL_PeepEvents(events, 32, SDL_GETEVENT, SDL_WINDOWEVENT, SDL_WINDOWEVENT)) > 0) {
+        for (int i = 0; i < count; i++) {
+            if (events[i].window.windowID != window_id) others.push_back(events[i]);
+        }
+    }
+    if (!others.empty()) {
+        SDL_PeepEvents(others.data(), (int)others.size(), SDL_ADDEVENT, SDL_WINDOWEVENT, SDL_WINDOWEVENT);
+    }
+}
+
+void PlayerThread::handleEvents() {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT ||
+            (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE)) {
+            m_control.cancel();
+        }
+        else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            m_resizePending = true;
+        }
+        else if (event.type == SDL_KEYDOWN) {
+            switch (event.key.keysym.sym) {
+            case SDLK_SPACE:
+                m_paused = !m_paused;
+                break;
+            case SDLK_LEFT:
+                m_paused = true;
+                m_pendingStep = -1;
+                break;
+            case SDLK_RIGHT:
+                m_paused = true;
+                m_pendingStep = 1;
+                break;
+            case SDLK_PAGEUP:
+                m_paused = true;
+                m_pendingStep = -kJumpFrames;
+                break;
+            case SDLK_PAGEDOWN:
+                m_paused = true;
+                m_pendingStep = kJumpFrames;
+                break;
+            case SDLK_HOME:
+                m_paused = true;
+                m_pendingStep = INT_MIN / 2;
+                break;
+            case SDLK_END:
+                m_paused = true;
+                m_pendingStep = INT_MAX / 2;
+                break;
+            case SDLK_n:
+                m_skipFile = true;
+                break;
+            case SDLK_r:
+                m_reverse = !m_reverse;
+                m_paused = false;
+                log(LogInfo, m_reverse ? "reverse playback" : "forward playback");
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+int PlayerThread::gopOfFrame(int frameIndex) const {
+    auto it = std::upper_bound(m_gops.begin(), m_gops.end(), frameIndex,
+        [](int index, const GopInfo& gop) { return index < gop.firstFrame; });
+    if (it == m_gops.begin()) return -1;
+    return (int)(it - m_gops.begin()) - 1;
+}
+
+void PlayerThread::onLiveFrame(const AVFrame* frame, int frameIndex) {
+    int gop = gopOfFrame(frameIndex);
+    if (gop != m_liveGopIndex) {
+        finishLiveGop();
+        m_liveGopIndex = gop;
+    }
+
+    // 顺序播放时顺带把当前GOP留在内存里，后退时无需重新解码
+    size_t bytes = GopCache::frameBytes(frame);
+    if (m_liveGopOverflow || m_liveGopBytes + bytes > m_gopCache.budget()) {
+        // 整个GOP超出预算，放弃本GOP，后退时再按需解码
+        GopCache::freeFrames(m_liveGop);
+        m_liveGopBytes = 0;
+        m_liveGopOverflow = true;
+        return;
+    }
+    AVFrame* clone = av_frame_clone(frame);
+    if (clone) {
+        m_liveGop.push_back(clone);
+        m_liveGopBytes += bytes;
+    }
+}
+
+void PlayerThread::finishLiveGop() {
+    if (m_liveGopIndex >= 0 && !m_liveGop.empty() &&
+        (int)m_liveGop.size() == m_gops[m_liveGopIndex].frameCount) {
+        m_gopCache.insert(m_liveGopIndex, m_liveGop);
+    }
+    GopCache::freeFrames(m_liveGop);
+    m_liveGopBytes = 0;
+    m_liveGopOverflow = false;
+    m_liveGopIndex = -1;
+}
+
+bool PlayerThread::showCachedFrame(int frameIndex) {
+    int gop_index = gopOfFrame(frameIndex);
+    if (gop_index < 0) return false;
+    const GopInfo& gop = m_gops[gop_index];
+    int offset = frameIndex - gop.firstFrame;
+    AVFrame* frame = av_frame_alloc();
+    bool found = false;
+    if (!frame) return false;
+
+    if (gop_index == m_liveGopIndex && offset < (int)m_liveGop.size()) {
+        found = av_frame_ref(frame, m_liveGop[offset]) >= 0;
+    }
+    else if (m_gopCache.lookup(gop_index, offset, frame)) {
+        found = true;
+    }
+    else if (m_rtp) {
+        // 实时流只能从缓存里取
+    }
+    else {
+        // 未命中：在播放线程同步解码整个GOP并放入缓存
+        std::vector<AVFrame*> frames;
+        int ret = m_seekDecoder.isOpen() ? 0 : m_seekDecoder.open(m_filePath);
+        if (ret >= 0) {
+            DUAN_TRACE_SCOPE("gop_decode");
+            ret = m_seekDecoder.decode(gop, frames);
+        }
+        if (ret < 0) {
+            printError("Unable to decode GOP for frame stepping", ret);
+        }
+        else if (offset < (int)frames.size()) {
+            found = av_frame_ref(frame, frames[offset]) >= 0;
+            m_gopCache.insert(gop_index, frames);
+        }
+        GopCache::freeFrames(frames);
+    }
+
+    if (found) {
+        presentFrame(frame);
+        m_viewFrame = frameIndex;
+
+        // 预取相邻GOP；后面的GOP只有在顺序解码器已经越过时才需要
+        if (gop_index > 0) prefetchGop(gop_index - 1);
+        if (gop_index + 1 < (int)m_gops.size() && gop_index + 1 != m_liveGopIndex &&
+            m_gops[gop_index + 1].firstFrame + m_gops[gop_index + 1].frameCount <= m_decodedFrames) {
+            prefetchGop(gop_index + 1);
+        }
+    }
+    av_frame_free(&frame);
+    return found;
+}
+
+void PlayerThread::prefetchGop(int gopIndex) {
+    if (m_rtp || gopIndex == m_liveGopIndex || m_gopCache.contains(gopIndex)) return;
+    {
+        QMutexLocker locker(&m_prefetchMutex);
+        if (m_prefetching.contains(gopIndex)) return;
+        m_prefetching.insert(gopIndex);
+    }
+
+    GopInfo gop = m_gops[gopIndex];
+    m_prefetchPool.start([this, gop, gopIndex]() {
+        DUAN_TRACE_THREAD("gop prefetch");
+        DUAN_TRACE_SCOPE("gop_prefetch");
+        std::vector<AVFrame*> frames;
+        if (!m_control.isCancelled() && !m_gopCache.contains(gopIndex)) {
+            int ret = m_prefetchDecoder.isOpen() ? 0 : m_prefetchDecoder.open(m_filePath);
+            if (ret >= 0 && m_prefetchDecoder.decode(gop, frames) >= 0) {
+                m_gopCache.insert(gopIndex, frames);
+            }
+            GopCache::freeFrames(frames);
+        }
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetching.remove(gopIndex);
+    });
+}
+
+void PlayerThread::logCacheStats() {
+    log(LogInfo, QString("frame %1, GOP cache: hit rate %2% (%3/%4), %5 GOPs, %6 / %7 MB")
+        .arg(m_viewFrame)
+        .arg(m_gopCache.hitRate() * 100.0, 0, 'f', 1)
+        .arg(m_gopCache.hits()).arg(m_gopCache.hits() + m_gopCache.misses())
+        .arg(m_gopCache.gopCount())
+        .arg(m_gopCache.memoryUsed() / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(m_gopCache.budget() / (1024.0 * 1024.0), 0, 'f', 0));
 }
 
 void PlayerThread::run() {
-    m_stopFlag = false;
-    AVFormatContext* fmt_ctx = nullptr;
-    AVCodecContext* codec_ctx = nullptr;
+    DUAN_TRACE_THREAD("player");
+    while (1) {
+        QStringList playlist;
+        {
+            // 空闲时隐藏窗口等待下一次请求，期间继续处理窗口消息
+            QMutexLocker locker(&m_requestMutex);
+            while (!m_quit && !m_hasRequest) {
+                m_requestCond.wait(&m_requestMutex, 100);
+                if (m_sdlWindow) {
+                    drainWindowEvents();
+                }
+            }
+            if (m_quit) break;
+            m_hasRequest = false;
+            playlist = m_playlist;
+            m_ttffTimer = m_requestTimer;
+            m_ttffKind = m_sdlWindow ? "warm" : "cold";
+        }
+
+        m_metrics.reset();
+        m_metrics.running.store(true, std::memory_order_relaxed);
+        m_cpuStart = currentThreadCpuNs();
+
+        if (playlist.isEmpty()) {
+            emit playError("No file to play.");
+        }
+        else if (ensureRenderContext()) {
+            if (m_rawMode) {
+                runRawYuv(playlist.first());
+            }
+            else {
+                playPlaylist(playlist);
+            }
+            SDL_HideWindow(m_sdlWindow);
+        }
+        if (m_control.isCancelled()) {
+            log(LogInfo, QString("stopped %1 ms after the request").arg(m_control.msSinceCancel(), 0, 'f', 1));
+        }
+        m_metrics.running.store(false, std::memory_order_relaxed);
+        emit playFinished();
+    }
+
+    destroyRenderContext();
+}
+
+bool PlayerThread::ensureRenderContext() {
+    if (!m_sdlInitialized) {
+        // 初始化SDL
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) < 0) {
+            emit playError(QString("SDL init failure: %1").arg(SDL_GetError()));
+            return false;
+        }
+        m_sdlInitialized = true;
+        if (SDL_GetDisplayUsableBounds(0, &m_displayBounds) < 0) {
+            m_displayBounds = SDL_Rect{};
+        }
+    }
+
+    if (!m_sdlWindow) {
+        // 创建SDL窗口和渲染器，先隐藏，尺寸在第一个文件打开后再定
+        m_sdlWindow = SDL_CreateWindow("duan video player", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 360, SDL_WINDOW_HIDDEN | SDL_WINDOW_RESIZABLE);
+        if (!m_sdlWindow) {
+            emit playError(QString("Unable to create the SDL window.: %1").arg(SDL_GetError()));
+            return false;
+        }
+        m_windowFresh = true;
+    }
+
+    if (!m_sdlRenderer) {
+        m_sdlRenderer = SDL_CreateRenderer(m_sdlWindow, -1, SDL_RENDERER_ACCELERATED);
+        if (!m_sdlRenderer) {
+            emit playError(QString("Unable to create the SDL renderer.: %1").arg(SDL_GetError()));
+            return false;
+        }
+    }
+
+    // 初始化帧和数据包，各文件共用
+    if (!m_frame) m_frame = av_frame_alloc();
+    if (!m_frameYuv) m_frameYuv = av_frame_alloc();
+    if (!m_lastFrame) m_lastFrame = av_frame_alloc();
+    if (!m_pkt) m_pkt = av_packet_alloc();
+    if (!m_frame || !m_frameYuv || !m_lastFrame || !m_pkt) {
+        emit playError("Unable to allocate a frame or packet.");
+        return false;
+    }
+    return true;
+}
+
+void PlayerThread::destroyRenderContext() {
+    m_primePool.waitForDone();
+    m_prefetchPool.waitForDone();
+    if (m_nextReady) {
+        closeInput(&m_nextInput, false);
+        m_nextReady = false;
+    }
+    {
+        QMutexLocker locker(&m_spareMutex);
+        if (m_spareCodecCtx) avcodec_free_context(&m_spareCodecCtx);
+        if (m_sparePar) avcodec_parameters_free(&m_sparePar);
+    }
+
+    if (m_swsCtx) sws_freeContext(m_swsCtx);
+    m_swsCtx = nullptr;
+    if (m_outBuffer) av_freep(&m_outBuffer);
+    if (m_frameYuv) av_frame_free(&m_frameYuv);
+    if (m_lastFrame) av_frame_free(&m_lastFrame);
+    if (m_frame) av_frame_free(&m_frame);
+    if (m_pkt) av_packet_free(&m_pkt);
+
+    // 释放SDL资源
+    if (m_sdlTexture) SDL_DestroyTexture(m_sdlTexture);
+    if (m_sdlRenderer) SDL_DestroyRenderer(m_sdlRenderer);
+    if (m_sdlWindow) SDL_DestroyWindow(m_sdlWindow);
+    m_sdlTexture = nullptr;
+    m_sdlRenderer = nullptr;
+    m_sdlWindow = nullptr;
+    m_targetWidth = 0;
+    m_targetHeight = 0;
+
+    if (m_sdlInitialized) {
+        SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER);
+        m_sdlInitialized = false;
+    }
+}
+
+void PlayerThread::showWindow() {
+    // 窗口第一次显示时按当前文件适配显示器，之后保留用户调整过的尺寸
+    if (m_windowFresh) {
+        int window_w = 0;
+        int window_h = 0;
+        fitWindowToDisplay(m_sourceWidth, m_sourceHeight, &window_w, &window_h);
+        SDL_SetWindowSize(m_sdlWindow, window_w, window_h);
+        SDL_SetWindowPosition(m_sdlWindow, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+        m_windowFresh = false;
+    }
+    SDL_ShowWindow(m_sdlWindow);
+    SDL_RaiseWindow(m_sdlWindow);
+}
+
+bool PlayerThread::openRtpInput(const QString& url, MediaInput* input, const AVInputFormat** format) {
+    QUrl parsed(url);
+    QUrlQuery query(parsed);
+    QString codec_name = query.queryItemValue("codec").toLower();
+    AVCodecID codec_id = (codec_name == "hevc" || codec_name == "h265") ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+    int jitter_ms = query.hasQueryItem("jitter") ? query.queryItemValue("jitter").toInt() : Rtp::kDefaultJitterMs;
+    int port = parsed.port(Rtp::kDefaultPort);
+    uint8_t* buffer = nullptr;
+    QString error;
+
+    input->rtp = new RtpReceiver();
+    input->rtp->setInterruptCallback(m_control.interruptCallback());
+    if (!input->rtp->open((quint16)port, codec_id, jitter_ms, &error)) {
+        log(LogError, QString("Unable to receive RTP: %1").arg(error));
+        return false;
+    }
+
+    // 自定义 IO 不会被 avformat_close_input 释放，由 closeInput 负责
+    buffer = (uint8_t*)av_malloc(kRtpIoBufferSize);
+    if (buffer) {
+        input->customIo = avio_alloc_context(buffer, kRtpIoBufferSize, 0, input->rtp, &RtpReceiver::readPacket,
+            nullptr, nullptr);
+    }
+    if (!input->customIo) {
+        av_free(buffer);
+        log(LogError, "Unable to allocate the RTP input context.");
+        return false;
+    }
+    input->fmtCtx->pb = input->customIo;
+    input->fmtCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    *format = av_find_input_format(codec_id == AV_CODEC_ID_HEVC ? "hevc" : "h264");
+
+    log(LogInfo, QString("Receiving %1 over RTP on UDP port %2, jitter buffer %3 ms")
+        .arg(avcodec_get_name(codec_id)).arg(port).arg(jitter_ms));
+    return true;
+}
+
+bool PlayerThread::openInput(const QString& path, MediaInput* input) {
     const AVCodec* codec = nullptr;
-    AVFrame* frame = nullptr;
-    AVFrame* frame_yuv = nullptr;
-    AVPacket* pkt = nullptr;
-    SwsContext* sws_ctx = nullptr;
+    const AVInputFormat* input_format = nullptr;
     AVCodecParameters* codec_par = nullptr;
-    int video_stream_index = -1;
+    int window_w = 0;
+    int window_h = 0;
     int ret = 0;
-    SDL_Rect sdl_rect{};
-    uint8_t* out_buffer = nullptr;
-    int buffer_size = 0;
-    char info_buf[1024] = { 0 };
-
-    // ʼSDL
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) < 0) {
-        emit playError(QString("SDL init failure: %1").arg(SDL_GetError()));
-        goto cleanup;
-    }
 
-    // ļ
-    ret = avformat_open_input(&fmt_ctx, m_filePath.toUtf8().constData(), nullptr, nullptr);
+    input->path = path;
+
+    // 打开输入文件，挂上中断回调，停止时阻塞的打开/探测/读包立即返回
+    input->fmtCtx = avformat_alloc_context();
+    if (!input->fmtCtx) {
+        log(LogError, "Unable to allocate the format context.");
+        goto fail;
+    }
+    input->fmtCtx->interrupt_callback = m_control.interruptCallback();
+    if (path.startsWith("rtp://", Qt::CaseInsensitive) && !openRtpInput(path, input, &input_format)) {
+        goto fail;
+    }
+    ret = avformat_open_input(&input->fmtCtx, input->rtp ? "" : path.toUtf8().constData(), input_format, nullptr);
     if (ret < 0) {
         printError("Unable to open the input file.", ret);
-        goto cleanup;
+        goto fail;
     }
 
-    // ȡϢ
-    ret = avformat_find_stream_info(fmt_ctx, nullptr);
+    // 获取流信息
+    ret = avformat_find_stream_info(input->fmtCtx, nullptr);
     if (ret < 0) {
         printError("Unable to retrieve stream information.", ret);
-        goto cleanup;
+        goto fail;
     }
 
-    // Ƶ
-    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
-        if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_stream_index = i;
+    // 查找视频流
+    input->streamIndex = -1;
+    for (unsigned int i = 0; i < input->fmtCtx->nb_streams; i++) {
+        if (input->fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            input->streamIndex = i;
             break;
         }
     }
 
-    if (video_stream_index == -1) {
-        emit playError("No video stream found.");
-        goto cleanup;
+    if (input->streamIndex == -1) {
+        log(LogError, "No video stream found.");
+        goto fail;
     }
 
-    // ȡ
-    codec_par = fmt_ctx->streams[video_stream_index]->codecpar;
-    
-    // ҽ
-    codec = avcodec_find_decoder(codec_par->codec_id);
+    // 获取解码器参数
+    codec_par = input->fmtCtx->streams[input->streamIndex]->codecpar;
+    input->codecPar = avcodec_parameters_alloc();
+    if (!input->codecPar || avcodec_parameters_copy(input->codecPar, codec_par) < 0) {
+        log(LogError, "Unable to copy codec parameters.");
+        goto fail;
+    }
 
+    // 查找解码器
+    codec = avcodec_find_decoder(codec_par->codec_id);
     if (!codec) {
-        emit playError("No suitable decoder found.");
-        goto cleanup;
+        log(LogError, "No suitable decoder found.");
+        goto fail;
     }
 
-    // 
-    codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        emit playError("Unable to allocate the decoder context.");
-        goto cleanup;
+    input->sourceWidth = codec_par->width;
+    input->sourceHeight = codec_par->height;
+    fitWindowToDisplay(input->sourceWidth, input->sourceHeight, &window_w, &window_h);
+
+    // 显示尺寸远小于码流时，让支持的解码器（如MJPEG）直接输出低分辨率；H.264/HEVC不支持
+    input->lowres = 0;
+    while (input->lowres < codec->max_lowres &&
+        (input->sourceWidth >> (input->lowres + 1)) >= window_w && (input->sourceHeight >> (input->lowres + 1)) >= window_h) {
+        input->lowres++;
+    }
+
+    // 参数相同则接管上一个文件的解码器，冲刷内部状态即可继续使用
+    {
+        QMutexLocker locker(&m_spareMutex);
+        if (m_spareCodecCtx && m_sparePar && m_spareLowres == input->lowres &&
+            sameDecoderConfig(m_sparePar, codec_par)) {
+            input->codecCtx = m_spareCodecCtx;
+            m_spareCodecCtx = nullptr;
+            avcodec_parameters_free(&m_sparePar);
+        }
+    }
+    if (input->codecCtx) {
+        avcodec_flush_buffers(input->codecCtx);
+        input->decoderReused = true;
+        return true;
+    }
+
+    // 创建解码器上下文
+    input->codecCtx = avcodec_alloc_context3(codec);
+    if (!input->codecCtx) {
+        log(LogError, "Unable to allocate the decoder context.");
+        goto fail;
     }
 
-    // ƽ
-    ret = avcodec_parameters_to_context(codec_ctx, codec_par);
+    // 复制解码器参数
+    ret = avcodec_parameters_to_context(input->codecCtx, codec_par);
     if (ret < 0) {
         printError("Unable to copy codec parameters.", ret);
-        goto cleanup;
+        goto fail;
+    }
+    input->codecCtx->lowres = input->lowres;
+    // 实时流按切片并行解码，帧级多线程每个线程都要多缓冲一帧
+    if (input->rtp) {
+        input->codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        input->codecCtx->thread_type = FF_THREAD_SLICE;
     }
 
-    // 򿪽
-    ret = avcodec_open2(codec_ctx, codec, nullptr);
+    // 打开解码器
+    ret = avcodec_open2(input->codecCtx, codec, nullptr);
     if (ret < 0) {
         printError("Unable to open the decoder.", ret);
-        goto cleanup;
+        goto fail;
     }
+    input->decoderReused = false;
+    return true;
 
-    // SDLںȾ
-    m_sdlWindow = SDL_CreateWindow("duan video player", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, codec_ctx->width, codec_ctx->height, SDL_WINDOW_SHOWN);
-    if (!m_sdlWindow) {
-        emit playError(QString("Unable to create the SDL window.: %1").arg(SDL_GetError()));
-        goto cleanup;
-    }
+fail:
+    closeInput(input, false);
+    return false;
+}
 
-    m_sdlRenderer = SDL_CreateRenderer(m_sdlWindow, -1, SDL_RENDERER_ACCELERATED);
-    if (!m_sdlRenderer) {
-        emit playError(QString("Unable to create the SDL renderer.: %1").arg(SDL_GetError()));
-        goto cleanup;
+int PlayerThread::primeInput(MediaInput* input) {
+    AVPacket* pkt = av_packet_alloc();
+    int ret = 0;
+
+    input->firstFrame = av_frame_alloc();
+    if (!pkt || !input->firstFrame) {
+        av_packet_free(&pkt);
+        return AVERROR(ENOMEM);
     }
 
-    // YUV
-    m_sdlTexture = SDL_CreateTexture(m_sdlRenderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, codec_ctx->width, codec_ctx->height);
+    // 解出第一帧并顺带建立对应的GOP索引，切换过去后可以立即显示
+    while (!m_control.isCancelled()) {
+        ret = avcodec_receive_frame(input->codecCtx, input->firstFrame);
+        if (ret != AVERROR(EAGAIN)) break;
+        if (input->inputEof) {
+            ret = AVERROR_EOF;
+            break;
+        }
 
-    if (!m_sdlTexture) {
-        emit playError(QString("Unable to create the SDL texture.: %1").arg(SDL_GetError()));
-        goto cleanup;
+        ret = av_read_frame(input->fmtCtx, pkt);
+        if (ret < 0) {
+            input->inputEof = true;
+            avcodec_send_packet(input->codecCtx, nullptr);
+            continue;
+        }
+        if (pkt->stream_index == input->streamIndex) {
+            indexGopPacket(input->gops, pkt);
+            ret = avcodec_send_packet(input->codecCtx, pkt);
+        }
+        av_packet_unref(pkt);
+        if (ret < 0) break;
     }
+    av_packet_free(&pkt);
 
-    // ʼ֡ݰ
-    frame = av_frame_alloc();
-    frame_yuv = av_frame_alloc();
-    pkt = av_packet_alloc();
+    if (m_control.isCancelled()) return AVERROR_EXIT;
+    if (ret < 0) {
+        printError("Unable to decode the first frame.", ret);
+    }
+    return ret;
+}
 
-    if (!frame || !frame_yuv || !pkt) {
-        emit playError("Unable to allocate a frame or packet.");
-        goto cleanup;
+void PlayerThread::closeInput(MediaInput* input, bool keepDecoder) {
+    if (input->firstFrame) av_frame_free(&input->firstFrame);
+    if (input->fmtCtx) avformat_close_input(&input->fmtCtx);
+    if (input->customIo) {
+        av_freep(&input->customIo->buffer);
+        avio_context_free(&input->customIo);
+    }
+    if (input->rtp) {
+        input->rtp->close();
+        log(LogInfo, QString("RTP input: %1").arg(input->rtp->report()));
+        delete input->rtp;
+        input->rtp = nullptr;
     }
 
-    // YUV
-    buffer_size = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, codec_ctx->width, codec_ctx->height, 1);
-    out_buffer = (uint8_t*)av_malloc(buffer_size * sizeof(uint8_t));
-    av_image_fill_arrays(frame_yuv->data, frame_yuv->linesize, out_buffer, AV_PIX_FMT_YUV420P, codec_ctx->width, codec_ctx->height, 1);
+    if (keepDecoder && input->codecCtx && input->codecPar) {
+        // 留给下一个文件复用，只保留最近一个
+        QMutexLocker locker(&m_spareMutex);
+        if (m_spareCodecCtx) avcodec_free_context(&m_spareCodecCtx);
+        if (m_sparePar) avcodec_parameters_free(&m_sparePar);
+        m_spareCodecCtx = input->codecCtx;
+        m_sparePar = input->codecPar;
+        m_spareLowres = input->lowres;
+        input->codecCtx = nullptr;
+        input->codecPar = nullptr;
+    }
+    if (input->codecCtx) avcodec_free_context(&input->codecCtx);
+    if (input->codecPar) avcodec_parameters_free(&input->codecPar);
 
-    // ͼת
-    sws_ctx = sws_getContext(codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC, nullptr, nullptr, nullptr);
+    input->gops.clear();
+    input->streamIndex = -1;
+    input->inputEof = false;
+    input->decoderReused = false;
+}
 
-    if (!sws_ctx) {
-        emit playError("Unable to create the image conversion context.");
-        goto cleanup;
-    }
+void PlayerThread::activateInput(MediaInput* input) {
+    // 接管输入的所有权
+    m_filePath = input->path;
+    m_fmtCtx = input->fmtCtx;
+    m_codecCtx = input->codecCtx;
+    m_codecPar = input->codecPar;
+    m_videoStreamIndex = input->streamIndex;
+    m_inputEof = input->inputEof;
+    m_primedFrame = input->firstFrame;
+    m_decoderReused = input->decoderReused;
+    m_sourceWidth = input->sourceWidth;
+    m_sourceHeight = input->sourceHeight;
+    m_lowres = input->lowres;
+    m_gops.swap(input->gops);
+    m_rtp = input->rtp;
+    m_customIo = input->customIo;
 
-    // ӡļϢ
-    emit playLog("fileInfo:");
-    av_dump_format(fmt_ctx, 0, m_filePath.toUtf8().constData(), 0);
-    emit playLog(QString("video width: %1, height: %2").arg(codec_ctx->width).arg(codec_ctx->height));
+    input->fmtCtx = nullptr;
+    input->rtp = nullptr;
+    input->customIo = nullptr;
+    input->codecCtx = nullptr;
+    input->codecPar = nullptr;
+    input->firstFrame = nullptr;
+    input->gops.clear();
 
-    sdl_rect.x = 0;
-    sdl_rect.y = 0;
-    sdl_rect.w = codec_ctx->width;
-    sdl_rect.h = codec_ctx->height;
+    m_seekDecoder.setLowres(m_lowres);
+    m_prefetchDecoder.setLowres(m_lowres);
+    m_seekDecoder.setInterruptCallback(m_control.interruptCallback());
+    m_prefetchDecoder.setInterruptCallback(m_control.interruptCallback());
+}
 
-    // ȡݰ
-    while (!m_stopFlag && av_read_frame(fmt_ctx, pkt) >= 0) {
-        if (pkt->stream_index == video_stream_index) {
-            // ݰ
-            ret = avcodec_send_packet(codec_ctx, pkt);
-            if (ret < 0) {
-                printError("send packet to decoder failure.", ret);
-                break;
+void PlayerThread::releaseCurrentInput() {
+    // GOP缓存和定位解码器只对当前文件有效
+    m_prefetchPool.waitForDone();
+    finishLiveGop();
+    m_gopCache.clear();
+    m_seekDecoder.close();
+    m_prefetchDecoder.close();
+
+    MediaInput input;
+    input.fmtCtx = m_fmtCtx;
+    input.codecCtx = m_codecCtx;
+    input.codecPar = m_codecPar;
+    input.firstFrame = m_primedFrame;
+    input.lowres = m_lowres;
+    input.rtp = m_rtp;
+    input.customIo = m_customIo;
+    m_fmtCtx = nullptr;
+    m_rtp = nullptr;
+    m_customIo = nullptr;
+    m_codecCtx = nullptr;
+    m_codecPar = nullptr;
+    m_primedFrame = nullptr;
+    m_gops.clear();
+    closeInput(&input, true);
+}
+
+void PlayerThread::startPriming(const QString& path) {
+    m_nextReady = false;
+    m_primePool.start([this, path]() {
+        DUAN_TRACE_THREAD("playlist primer");
+        DUAN_TRACE_SCOPE("prime_next");
+        if (openInput(path, &m_nextInput)) {
+            if (primeInput(&m_nextInput) >= 0) {
+                m_nextReady = true;
+            }
+            else {
+                closeInput(&m_nextInput, false);
             }
+        }
+    });
+}
 
-            // ս֡
-            while (!m_stopFlag && ret >= 0) {
-                ret = avcodec_receive_frame(codec_ctx, frame);
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                    break;
-                }
-                else if (ret < 0) {
-                    printError("receive decode frame failure", ret);
-                    goto cleanup;
-                }
+void PlayerThread::playPlaylist(const QStringList& playlist) {
+    MediaInput input;
+    int played = 0;
+    int primed_index = -1;
+
+    for (int i = 0; i < playlist.size() && !m_control.isCancelled(); i++) {
+        bool ready = false;
+        if (i == primed_index) {
+            // 后台已打开并解出首帧的下一个文件
+            m_primePool.waitForDone();
+            ready = m_nextReady;
+            m_nextReady = false;
+            if (ready) std::swap(input, m_nextInput);
+        }
+        else {
+            ready = openInput(playlist[i], &input) && primeInput(&input) >= 0;
+            if (!ready) closeInput(&input, false);
+        }
+        if (!ready) {
+            log(LogWarning, QString("skipping '%1'").arg(playlist[i]));
+            continue;
+        }
+
+        activateInput(&input);
+        if (i + 1 < playlist.size()) {
+            startPriming(playlist[i + 1]);
+            primed_index = i + 1;
+        }
+
+        m_ttffPending = true;
+        if (playlist.size() > 1) {
+            log(LogInfo, QString("playlist %1 / %2: %3").arg(i + 1).arg(playlist.size()).arg(m_filePath));
+        }
+        bool ok = playCurrentInput();
+        releaseCurrentInput();
+        played++;
+        if (!ok) break;
+
+        // 下一个文件的启动耗时从本文件结束时算起
+        m_ttffTimer.start();
+        m_ttffKind = "gapless";
+    }
+
+    m_primePool.waitForDone();
+    if (m_nextReady) {
+        closeInput(&m_nextInput, false);
+        m_nextReady = false;
+    }
+    if (played == 0 && !m_control.isCancelled()) {
+        emit playError("None of the selected files could be played.");
+    }
+    log(LogInfo, "player finished");
+}
+
+bool PlayerThread::playCurrentInput() {
+    int ret = 0;
+
+    m_paused = false;
+    m_reverse = false;
+    m_pendingStep = 0;
+    m_skipFile = false;
+    m_decodedFrames = 0;
+    m_viewFrame = -1;
+    m_resizePending = false;
+    m_fullConvertMs = -1.0;
+    m_calibrationQueued = false;
+    m_frameIntervalMs = 40.0;
+    m_lastPresentTick = 0;
+    av_frame_unref(m_lastFrame);
+
+    showWindow();
+
+    // 纹理和转换缓冲区尺寸不变时沿用上一个文件的
+    if (!ensureRenderTarget()) {
+        return false;
+    }
+
+    // 打印文件信息
+    log(LogInfo, "fileInfo:");
+    av_dump_format(m_fmtCtx, 0, m_filePath.toUtf8().constData(), 0);
+    log(LogInfo, QString("video width: %1, height: %2").arg(m_sourceWidth).arg(m_sourceHeight));
+    if (m_lowres > 0) {
+        log(LogInfo, QString("decoder lowres %1: decoding at %2x%3").arg(m_lowres)
+            .arg(AV_CEIL_RSHIFT(m_sourceWidth, m_lowres)).arg(AV_CEIL_RSHIFT(m_sourceHeight, m_lowres)));
+    }
+    log(LogInfo, "keys: Space pause/resume, Left/Right step one frame, R reverse playback, N next file");
+
+    m_statTimer.start();
+    m_statLastMs = 0;
+    m_statFrames = 0;
+    m_statConvertNs = 0;
+    m_statUploadBytes = 0;
+
+    while (!m_control.isCancelled() && !m_skipFile) {
+        handleEvents();
 
-                // תͼʽΪYUV420P
-                sws_scale(sws_ctx, (const uint8_t* const*)frame->data, frame->linesize, 0, codec_ctx->height, frame_yuv->data, frame_yuv->linesize);
+        if (m_resizePending) {
+            m_resizePending = false;
+            if (!ensureRenderTarget()) return false;
+            if (m_lastFrame->buf[0]) presentFrame(m_lastFrame);
+        }
 
-                // Ⱦ
-                SDL_UpdateYUVTexture(m_sdlTexture, &sdl_rect,
-                    frame_yuv->data[0], frame_yuv->linesize[0],
-                    frame_yuv->data[1], frame_yuv->linesize[1],
-                    frame_yuv->data[2], frame_yuv->linesize[2]);
+        int step = 0;
+        bool manual = m_pendingStep != 0;
+        if (manual) {
+            step = m_pendingStep;
+            m_pendingStep = 0;
+        }
+        else if (!m_paused && !m_control.isPaused()) {
+            step = m_reverse ? -1 : 1;
+        }
+        else {
+            m_lastPresentTick = 0;
+            SDL_Delay(10);
+            continue;
+        }
 
-                SDL_RenderClear(m_sdlRenderer);
-                SDL_RenderCopy(m_sdlRenderer, m_sdlTexture, nullptr, &sdl_rect);
-                SDL_RenderPresent(m_sdlRenderer);
+        // 编码文件只支持逐帧步进，PageUp/PageDown等跳转按方向处理
+        step = step < 0 ? -1 : 1;
 
-                // Ʋٶ
-                SDL_Delay(40); // Լ25fps
+        if (step < 0) {
+            // 后退与倒放都从GOP缓存取帧
+            if (m_viewFrame <= 0 || !showCachedFrame(m_viewFrame - 1)) {
+                m_paused = true;
+                m_reverse = false;
             }
         }
-        av_packet_unref(pkt);
-    }
+        else if (m_viewFrame + 1 < m_decodedFrames) {
+            // 后退过后再前进，先用缓存追上顺序解码器的位置
+            if (!showCachedFrame(m_viewFrame + 1)) {
+                m_paused = true;
+            }
+        }
+        else {
+            ret = decodeNextFrame(m_frame);
+            if (ret == AVERROR_EOF || ret == AVERROR_EXIT) {
+                finishLiveGop();
+                if (!m_paused || m_control.isCancelled()) break;
+                log(LogInfo, "end of stream");
+                continue;
+            }
+            else if (ret < 0) {
+                printError("receive decode frame failure", ret);
+                return false;
+            }
 
-    // ʣ֡
-    emit playLog("Processing remaining frames...");
-    ret = avcodec_send_packet(codec_ctx, nullptr);
-    while (!m_stopFlag && ret >= 0) {
-        ret = avcodec_receive_frame(codec_ctx, frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
+            m_metrics.decoded.fetch_add(1, std::memory_order_relaxed);
+            onLiveFrame(m_frame, m_decodedFrames);
+            presentFrame(m_frame);
+            av_frame_unref(m_frame);
+            m_viewFrame = m_decodedFrames++;
         }
-        else if (ret < 0) {
-            printError("Failed to receive remaining frames.", ret);
-            goto cleanup;
+
+        if (manual) {
+            logCacheStats();
+        }
+        else if (!m_rtp) {
+            // 控制播放速度；实时流由发送端控制节奏，解出即显示
+            SDL_Delay(40); // 约25fps
         }
+    }
 
-        sws_scale(sws_ctx, (const uint8_t* const*)frame->data, frame->linesize, 0,
-            codec_ctx->height, frame_yuv->data, frame_yuv->linesize);
+    logCacheStats();
+    logRenderStats();
+    return true;
+}
 
-        SDL_UpdateYUVTexture(m_sdlTexture, &sdl_rect,
-            frame_yuv->data[0], frame_yuv->linesize[0],
-            frame_yuv->data[1], frame_yuv->linesize[1],
-            frame_yuv->data[2], frame_yuv->linesize[2]);
+void PlayerThread::runRawYuv(const QString& filePath) {
+    m_paused = false;
+    m_reverse = false;
+    m_pendingStep = 0;
+    m_resizePending = false;
+    m_ttffPending = true;
+    m_frameIntervalMs = 1000.0 / m_rawFps;
+    m_lastPresentTick = 0;
+    m_sourceWidth = m_rawWidth;
+    m_sourceHeight = m_rawHeight;
+    AVPixelFormat pix_fmt = (AVPixelFormat)m_rawPixFmt;
+    Uint32 sdl_format = sdlFormatFor(pix_fmt);
+    QFile file(filePath);
+    const uchar* mapped = nullptr;
+    uint8_t* planes[4] = { nullptr };
+    int linesizes[4] = { 0 };
+    int64_t frame_size = 0;
+    int64_t frame_count = 0;
+    int64_t frame_index = 0;
+    int64_t shown = 0;
+    int out_w = 0;
+    int out_h = 0;
+    Uint64 freq = 0;
+    Uint64 next_tick = 0;
+    Uint64 start_tick = 0;
+    bool redraw = true;
 
-        SDL_RenderClear(m_sdlRenderer);
-        SDL_RenderCopy(m_sdlRenderer, m_sdlTexture, nullptr, &sdl_rect);
-        SDL_RenderPresent(m_sdlRenderer);
-        SDL_Delay(40);
+    if (sdl_format == SDL_PIXELFORMAT_UNKNOWN) {
+        emit playError(QString("Pixel format '%1' cannot be displayed without conversion.")
+            .arg(av_get_pix_fmt_name(pix_fmt) ? av_get_pix_fmt_name(pix_fmt) : "unknown"));
+        return;
     }
 
-    emit playLog("player finished");
+    frame_size = av_image_get_buffer_size(pix_fmt, m_rawWidth, m_rawHeight, 1);
+    if (frame_size <= 0) {
+        emit playError("Invalid raw YUV frame size.");
+        return;
+    }
 
-cleanup:
-    // ͷԴ
-    if (sws_ctx) sws_freeContext(sws_ctx);
-    if (out_buffer) av_free(out_buffer);
-    if (frame_yuv) av_frame_free(&frame_yuv);
-    if (frame) av_frame_free(&frame);
-    if (pkt) av_packet_free(&pkt);
-    if (codec_ctx) avcodec_free_context(&codec_ctx);
-    if (fmt_ctx) avformat_close_input(&fmt_ctx);
-
-    // ͷSDLԴ
+    // 内存映射整个文件，每帧直接从映射区上传纹理，不做分配和拷贝
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit playError(QString("Unable to open '%1'.").arg(filePath));
+        return;
+    }
+    frame_count = file.size() / frame_size;
+    if (frame_count <= 0) {
+        emit playError("The file is smaller than one frame, check width/height/pixel format.");
+        return;
+    }
+    mapped = file.map(0, frame_count * frame_size);
+    if (!mapped) {
+        emit playError(QString("Unable to map '%1': %2").arg(filePath).arg(file.errorString()));
+        return;
+    }
+    av_image_fill_linesizes(linesizes, pix_fmt, m_rawWidth);
+
+    m_filePath = filePath;
+    showWindow();
+
+    // 纹理保持原始尺寸，缩放交给GPU，CPU侧不做任何转换；窗口与渲染器沿用常驻上下文
     if (m_sdlTexture) SDL_DestroyTexture(m_sdlTexture);
-    if (m_sdlRenderer) SDL_DestroyRenderer(m_sdlRenderer);
-    if (m_sdlWindow) SDL_DestroyWindow(m_sdlWindow);
+    m_targetWidth = 0;
+    m_targetHeight = 0;
+    m_sdlTexture = SDL_CreateTexture(m_sdlRenderer, sdl_format, SDL_TEXTUREACCESS_STREAMING, m_rawWidth, m_rawHeight);
+    if (!m_sdlTexture) {
+        emit playError(QString("Unable to create the SDL texture.: %1").arg(SDL_GetError()));
+        goto cleanup;
+    }
+    updateDisplayRect(&out_w, &out_h);
+
+    log(LogInfo, QString("raw yuv: %1x%2 %3, %4 frames, %5 fps")
+        .arg(m_rawWidth).arg(m_rawHeight).arg(av_get_pix_fmt_name(pix_fmt)).arg(frame_count).arg(m_rawFps));
+    log(LogInfo, "keys: Space pause/resume, Left/Right step one frame, PageUp/PageDown jump 25 frames, Home/End, R reverse playback");
+
+    frame_index = std::min<int64_t>(m_rawStartFrame, frame_count - 1);
+    freq = SDL_GetPerformanceFrequency();
+    start_tick = SDL_GetPerformanceCounter();
+    next_tick = start_tick;
 
-    SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER);
+    while (!m_control.isCancelled()) {
+        handleEvents();
+
+        if (m_resizePending) {
+            m_resizePending = false;
+            updateDisplayRect(&out_w, &out_h);
+            redraw = true;
+        }
+
+        bool manual = m_pendingStep != 0;
+        if (manual) {
+            // 按帧号随机访问：帧位置 = 帧号 * 帧大小
+            frame_index = std::max<int64_t>(0, std::min<int64_t>(frame_count - 1, frame_index + m_pendingStep));
+            m_pendingStep = 0;
+            redraw = true;
+            log(LogDebug, QString("frame %1 / %2").arg(frame_index).arg(frame_count));
+        }
+        else if (!m_paused && !m_control.isPaused() && !redraw) {
+            int64_t next = frame_index + (m_reverse ? -1 : 1);
+            if (next >= frame_count) break;
+            if (next < 0) {
+                m_paused = true;
+                m_reverse = false;
+                continue;
+            }
+            frame_index = next;
+        }
+        else if (!redraw) {
+            m_lastPresentTick = 0;
+            SDL_Delay(10);
+            next_tick = SDL_GetPerformanceCounter();
+            continue;
+        }
+        redraw = false;
+
+        av_image_fill_pointers(planes, pix_fmt, m_rawHeight, (uint8_t*)mapped + frame_index * frame_size, linesizes);
+        {
+            DUAN_TRACE_SCOPE("upload");
+            if (sdl_format == SDL_PIXELFORMAT_IYUV) {
+                SDL_UpdateYUVTexture(m_sdlTexture, nullptr,
+                    planes[0], linesizes[0], planes[1], linesizes[1], planes[2], linesizes[2]);
+            }
+            else {
+                // NV12/NV21与打包格式在映射区内连续存放，可一次上传
+                SDL_UpdateTexture(m_sdlTexture, nullptr, planes[0], linesizes[0]);
+            }
+        }
+        {
+            DUAN_TRACE_SCOPE("present");
+            SDL_RenderClear(m_sdlRenderer);
+            SDL_RenderCopy(m_sdlRenderer, m_sdlTexture, nullptr, &m_sdlRect);
+            SDL_RenderPresent(m_sdlRenderer);
+        }
+        shown++;
+        notePresented();
+        if (m_ttffPending) {
+            reportFirstFrame("memory mapped");
+        }
+
+        // 按目标帧率定时，落后超过一秒时重新对齐，不追帧
+        if (!m_paused) {
+            next_tick += (Uint64)(freq / m_rawFps);
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (next_tick > now) {
+                SDL_Delay((Uint32)((next_tick - now) * 1000 / freq));
+            }
+            else if (now - next_tick > freq) {
+                next_tick = now;
+            }
+        }
+    }
+
+    log(LogInfo, QString("raw yuv: shown %1 frames in %2 s")
+        .arg(shown).arg((SDL_GetPerformanceCounter() - start_tick) / (double)freq, 0, 'f', 1));
+    log(LogInfo, "player finished");
+
+cleanup:
+    // 裸流纹理格式与尺寸和解码播放不同，用完即释放
+    if (m_sdlTexture) SDL_DestroyTexture(m_sdlTexture);
+    m_sdlTexture = nullptr;
 
-    emit playFinished();
+    file.unmap((uchar*)mapped);
+    file.close();
 }
\ No newline at end of file
@@ -2,11 +2,25 @@
 #include <QThread>
 #include <QString>
 #include <QObject>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
 #include <SDL2/SDL.h>
+#include "GopCache.h"
+#include "JobControl.h"
+#include "LogSink.h"
+#include "Metrics.h"
+#include "RtpStream.h"
 
 extern "C" {
 #include <libavutil/opt.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/frame.h>
@@ -24,22 +38,187 @@ public:
 	~PlayerThread() override;
 
 	void setFilePath(const QString& filepath);
+	// 播放列表按顺序无缝播放，播放当前文件时后台预先打开并解出下一个文件的首帧
+	void setPlaylist(const QStringList& files);
+	// 裸YUV播放：宽高与像素格式同编码面板，startFrame 为起始帧号
+	void setRawYuv(bool enabled, int width, int height, int pixFmt = AV_PIX_FMT_YUV420P,
+		double fps = 25.0, int startFrame = 0);
+	void setGopCacheBudget(int megabytes);
+	// 线程常驻，SDL与窗口只初始化一次；首次调用时启动线程，之后只唤醒
+	void requestPlayback();
+	// 暂停/继续/停止，可在任意线程调用；停止会中断阻塞中的打开与读包
+	void pausePlayback();
+	void resumePlayback();
 	void stopPlayback();
+	bool isPlaybackPaused() const { return m_control.isPaused(); }
+	const PlaybackMetrics& metrics() const { return m_metrics; }
 
 protected:
 	void run() override;
 
 signals:
-	void playLog(const QString& log);
 	void playError(const QString& error);
 	void playFinished();
 	void frameReady(SDL_Texture* texture, int errnum);
 
 private:
+	// 一个已打开并预解出首帧的输入
+	struct MediaInput {
+		QString path;
+		AVFormatContext* fmtCtx = nullptr;
+		AVCodecContext* codecCtx = nullptr;
+		AVCodecParameters* codecPar = nullptr;  // 判断解码器能否复用
+		int streamIndex = -1;
+		int sourceWidth = 0;
+		int sourceHeight = 0;
+		int lowres = 0;
+		bool inputEof = false;
+		bool decoderReused = false;
+		AVFrame* firstFrame = nullptr;
+		std::vector<GopInfo> gops;
+		// rtp:// 输入：接收端和读它的自定义 IO
+		RtpReceiver* rtp = nullptr;
+		AVIOContext* customIo = nullptr;
+	};
+
 	void printError(const char* msg, int errnum);
-	QString m_filePath;
-	bool m_stopFlag;
+	void log(LogLevel level, const QString& text);
+	int decodeNextFrame(AVFrame* frame);
+	void presentFrame(const AVFrame* frame);
+	void reportFirstFrame(const QString& detail);
+	void notePresented();
+	void handleEvents();
+	// 空闲时丢弃本窗口积压的窗口事件，其他窗口的事件放回队列
+	void drainWindowEvents();
+
+	// 常驻的SDL上下文：窗口空闲时隐藏，下次播放直接显示
+	bool ensureRenderContext();
+	void destroyRenderContext();
+	void showWindow();
+
+	// 输入的打开、预解码与切换，解码器参数一致时复用上一个文件的解码器
+	bool openInput(const QString& path, MediaInput* input);
+	// rtp://@:端口?codec=hevc&jitter=毫秒，按裸 H.264/HEVC 从接收端读取
+	bool openRtpInput(const QString& url, MediaInput* input, const AVInputFormat** format);
+	int primeInput(MediaInput* input);
+	void closeInput(MediaInput* input, bool keepDecoder);
+	void activateInput(MediaInput* input);
+	void releaseCurrentInput();
+	void startPriming(const QString& path);
+	void playPlaylist(const QStringList& playlist);
+	bool playCurrentInput();
+
+	// 按窗口显示尺寸转换和上传，纹理只在尺寸变化时重建
+	void fitWindowToDisplay(int sourceWidth, int sourceHeight, int* width, int* height) const;
+	bool updateDisplayRect(int* out_w, int* out_h);
+	bool ensureRenderTarget();
+	// 在预取线程池里跑，每个输入一次；frame 归它释放
+	void calibrateFullSize(AVFrame* frame, int sourceWidth, int sourceHeight, bool synthetic);
+	void logRenderStats();
+
+	// 逐帧后退/倒放：GOP索引与缓存
+	int gopOfFrame(int frameIndex) const;
+	void onLiveFrame(const AVFrame* frame, int frameIndex);
+	void finishLiveGop();
+	bool showCachedFrame(int frameIndex);
+	void prefetchGop(int gopIndex);
+	void logCacheStats();
+	void runRawYuv(const QString& filePath);
+
+	QString m_filePath;        // 当前播放的文件
+	bool m_rawMode = false;
+	int m_rawWidth = 0;
+	int m_rawHeight = 0;
+	int m_rawPixFmt = AV_PIX_FMT_YUV420P;
+	double m_rawFps = 25.0;
+	int m_rawStartFrame = 0;
+	JobControl m_control;
+	PlaybackMetrics m_metrics;
+	int64_t m_cpuStart = 0;
+	Uint64 m_lastPresentTick = 0;
+	double m_frameIntervalMs = 40.0;
 	SDL_Window* m_sdlWindow;
 	SDL_Renderer* m_sdlRenderer;
 	SDL_Texture* m_sdlTexture;
+	bool m_sdlInitialized = false;
+	bool m_windowFresh = false;    // 窗口尚未按首个文件调整过尺寸
+	SDL_Rect m_displayBounds{};    // 显示器可用区域，SDL初始化时取一次
+
+	// 播放请求：GUI线程写入，播放线程在空闲时等待
+	QMutex m_requestMutex;
+	QWaitCondition m_requestCond;
+	QStringList m_playlist;
+	bool m_hasRequest = false;
+	bool m_quit = false;
+	bool m_skipFile = false;
+
+	QElapsedTimer m_requestTimer;  // GUI线程在请求时启动，只在 m_requestMutex 下读写
+
+	// 启动耗时：cold 含SDL与窗口创建，warm 复用常驻上下文，gapless 从上一文件结束算起
+	// 以下只在播放线程访问，取请求时从 m_requestTimer 复制起点
+	QElapsedTimer m_ttffTimer;
+	QString m_ttffKind;
+	bool m_ttffPending = false;
+
+	// 下一个文件在后台打开和预解码，切换时直接接管
+	QThreadPool m_primePool;
+	MediaInput m_nextInput;
+	bool m_nextReady = false;
+	AVFrame* m_primedFrame = nullptr;
+	AVCodecParameters* m_codecPar = nullptr;
+	bool m_decoderReused = false;
+
+	// 上一个文件留下的解码器，参数一致时冲刷后复用，省去 avcodec_open2
+	QMutex m_spareMutex;
+	AVCodecContext* m_spareCodecCtx = nullptr;
+	AVCodecParameters* m_sparePar = nullptr;
+	int m_spareLowres = 0;
+
+	AVFormatContext* m_fmtCtx = nullptr;
+	AVCodecContext* m_codecCtx = nullptr;
+	RtpReceiver* m_rtp = nullptr;      // 实时流：不能回头重读，按到达即显示
+	AVIOContext* m_customIo = nullptr;
+	AVPacket* m_pkt = nullptr;
+	AVFrame* m_frame = nullptr;
+	AVFrame* m_frameYuv = nullptr;
+	SwsContext* m_swsCtx = nullptr;
+	SDL_Rect m_sdlRect{};      // 画面在窗口中的显示区域
+	int m_videoStreamIndex = -1;
+	bool m_inputEof = false;
+
+	int m_sourceWidth = 0;     // 码流原始尺寸
+	int m_sourceHeight = 0;
+	int m_lowres = 0;          // 解码器降分辨率级别（2^lowres 倍）
+	int m_targetWidth = 0;     // 转换与纹理的目标尺寸
+	int m_targetHeight = 0;
+	uint8_t* m_outBuffer = nullptr;
+	AVFrame* m_lastFrame = nullptr;
+	bool m_resizePending = false;
+
+	// 渲染开销统计
+	QElapsedTimer m_statTimer;
+	qint64 m_statLastMs = 0;
+	int64_t m_statFrames = 0;
+	int64_t m_statConvertNs = 0;
+	int64_t m_statUploadBytes = 0;
+	std::atomic<double> m_fullConvertMs{ -1.0 };   // 按原始尺寸转换一帧的耗时，由预取线程测得
+	bool m_calibrationQueued = false;
+
+	bool m_paused = false;
+	bool m_reverse = false;
+	int m_pendingStep = 0;
+	int m_decodedFrames = 0;   // 顺序解码器已输出的帧数
+	int m_viewFrame = -1;      // 当前显示的帧序号
+
+	GopCache m_gopCache;
+	GopDecoder m_seekDecoder;      // 缓存未命中时在播放线程同步解码
+	GopDecoder m_prefetchDecoder;  // 只在预取线程中使用
+	QThreadPool m_prefetchPool;
+	QMutex m_prefetchMutex;
+	QSet<int> m_prefetching;
+	std::vector<GopInfo> m_gops;
+	std::vector<AVFrame*> m_liveGop;
+	size_t m_liveGopBytes = 0;
+	bool m_liveGopOverflow = false;
+	int m_liveGopIndex = -1;
 };
\ No newline at end of file
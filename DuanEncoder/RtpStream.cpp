@@ -0,0 +1,753 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "RtpStream.h"
+#include <QHostInfo>
+#include <QUdpSocket>
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/random_seed.h>
+#include <libavutil/time.h>
+}
+
+namespace {
+const int kExtensionProfile = 0xBEDE;
+const int kCaptureExtensionId = 1;
+const double kRateHeadroom = 1.25;              // 码率之上留的余量，帧大小有波动
+const int64_t kMinDrainUs = 1000;
+// 一次等待实际可能睡多久：Windows 上 usleep 按毫秒 Sleep，常常睡满一个 15.6 ms 的时钟周期。
+// 桶深至少要装下这段时间按当前速率应发的字节，否则每次醒来只能发几个包，吞吐被睡眠粒度卡住
+const int64_t kSleepGranularityUs = 20000;
+
+void writeBe16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+void writeBe32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+uint32_t readBe16(const uint8_t* p) {
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+uint32_t readBe32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// nal 指向 NAL 头
+int nalTypeOf(const uint8_t* nal, AVCodecID codec) {
+    return codec == AV_CODEC_ID_HEVC ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+}
+
+// 把一段 Annex-B 数据切成 NAL（不含起始码，去掉属于下一个 4 字节起始码的 00）
+void splitNals(const uint8_t* data, int size, std::vector<std::pair<const uint8_t*, int>>* nals) {
+    const uint8_t* end = data + size;
+    const uint8_t* sc = AnnexB::findStartCode(data, end);
+    while (sc + 3 < end) {
+        const uint8_t* nal = sc + 3;
+        sc = AnnexB::findStartCode(nal, end);
+        const uint8_t* nalEnd = sc;
+        if (sc < end) {
+            while (nalEnd > nal && nalEnd[-1] == 0) nalEnd--;
+        }
+        if (nalEnd > nal) nals->push_back(std::make_pair(nal, (int)(nalEnd - nal)));
+    }
+}
+
+QString latencySummary(std::vector<int> samples) {
+    if (samples.empty()) return "n/a";
+    std::sort(samples.begin(), samples.end());
+    double avg = 0;
+    for (int us : samples) avg += us;
+    avg /= samples.size();
+    size_t p95 = std::min(samples.size() - 1, (size_t)(0.95 * (samples.size() - 1) + 0.5));
+    return QString("avg %1 ms, p95 %2 ms, max %3 ms")
+        .arg(avg / 1000.0, 0, 'f', 2).arg(samples[p95] / 1000.0, 0, 'f', 2)
+        .arg(samples.back() / 1000.0, 0, 'f', 2);
+}
+
+// 10 ms 窗口内字节数的峰均比，1 表示完全匀速
+double burstiness(const std::vector<int64_t>& bins) {
+    size_t first = 0;
+    size_t last = bins.size();
+    while (first < last && bins[first] == 0) first++;
+    while (last > first && bins[last - 1] == 0) last--;
+    if (first == last) return 0;
+    int64_t total = 0;
+    int64_t peak = 0;
+    for (size_t i = first; i < last; i++) {
+        total += bins[i];
+        peak = std::max(peak, bins[i]);
+    }
+    return (double)peak * (last - first) / total;
+}
+
+void addToBin(std::vector<int64_t>* bins, int64_t offsetUs, int64_t binUs, int bytes) {
+    if (offsetUs < 0) offsetUs = 0;
+    size_t index = (size_t)(offsetUs / binUs);
+    if (index >= bins->size()) bins->resize(index + 1, 0);
+    (*bins)[index] += bytes;
+}
+}
+
+RtpSender::RtpSender() {
+    for (int i = 0; i < kPendingFrames; i++) {
+        m_submitPts[i] = -1;
+        m_submitWallUs[i] = 0;
+    }
+}
+
+RtpSender::~RtpSender() {
+    close();
+}
+
+bool RtpSender::open(const QString& target, AVCodecID codec, int bitRate, double frameRate,
+    int jitterBudgetMs, int mtu, QString* error) {
+    int colon = target.lastIndexOf(':');
+    bool portOk = false;
+    QString host;
+
+    if (m_thread) {
+        if (error) *error = "already open";
+        return false;
+    }
+    if (codec != AV_CODEC_ID_H264 && codec != AV_CODEC_ID_HEVC) {
+        if (error) *error = "RTP output supports H.264 and HEVC only";
+        return false;
+    }
+    if (colon > 0) m_port = (quint16)target.mid(colon + 1).toUInt(&portOk);
+    if (!portOk || m_port == 0) {
+        if (error) *error = QString("invalid RTP target '%1', expected host:port").arg(target);
+        return false;
+    }
+    host = target.left(colon);
+    if (!m_host.setAddress(host)) {
+        QHostInfo info = QHostInfo::fromName(host);
+        if (info.addresses().isEmpty()) {
+            if (error) *error = QString("cannot resolve '%1': %2").arg(host, info.errorString());
+            return false;
+        }
+        m_host = info.addresses().first();
+    }
+    // 分片至少要能带几十字节负载
+    if (mtu < Rtp::kHeaderBytes + 64) {
+        if (error) *error = QString("MTU %1 too small").arg(mtu);
+        return false;
+    }
+
+    m_codec = codec;
+    m_mtu = mtu;
+    m_frameRate = frameRate > 0 ? frameRate : 25.0;
+    m_baseRate = std::max(bitRate, 100000) / 8.0 * kRateHeadroom / 1000000.0;
+    m_budgetUs = std::max(jitterBudgetMs, 1) * 1000LL;
+    m_bucketBytes = 4 * mtu;
+    m_ssrc = av_get_random_seed();
+    m_seq = (uint16_t)av_get_random_seed();
+    m_closing = false;
+    m_startUs = av_gettime_relative();
+
+    m_thread = QThread::create([this]() { pace(); });
+    m_thread->start();
+    return true;
+}
+
+void RtpSender::close() {
+    if (!m_thread) return;
+    m_mutex.lock();
+    m_closing = true;
+    m_cond.wakeAll();
+    m_mutex.unlock();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+bool RtpSender::isParameterSet(const uint8_t* nal) const {
+    int type = nalTypeOf(nal, m_codec);
+    if (m_codec == AV_CODEC_ID_HEVC) return type >= 32 && type <= 34;
+    return type == 7 || type == 8;
+}
+
+void RtpSender::rememberParameterSet(const uint8_t* nal, int size) {
+    // 每种参数集只保留最新的一个，按类型排序即 VPS/SPS/PPS 的发送顺序
+    m_paramSets[nalTypeOf(nal, m_codec)] = QByteArray((const char*)nal, size);
+}
+
+void RtpSender::setParameterSets(const uint8_t* data, int size) {
+    std::vector<std::pair<const uint8_t*, int>> nals;
+    if (!data || size <= 0) return;
+    splitNals(data, size, &nals);
+    for (const auto& nal : nals) {
+        if (isParameterSet(nal.first)) rememberParameterSet(nal.first, nal.second);
+    }
+}
+
+void RtpSender::frameSubmitted(int64_t pts) {
+    int slot = (int)(pts % kPendingFrames);
+    m_submitPts[slot] = pts;
+    m_submitWallUs[slot] = av_gettime();
+}
+
+int RtpSender::writeSlice(const uint8_t* data, int size, int64_t pts, bool keyframe, bool lastInFrame) {
+    std::vector<std::pair<const uint8_t*, int>> nals;
+    splitNals(data, size, &nals);
+
+    if (!m_inFrame) {
+        bool hasParamSets = false;
+        int slot = pts >= 0 ? (int)(pts % kPendingFrames) : 0;
+
+        m_inFrame = true;
+        m_timestamp = (uint32_t)(int64_t)(pts * 90000.0 / m_frameRate);
+        m_captureUs = (pts >= 0 && m_submitPts[slot] == pts) ? m_submitWallUs[slot] : av_gettime();
+
+        for (const auto& nal : nals) {
+            if (isParameterSet(nal.first)) hasParamSets = true;
+        }
+        // 码流里没有带参数集时（全局头，或帧内刷新下长时间没有 IDR）补发缓存的参数集
+        if (hasParamSets) {
+            m_framesSinceParamSets = 0;
+        }
+        else if (keyframe || m_framesSinceParamSets >= kParamSetInterval) {
+            for (const auto& ps : m_paramSets) {
+                packetizeNal((const uint8_t*)ps.second.constData(), ps.second.size(), false);
+            }
+            if (!m_paramSets.empty()) m_framesSinceParamSets = 0;
+        }
+    }
+
+    for (size_t i = 0; i < nals.size(); i++) {
+        if (isParameterSet(nals[i].first)) rememberParameterSet(nals[i].first, nals[i].second);
+        packetizeNal(nals[i].first, nals[i].second, lastInFrame && i + 1 == nals.size());
+    }
+
+    if (lastInFrame) {
+        m_inFrame = false;
+        m_framesSinceParamSets++;
+    }
+    return 0;
+}
+
+void RtpSender::packetizeNal(const uint8_t* nal, int size, bool marker) {
+    const int maxPayload = m_mtu - Rtp::kHeaderBytes;
+    uint8_t header[3];
+    int headerSize = 0;
+    int nalHeaderSize = 0;
+
+    // 放得下就单 NAL 包
+    if (size <= maxPayload) {
+        queuePacket(NULL, 0, nal, size, marker);
+        return;
+    }
+
+    // 否则分片：H.264 FU-A（类型 28），HEVC FU（类型 49），原 NAL 头不发送，由分片头还原
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        header[0] = (uint8_t)((nal[0] & 0x81) | (49 << 1));
+        header[1] = nal[1];
+        header[2] = (uint8_t)((nal[0] >> 1) & 0x3f);
+        headerSize = 3;
+        nalHeaderSize = 2;
+    }
+    else {
+        header[0] = (uint8_t)((nal[0] & 0xe0) | 28);
+        header[1] = (uint8_t)(nal[0] & 0x1f);
+        headerSize = 2;
+        nalHeaderSize = 1;
+    }
+
+    const uint8_t fuTypeMask = header[headerSize - 1];
+    const int chunk = maxPayload - headerSize;
+    const uint8_t* p = nal + nalHeaderSize;
+    const uint8_t* end = nal + size;
+    bool first = true;
+    while (p < end) {
+        int n = (int)std::min<int64_t>(chunk, end - p);
+        bool last = p + n == end;
+        header[headerSize - 1] = (uint8_t)(fuTypeMask | (first ? 0x80 : 0) | (last ? 0x40 : 0));
+        queuePacket(header, headerSize, p, n, marker && last);
+        m_fragments++;
+        p += n;
+        first = false;
+    }
+}
+
+void RtpSender::queuePacket(const uint8_t* header, int headerSize, const uint8_t* payload, int payloadSize, bool marker) {
+    Packet packet;
+    packet.data.resize(Rtp::kHeaderBytes + headerSize + payloadSize);
+    uint8_t* p = (uint8_t*)packet.data.data();
+
+    // 固定头：V=2，X=1
+    p[0] = 0x90;
+    p[1] = (uint8_t)((marker ? 0x80 : 0) | Rtp::kPayloadType);
+    writeBe16(p + 2, m_seq++);
+    writeBe32(p + 4, m_timestamp);
+    writeBe32(p + 8, m_ssrc);
+    // 扩展头（长度 3 个 32 位字），一个元素：ID 1，长度 8，采集时刻微秒，其余补 0
+    writeBe16(p + 12, kExtensionProfile);
+    writeBe16(p + 14, 3);
+    p[16] = (uint8_t)((kCaptureExtensionId << 4) | 7);
+    writeBe32(p + 17, (uint32_t)((uint64_t)m_captureUs >> 32));
+    writeBe32(p + 21, (uint32_t)m_captureUs);
+    p[25] = p[26] = p[27] = 0;
+    if (headerSize > 0) memcpy(p + Rtp::kHeaderBytes, header, headerSize);
+    memcpy(p + Rtp::kHeaderBytes + headerSize, payload, payloadSize);
+
+    packet.queuedUs = av_gettime_relative();
+    addToBin(&m_queuedBins, packet.queuedUs - m_startUs, kBinUs, packet.data.size());
+    m_packets++;
+    m_bytes += packet.data.size();
+
+    m_mutex.lock();
+    m_queuedBytes += packet.data.size();
+    m_queue.push_back(std::move(packet));
+    m_cond.wakeOne();
+    m_mutex.unlock();
+}
+
+void RtpSender::pace() {
+    QUdpSocket socket;
+    double tokens = m_bucketBytes;
+    int64_t lastRefill = av_gettime_relative();
+
+    for (;;) {
+        Packet packet;
+        int64_t queuedBytes = 0;
+
+        m_mutex.lock();
+        while (m_queue.empty() && !m_closing) m_cond.wait(&m_mutex, 100);
+        if (m_queue.empty()) {
+            m_mutex.unlock();
+            break;
+        }
+        packet = m_queue.front();
+        queuedBytes = m_queuedBytes;
+        m_mutex.unlock();
+
+        // 队首的包最迟在入队后 budget 内发出：剩余时间越少速率越高，空闲时回到码率
+        int64_t now = av_gettime_relative();
+        int64_t remainUs = std::max(kMinDrainUs, m_budgetUs - (now - packet.queuedUs));
+        double rate = std::max(m_baseRate, (double)queuedBytes / remainUs);
+        double depth = std::max((double)m_bucketBytes, rate * kSleepGranularityUs);
+        tokens = std::min(depth, tokens + (now - lastRefill) * rate);
+        lastRefill = now;
+        if (tokens < packet.data.size()) {
+            int64_t waitUs = (int64_t)((packet.data.size() - tokens) / rate);
+            QThread::usleep((unsigned long)std::max<int64_t>(waitUs, 100));
+            continue;
+        }
+        tokens -= packet.data.size();
+
+        m_mutex.lock();
+        m_queue.pop_front();
+        m_queuedBytes -= packet.data.size();
+        m_mutex.unlock();
+
+        if (socket.writeDatagram(packet.data, m_host, m_port) < 0) m_sendErrors++;
+        int64_t queueUs = now - packet.queuedUs;
+        m_totalQueueUs += queueUs;
+        m_maxQueueUs = std::max(m_maxQueueUs, queueUs);
+        addToBin(&m_sentBins, now - m_startUs, kBinUs, packet.data.size());
+    }
+}
+
+QString RtpSender::report() const {
+    if (m_packets == 0) return "no packets";
+    return QString("%1 packets (%2 fragments), %3 MB, %4 send errors; queue delay avg %5 ms, max %6 ms; "
+        "10 ms burstiness %7 from encoder, %8 on the wire")
+        .arg(m_packets).arg(m_fragments).arg(m_bytes / 1048576.0, 0, 'f', 2).arg(m_sendErrors)
+        .arg(m_totalQueueUs / 1000.0 / m_packets, 0, 'f', 2).arg(m_maxQueueUs / 1000.0, 0, 'f', 2)
+        .arg(burstiness(m_queuedBins), 0, 'f', 1).arg(burstiness(m_sentBins), 0, 'f', 1);
+}
+
+RtpReceiver::RtpReceiver() {
+}
+
+RtpReceiver::~RtpReceiver() {
+    close();
+}
+
+bool RtpReceiver::open(quint16 port, AVCodecID codec, int jitterBufferMs, QString* error) {
+    if (m_thread) {
+        if (error) *error = "already open";
+        return false;
+    }
+    if (codec != AV_CODEC_ID_H264 && codec != AV_CODEC_ID_HEVC) {
+        if (error) *error = "RTP input supports H.264 and HEVC only";
+        return false;
+    }
+    m_codec = codec;
+    m_jitterUs = std::max(jitterBufferMs, 0) * 1000LL;
+    m_closing = false;
+
+    // socket 在接收线程里创建和绑定，绑定结果通过信号量传回
+    m_thread = QThread::create([this, port]() { receiveLoop(port); });
+    m_thread->start();
+    m_bound.acquire();
+    if (!m_bindOk) {
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+        if (error) *error = QString("cannot bind UDP port %1: %2").arg(port).arg(m_bindError);
+        return false;
+    }
+    return true;
+}
+
+void RtpReceiver::close() {
+    m_closing = true;
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    m_outMutex.lock();
+    m_outCond.wakeAll();
+    m_outMutex.unlock();
+}
+
+void RtpReceiver::receiveLoop(quint16 port) {
+    QUdpSocket socket;
+    if (!socket.bind(QHostAddress::AnyIPv4, port)) {
+        m_bindError = socket.errorString();
+        m_bindOk = false;
+        m_bound.release();
+        return;
+    }
+    // 关键帧的包是成串到达的，系统默认的接收缓冲容易溢出
+    socket.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 4 * 1024 * 1024);
+    m_bindOk = true;
+    m_bound.release();
+
+    while (!m_closing) {
+        if (socket.waitForReadyRead(5)) {
+            while (socket.hasPendingDatagrams()) {
+                QByteArray datagram((int)std::max<qint64>(socket.pendingDatagramSize(), 0), Qt::Uninitialized);
+                if (socket.readDatagram(datagram.data(), datagram.size()) < 0) break;
+                onDatagram(std::move(datagram), av_gettime());
+            }
+        }
+        releasePackets(av_gettime());
+    }
+
+    // 关闭时把缓冲里剩下的包都交出去
+    releasePackets(INT64_MAX);
+    finishAccessUnit();
+}
+
+void RtpReceiver::onDatagram(QByteArray&& data, int64_t arrivalUs) {
+    const uint8_t* p = (const uint8_t*)data.constData();
+    uint32_t seq = 0;
+    uint32_t ssrc = 0;
+    uint32_t delta = 0;
+    int64_t extSeq = 0;
+
+    if (data.size() < 12 || (p[0] >> 6) != 2) return;
+    seq = readBe16(p + 2);
+    ssrc = readBe32(p + 8);
+    m_lastPacketUs = arrivalUs;
+
+    if (m_highestSeq < 0) {
+        resync(ssrc, seq);
+    }
+    else {
+        // 扩展序号：相对已收到的最大序号取最近的一个，处理 16 位回绕
+        delta = (uint16_t)(seq - (uint32_t)m_highestSeq);
+        if (ssrc != m_ssrc || (delta >= (uint32_t)kMaxDropout && delta <= 65536u - kMaxMisorder)) {
+            // 发送端重启或序号跳变：单个包可能是残留或错发的，要求下一个序号紧接着到达
+            if (ssrc != m_probeSsrc || (int64_t)seq != m_badSeq) {
+                m_probeSsrc = ssrc;
+                m_badSeq = (seq + 1) & 0xffff;
+                return;
+            }
+            resync(ssrc, seq);
+        }
+    }
+    extSeq = m_highestSeq + (int16_t)(uint16_t)(seq - (uint32_t)m_highestSeq);
+    if (extSeq < m_nextSeq) {
+        m_late++;           // 已经判为丢失或已交出
+        return;
+    }
+    if (m_buffer.count(extSeq)) {
+        m_duplicates++;
+        return;
+    }
+    if (extSeq < m_highestSeq) m_reordered++;
+    else m_highestSeq = extSeq;
+    m_received++;
+
+    // RFC 3550 6.4.1：相对传输时间的差分的滑动平均
+    int64_t transit = arrivalUs * 9 / 100 - readBe32(p + 4);
+    if (m_lastTransit != INT64_MIN) {
+        int64_t d = transit - m_lastTransit;
+        if (d < 0) d = -d;
+        // 帧间时间戳跳变（90k 回绕）不计入
+        if (d < 90000) m_jitter += (d - m_jitter) / 16.0;
+    }
+    m_lastTransit = transit;
+
+    Packet& packet = m_buffer[extSeq];
+    packet.data = std::move(data);
+    packet.arrivalUs = arrivalUs;
+}
+
+void RtpReceiver::resync(uint32_t ssrc, int64_t seq) {
+    if (m_highestSeq >= 0) m_resyncs++;
+    // 旧流留下的包和半个访问单元拼不进新流，直接丢弃；解码器等到下一个关键帧恢复
+    m_buffer.clear();
+    m_au.clear();
+    m_fuNal.clear();
+    m_fuActive = false;
+    m_auStarted = false;
+    m_auKeyframe = false;
+    m_auDamaged = false;
+    m_auCaptureUs = 0;
+    m_ssrc = ssrc;
+    m_badSeq = -1;
+    m_nextSeq = seq;
+    m_highestSeq = seq;
+    m_lastTransit = INT64_MIN;
+}
+
+void RtpReceiver::releasePackets(int64_t nowUs) {
+    while (!m_buffer.empty()) {
+        auto head = m_buffer.begin();
+        bool gap = head->first != m_nextSeq;
+        // 缺包时等到队首的包在缓冲里待满抖动预算，仍未补上就判为丢失
+        if (gap && nowUs - head->second.arrivalUs < m_jitterUs) break;
+        if (gap) m_lost += head->first - m_nextSeq;
+        depacketize(head->second.data, gap);
+        m_nextSeq = head->first + 1;
+        m_buffer.erase(head);
+    }
+}
+
+void RtpReceiver::depacketize(const QByteArray& packet, bool afterGap) {
+    const uint8_t* p = (const uint8_t*)packet.constData();
+    const uint8_t* end = p + packet.size();
+    const bool marker = (p[1] & 0x80) != 0;
+    const uint32_t timestamp = readBe32(p + 4);
+    const uint8_t* payload = p + 12 + 4 * (p[0] & 0x0f);
+    int64_t captureUs = 0;
+
+    // 填充位：最后一个字节为填充长度
+    if (p[0] & 0x20) end -= end[-1];
+    if (p[0] & 0x10) {
+        if (payload + 4 > end) return;
+        uint32_t profile = readBe16(payload);
+        const uint8_t* ext = payload + 4;
+        const uint8_t* extEnd = ext + 4 * readBe16(payload + 2);
+        if (extEnd > end) return;
+        if (profile == (uint32_t)kExtensionProfile) {
+            // 单字节头元素：ID 4 位，长度-1 4 位；0 为填充
+            while (ext < extEnd) {
+                if (*ext == 0) {
+                    ext++;
+                    continue;
+                }
+                int id = *ext >> 4;
+                int len = (*ext & 0x0f) + 1;
+                if (id == 15 || ext + 1 + len > extEnd) break;
+                if (id == kCaptureExtensionId && len == 8) {
+                    captureUs = (int64_t)(((uint64_t)readBe32(ext + 1) << 32) | readBe32(ext + 5));
+                }
+                ext += 1 + len;
+            }
+        }
+        payload = extEnd;
+    }
+    if (payload >= end) return;
+
+    // 时间戳变了说明上一帧的最后一个包（带 marker）丢了
+    if (m_auStarted && timestamp != m_auTimestamp) {
+        if (afterGap) m_auDamaged = true;
+        finishAccessUnit();
+    }
+    if (!m_auStarted) {
+        m_auStarted = true;
+        m_auTimestamp = timestamp;
+        m_auCaptureUs = captureUs;
+    }
+    if (afterGap) {
+        m_auDamaged = true;
+        // 丢了中间分片的 NAL 无法还原，整个丢掉
+        m_fuActive = false;
+        m_fuNal.clear();
+    }
+
+    const int payloadSize = (int)(end - payload);
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        int type = (payload[0] >> 1) & 0x3f;
+        if (payloadSize < 2) {
+            m_auDamaged = true;
+        }
+        else if (type == 48) {
+            // AP：每个 NAL 前有 16 位长度
+            const uint8_t* q = payload + 2;
+            while (q + 2 <= end) {
+                int n = (int)readBe16(q);
+                if (n == 0 || q + 2 + n > end) break;
+                appendNal(q + 2, n);
+                q += 2 + n;
+            }
+        }
+        else if (type == 49) {
+            if (payloadSize < 3) return;
+            uint8_t fu = payload[2];
+            if (fu & 0x80) {
+                uint8_t header[2] = { (uint8_t)((payload[0] & 0x81) | ((fu & 0x3f) << 1)), payload[1] };
+                m_fuNal = QByteArray((const char*)header, 2);
+                m_fuActive = true;
+            }
+            if (m_fuActive) {
+                m_fuNal.append((const char*)payload + 3, payloadSize - 3);
+                if (fu & 0x40) {
+                    appendNal((const uint8_t*)m_fuNal.constData(), m_fuNal.size());
+                    m_fuActive = false;
+                    m_fuNal.clear();
+                }
+            }
+            else {
+                m_auDamaged = true;
+            }
+        }
+        else {
+            appendNal(payload, payloadSize);
+        }
+    }
+    else {
+        int type = payload[0] & 0x1f;
+        if (type == 24) {
+            // STAP-A
+            const uint8_t* q = payload + 1;
+            while (q + 2 <= end) {
+                int n = (int)readBe16(q);
+                if (n == 0 || q + 2 + n > end) break;
+                appendNal(q + 2, n);
+                q += 2 + n;
+            }
+        }
+        else if (type == 28) {
+            if (payloadSize < 2) return;
+            uint8_t fu = payload[1];
+            if (fu & 0x80) {
+                uint8_t header = (uint8_t)((payload[0] & 0xe0) | (fu & 0x1f));
+                m_fuNal = QByteArray((const char*)&header, 1);
+                m_fuActive = true;
+            }
+            if (m_fuActive) {
+                m_fuNal.append((const char*)payload + 2, payloadSize - 2);
+                if (fu & 0x40) {
+                    appendNal((const uint8_t*)m_fuNal.constData(), m_fuNal.size());
+                    m_fuActive = false;
+                    m_fuNal.clear();
+                }
+            }
+            else {
+                m_auDamaged = true;
+            }
+        }
+        else if (type >= 1 && type <= 23) {
+            appendNal(payload, payloadSize);
+        }
+    }
+
+    if (marker) finishAccessUnit();
+}
+
+void RtpReceiver::appendNal(const uint8_t* nal, int size) {
+    static const char startCode[4] = { 0, 0, 0, 1 };
+    if (m_codec == AV_CODEC_ID_HEVC) {
+        int type = (nal[0] >> 1) & 0x3f;
+        if (type >= 16 && type <= 21) m_auKeyframe = true;     // IRAP
+    }
+    else if ((nal[0] & 0x1f) == 5) {
+        m_auKeyframe = true;
+    }
+    m_au.append(startCode, 4);
+    m_au.append((const char*)nal, size);
+}
+
+void RtpReceiver::finishAccessUnit() {
+    if (!m_au.isEmpty()) {
+        m_frames++;
+        if (m_auDamaged) m_damagedFrames++;
+        if (m_auCaptureUs > 0) m_receiveLatencyUs.push_back((int)(av_gettime() - m_auCaptureUs));
+
+        m_outMutex.lock();
+        if (m_waitKeyframe && !m_auKeyframe) {
+            m_droppedFrames++;
+        }
+        else {
+            m_waitKeyframe = false;
+            m_output.push_back({ m_au, m_auCaptureUs, m_auKeyframe });
+        }
+        if ((int)m_output.size() > kMaxQueuedFrames) {
+            // 读了一半的队首不能丢；其后丢到下一个关键帧，解码器从关键帧接上。
+            // 队列里没有关键帧就全丢，之后收到的帧也丢，直到关键帧到达
+            size_t first = m_outOffset > 0 ? 1 : 0;
+            size_t key = first + 1;
+            while (key < m_output.size() && !m_output[key].keyframe) key++;
+            if (key == m_output.size()) m_waitKeyframe = true;
+            m_droppedFrames += key - first;
+            m_output.erase(m_output.begin() + first, m_output.begin() + key);
+        }
+        m_outCond.wakeAll();
+        m_outMutex.unlock();
+    }
+    m_au.clear();
+    m_auStarted = false;
+    m_auKeyframe = false;
+    m_auDamaged = false;
+    m_auCaptureUs = 0;
+}
+
+int RtpReceiver::read(uint8_t* buf, int size) {
+    QMutexLocker locker(&m_outMutex);
+    for (;;) {
+        if (!m_output.empty()) {
+            const AccessUnit& front = m_output.front();
+            int n = std::min(size, (int)front.data.size() - m_outOffset);
+            memcpy(buf, front.data.constData() + m_outOffset, n);
+            m_outOffset += n;
+            if (m_outOffset == front.data.size()) {
+                m_pendingCapture.push_back(front.captureUs);
+                // 没人调用 notePresented（如命令行测试）时不让它无限增长
+                if ((int)m_pendingCapture.size() > kMaxPendingFrames) m_pendingCapture.pop_front();
+                m_output.pop_front();
+                m_outOffset = 0;
+            }
+            return n;
+        }
+        if (m_closing) return AVERROR_EOF;
+        if (m_interrupt.callback && m_interrupt.callback(m_interrupt.opaque)) return AVERROR_EXIT;
+        int64_t last = m_lastPacketUs;
+        if (last > 0 && av_gettime() - last > kIdleTimeoutUs) return AVERROR_EOF;
+        m_outCond.wait(&m_outMutex, 50);
+    }
+}
+
+int RtpReceiver::readPacket(void* opaque, uint8_t* buf, int size) {
+    return static_cast<RtpReceiver*>(opaque)->read(buf, size);
+}
+
+void RtpReceiver::notePresented() {
+    QMutexLocker locker(&m_outMutex);
+    if (m_pendingCapture.empty()) return;
+    int64_t captureUs = m_pendingCapture.front();
+    m_pendingCapture.pop_front();
+    if (captureUs > 0) m_presentLatencyUs.push_back((int)(av_gettime() - captureUs));
+}
+
+QString RtpReceiver::report() const {
+    QMutexLocker locker(&m_outMutex);
+    if (m_received == 0) return "no packets";
+    return QString("%1 packets, %2 lost, %3 reordered, %4 late, %5 duplicate, %6 resyncs; "
+        "%7 frames (%8 damaged, %9 dropped while backed up); jitter %10 ms; latency at receive %11; at display %12")
+        .arg(m_received).arg(m_lost).arg(m_reordered).arg(m_late).arg(m_duplicates).arg(m_resyncs)
+        .arg(m_frames).arg(m_damagedFrames).arg(m_droppedFrames).arg(m_jitter / 90.0, 0, 'f', 2)
+        .arg(latencySummary(m_receiveLatencyUs)).arg(latencySummary(m_presentLatencyUs));
+}
\ No newline at end of file
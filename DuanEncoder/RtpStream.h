@@ -0,0 +1,210 @@
+#pragma once
+#include <QByteArray>
+#include <QHostAddress>
+#include <QMutex>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+#include "SliceOutput.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avio.h>
+}
+
+// H.264（RFC 6184）/ HEVC（RFC 7798）over RTP/UDP，用于机器间的实时预览。
+// 每个包带一个 RTP 头扩展（RFC 8285 单字节头，ID 1）：帧送入编码器时的墙钟微秒数，
+// 接收端据此计算端到端延迟。两台机器之间需要时钟同步，本机回环测试不需要
+namespace Rtp {
+const int kDefaultPort = 5004;
+const int kDefaultMtu = 1400;          // UDP 负载上限，包括 RTP 头
+const int kDefaultJitterMs = 50;
+const int kHeaderBytes = 28;           // 12 字节固定头 + 16 字节扩展
+const int kPayloadType = 96;
+}
+
+// 发送端：作为 SliceSink 挂在编码器输出上，切片到达即按 MTU 分包放入发送队列，
+// 由发送线程按令牌桶匀速发出。速率取 码率×余量 与 “队列须在抖动预算内发完” 两者的较大值，
+// 关键帧这样的大帧被摊开在预算时间内，而不是一次灌进网络
+class RtpSender : public SliceSink {
+public:
+    RtpSender();
+    ~RtpSender() override;
+
+    // target 为 host:port
+    bool open(const QString& target, AVCodecID codec, int bitRate, double frameRate,
+        int jitterBudgetMs, int mtu, QString* error);
+    // 发完队列中的包后停止发送线程
+    void close();
+    bool isOpen() const { return m_thread != nullptr; }
+    // 全局头里的参数集；码流中出现的参数集也会被记下，定期重发，中途加入的接收端也能解码
+    void setParameterSets(const uint8_t* data, int size);
+
+    void frameSubmitted(int64_t pts) override;
+    int writeSlice(const uint8_t* data, int size, int64_t pts, bool keyframe, bool lastInFrame) override;
+    // 包数、分片数、排队延迟，以及入队（编码器输出）和发出两侧的突发度
+    QString report() const;
+
+private:
+    struct Packet {
+        QByteArray data;
+        int64_t queuedUs;
+    };
+
+    void packetizeNal(const uint8_t* nal, int size, bool marker);
+    void queuePacket(const uint8_t* header, int headerSize, const uint8_t* payload, int payloadSize, bool marker);
+    void rememberParameterSet(const uint8_t* nal, int size);
+    bool isParameterSet(const uint8_t* nal) const;
+    void pace();
+
+    static const int kPendingFrames = 64;
+    static const int kParamSetInterval = 25;   // 最多隔这么多帧重发一次参数集
+    static const int kBinUs = 10000;           // 突发度统计窗口 10 ms
+
+    AVCodecID m_codec = AV_CODEC_ID_H264;
+    QHostAddress m_host;
+    quint16 m_port = 0;
+    int m_mtu = Rtp::kDefaultMtu;
+    double m_frameRate = 25.0;
+    double m_baseRate = 0;                     // 字节/微秒
+    int64_t m_budgetUs = 0;
+    int m_bucketBytes = 0;                     // 最小桶深，实际桶深随速率放大到一个睡眠粒度
+
+    // 当前帧
+    uint16_t m_seq = 0;
+    uint32_t m_ssrc = 0;
+    uint32_t m_timestamp = 0;
+    int64_t m_captureUs = 0;
+    bool m_inFrame = false;
+    int m_framesSinceParamSets = kParamSetInterval;
+    std::map<int, QByteArray> m_paramSets;
+    int64_t m_submitPts[kPendingFrames];
+    int64_t m_submitWallUs[kPendingFrames];
+
+    QThread* m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    std::deque<Packet> m_queue;
+    int64_t m_queuedBytes = 0;
+    bool m_closing = false;
+
+    // 统计：入队一侧由编码线程写，发出一侧由发送线程写，report() 在 close() 之后读
+    int64_t m_startUs = 0;
+    int64_t m_packets = 0;
+    int64_t m_fragments = 0;
+    int64_t m_bytes = 0;
+    int64_t m_sendErrors = 0;
+    int64_t m_maxQueueUs = 0;
+    int64_t m_totalQueueUs = 0;
+    std::vector<int64_t> m_queuedBins;
+    std::vector<int64_t> m_sentBins;
+};
+
+// 接收端：接收线程收包、放进按序号排序的抖动缓冲，缺包最多等待 jitterBufferMs 后判为丢失，
+// 再拆包拼回 Annex-B 访问单元。read() 供 AVIOContext 读回调使用，播放器按裸 H.264/HEVC 打开
+class RtpReceiver {
+public:
+    RtpReceiver();
+    ~RtpReceiver();
+
+    bool open(quint16 port, AVCodecID codec, int jitterBufferMs, QString* error);
+    void close();
+    // 等待数据时轮询，返回非零即中断 read()
+    void setInterruptCallback(const AVIOInterruptCB& callback) { m_interrupt = callback; }
+
+    // 阻塞到有数据；中断返回 AVERROR_EXIT，关闭或发送端停发超过数秒返回 AVERROR_EOF
+    int read(uint8_t* buf, int size);
+    static int readPacket(void* opaque, uint8_t* buf, int size);
+    // 显示一帧时调用：按到达顺序对应到访问单元，记录从送入编码器到显示的延迟
+    void notePresented();
+    // 丢包、乱序、重新同步、积压丢帧、到达抖动，以及拼出访问单元时和显示时的端到端延迟
+    QString report() const;
+    // 收到的有效包数，close() 之后调用
+    int64_t packetsReceived() const { return m_received; }
+
+private:
+    struct Packet {
+        QByteArray data;
+        int64_t arrivalUs;
+    };
+    struct AccessUnit {
+        QByteArray data;
+        int64_t captureUs;
+        bool keyframe;
+    };
+
+    void receiveLoop(quint16 port);
+    void onDatagram(QByteArray&& data, int64_t arrivalUs);
+    // 换了发送端（SSRC 变化）或序号大幅跳变时清空抖动缓冲和正在拼装的帧，从 seq 重新开始
+    void resync(uint32_t ssrc, int64_t seq);
+    void releasePackets(int64_t nowUs);
+    void depacketize(const QByteArray& packet, bool afterGap);
+    void appendNal(const uint8_t* nal, int size);
+    void finishAccessUnit();
+
+    static const int64_t kIdleTimeoutUs = 5000000;
+    static const int kMaxPendingFrames = 1000;
+    // 播放器暂停或跟不上时 read() 队列里最多积压的帧数，超出后从队首丢到下一个关键帧
+    static const int kMaxQueuedFrames = 125;
+    // RFC 3550 A.1：前跳超过 kMaxDropout 或后退超过 kMaxMisorder 的序号视为跳变，连续两包确认后才重新同步
+    static const int kMaxDropout = 3000;
+    static const int kMaxMisorder = 100;
+
+    AVCodecID m_codec = AV_CODEC_ID_H264;
+    int64_t m_jitterUs = 0;
+    AVIOInterruptCB m_interrupt = { nullptr, nullptr };
+    QThread* m_thread = nullptr;
+    QSemaphore m_bound;
+    bool m_bindOk = false;
+    QString m_bindError;
+    std::atomic<bool> m_closing{ false };
+    std::atomic<int64_t> m_lastPacketUs{ 0 };
+
+    // 抖动缓冲，键为扩展后的序号（只在接收线程访问）
+    std::map<int64_t, Packet> m_buffer;
+    int64_t m_nextSeq = -1;
+    int64_t m_highestSeq = -1;
+    uint32_t m_ssrc = 0;
+    // 跳变或新 SSRC 的第一个包不采用，只记下期望的下一个包；紧接着它到达才切换过去
+    uint32_t m_probeSsrc = 0;
+    int64_t m_badSeq = -1;
+
+    // 正在拼装的访问单元
+    QByteArray m_au;
+    QByteArray m_fuNal;
+    bool m_fuActive = false;
+    bool m_auDamaged = false;
+    bool m_auStarted = false;
+    bool m_auKeyframe = false;
+    uint32_t m_auTimestamp = 0;
+    int64_t m_auCaptureUs = 0;
+
+    // 输出给 read()
+    mutable QMutex m_outMutex;
+    QWaitCondition m_outCond;
+    std::deque<AccessUnit> m_output;
+    int m_outOffset = 0;
+    bool m_waitKeyframe = false;           // 积压时整个队列都丢了，丢到下一个关键帧为止
+    std::deque<int64_t> m_pendingCapture;  // 已交给解码器、尚未显示的帧
+
+    // 统计
+    int64_t m_received = 0;
+    int64_t m_lost = 0;
+    int64_t m_reordered = 0;
+    int64_t m_late = 0;
+    int64_t m_duplicates = 0;
+    int64_t m_resyncs = 0;
+    int64_t m_frames = 0;
+    int64_t m_damagedFrames = 0;
+    int64_t m_droppedFrames = 0;           // 积压丢弃，在 m_outMutex 下读写
+    double m_jitter = 0;                   // RFC 3550 到达间隔抖动，90kHz 单位
+    int64_t m_lastTransit = INT64_MIN;
+    std::vector<int> m_receiveLatencyUs;
+    std::vector<int> m_presentLatencyUs;
+};
\ No newline at end of file
@@ -0,0 +1,450 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "SceneDetector.h"
+#include "Simd.h"
+#include "Tracer.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+namespace {
+// 切换判定：块均值 SAD 远高于近期水平，或直方图明显变化且 SAD 也偏高。
+// 平移、快速运动时 SAD 高但直方图基本不变，淡入淡出时两者都缓慢变化，都不会触发
+const float kStrongSad = 40.0f;
+const float kStrongSadRatio = 4.0f;
+const float kHistThreshold = 0.25f;
+const float kMinSad = 10.0f;
+const float kSadRatio = 2.0f;
+
+// 每 8x8 块求均值，输出 blocksW x blocksH 的缩略图
+void downsampleC(const uint8_t* src, int stride, int blocksW, int blocksH, uint8_t* dst) {
+    for (int by = 0; by < blocksH; by++) {
+        const uint8_t* rows = src + (size_t)by * 8 * stride;
+        for (int bx = 0; bx < blocksW; bx++) {
+            int sum = 0;
+            for (int y = 0; y < 8; y++) {
+                const uint8_t* p = rows + (size_t)y * stride + bx * 8;
+                for (int x = 0; x < 8; x++) sum += p[x];
+            }
+            dst[by * blocksW + bx] = (uint8_t)((sum + 32) >> 6);
+        }
+    }
+}
+
+int64_t sadC(const uint8_t* a, const uint8_t* b, int n) {
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++) sum += std::abs(a[i] - b[i]);
+    return sum;
+}
+
+#ifdef DUAN_X86
+// sad_epu8 对零求和即每 8 字节的横向和，8 行累加后每个 64 位通道正好是一个 8x8 块的和，一次处理 4 块
+DUAN_AVX2_TARGET void downsampleAvx2(const uint8_t* src, int stride, int blocksW, int blocksH, uint8_t* dst) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi64x(32);
+    alignas(32) uint64_t lanes[4];
+    for (int by = 0; by < blocksH; by++) {
+        const uint8_t* rows = src + (size_t)by * 8 * stride;
+        uint8_t* out = dst + by * blocksW;
+        int bx = 0;
+        for (; bx + 4 <= blocksW; bx += 4) {
+            __m256i acc = zero;
+            for (int y = 0; y < 8; y++) {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(rows + (size_t)y * stride + bx * 8));
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+            }
+            _mm256_store_si256((__m256i*)lanes, _mm256_srli_epi64(_mm256_add_epi64(acc, round), 6));
+            out[bx] = (uint8_t)lanes[0];
+            out[bx + 1] = (uint8_t)lanes[1];
+            out[bx + 2] = (uint8_t)lanes[2];
+            out[bx + 3] = (uint8_t)lanes[3];
+        }
+        // 不足 4 块的列
+        for (; bx < blocksW; bx++) {
+            int sum = 0;
+            for (int y = 0; y < 8; y++) {
+                const uint8_t* p = rows + (size_t)y * stride + bx * 8;
+                for (int x = 0; x < 8; x++) sum += p[x];
+            }
+            out[bx] = (uint8_t)((sum + 32) >> 6);
+        }
+    }
+}
+
+DUAN_AVX2_TARGET int64_t sadAvx2(const uint8_t* a, const uint8_t* b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    alignas(32) int64_t lanes[4];
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+    }
+    _mm256_store_si256((__m256i*)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sadC(a + i, b + i, n - i);
+}
+#endif
+
+struct Kernels {
+    void (*downsample)(const uint8_t*, int, int, int, uint8_t*);
+    int64_t (*sad)(const uint8_t*, const uint8_t*, int);
+};
+
+const Kernels kScalarKernels = { downsampleC, sadC };
+#ifdef DUAN_X86
+const Kernels kAvx2Kernels = { downsampleAvx2, sadAvx2 };
+#endif
+
+const Kernels& kernels(bool avx2) {
+#ifdef DUAN_X86
+    if (avx2) return kAvx2Kernels;
+#endif
+    (void)avx2;
+    return kScalarKernels;
+}
+
+// 缩略图只有原图的 1/64，直方图用标量即可
+void histogram(const uint8_t* plane, int n, int* hist, int bins) {
+    const int shift = bins == 32 ? 3 : 0;
+    std::fill(hist, hist + bins, 0);
+    for (int i = 0; i < n; i++) hist[plane[i] >> shift]++;
+}
+
+float histDiff(const int* a, const int* b, int bins, int n) {
+    int64_t diff = 0;
+    for (int i = 0; i < bins; i++) diff += std::abs(a[i] - b[i]);
+    return n > 0 ? (float)diff / (2.0f * n) : 0.0f;
+}
+}
+
+SceneDetector::SceneDetector() {
+}
+
+SceneDetector::~SceneDetector() {
+    stop();
+}
+
+bool SceneDetector::start(const QString& yuvPath, int width, int height, int frameCount,
+    int lookahead, int minKeyint, int maxKeyint, QString* error) {
+    FILE* file = NULL;
+
+    if (m_thread) {
+        *error = "scene detection is already running";
+        return false;
+    }
+    if (width < kBlock || height < kBlock) {
+        *error = QString("frame %1x%2 is too small").arg(width).arg(height);
+        return false;
+    }
+    // 分析线程用自己的文件句柄，和编码线程的读取互不影响
+    file = fopen(yuvPath.toUtf8().constData(), "rb");
+    if (!file) {
+        *error = QString("could not open '%1'").arg(yuvPath);
+        return false;
+    }
+
+    m_path = yuvPath;
+    m_width = width;
+    m_height = height;
+    m_frameCount = frameCount;
+    m_lookahead = std::max(lookahead, 1);
+    m_minKeyint = std::max(minKeyint, 1);
+    m_maxKeyint = std::max(maxKeyint, m_minKeyint);
+    m_avx2 = cpuHasAvx2();
+
+    m_blocksW = width / kBlock;
+    m_blocksH = height / kBlock;
+    for (int i = 0; i < 3; i++) {
+        m_planes[i].assign((size_t)m_blocksW * m_blocksH, 0);
+        m_hists[i].assign(kHistBins, 0);
+    }
+    m_pending.clear();
+    m_avgSad = -1;
+    m_lastKey = -1;
+    m_deferring = false;
+
+    m_decisions.clear();
+    m_decisions.reserve(frameCount > 0 ? frameCount : 0);
+    m_requested = 0;
+    m_finished = false;
+    m_stop = false;
+
+    m_cuts.clear();
+    m_keyframes.clear();
+    m_encodedFrames = -1;
+    m_periodicKeys = 0;
+    m_suppressedPeriodic = 0;
+    m_flashes = 0;
+    m_analyzedFrames = 0;
+    m_analyzeUs = 0;
+    m_readUs = 0;
+    m_waitUs = 0;
+
+    m_thread = QThread::create([this, file]() {
+        DUAN_TRACE_THREAD("scene lookahead");
+        analyzeLoop(file);
+        fclose(file);
+    });
+    m_thread->start();
+    return true;
+}
+
+void SceneDetector::stop() {
+    if (!m_thread) return;
+    m_mutex.lock();
+    m_stop = true;
+    m_cond.wakeAll();
+    m_mutex.unlock();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void SceneDetector::analyzeLoop(FILE* file) {
+    const size_t y_size = (size_t)m_width * m_height;
+    // 4:2:0，色度不参与判定，直接跳过
+    const long chroma_size = (long)(y_size / 2);
+    std::vector<uint8_t> luma(y_size);
+
+    for (int i = 0; i < m_frameCount; i++) {
+        // 最多领先编码线程 lookahead + kExtraLead 帧
+        m_mutex.lock();
+        while (!m_stop && i > m_requested + m_lookahead + kExtraLead) m_cond.wait(&m_mutex);
+        bool stop = m_stop;
+        m_mutex.unlock();
+        if (stop) break;
+
+        int64_t read_start = av_gettime_relative();
+        if (fread(luma.data(), 1, y_size, file) != y_size) break;
+        if (fseek(file, chroma_size, SEEK_CUR) != 0) break;
+        int64_t analyze_start = av_gettime_relative();
+        {
+            DUAN_TRACE_SCOPE("scene_analyze");
+            analyzeFrame(i, luma.data());
+        }
+        int64_t analyze_end = av_gettime_relative();
+        m_readUs += analyze_start - read_start;
+        m_analyzeUs += analyze_end - analyze_start;
+        m_analyzedFrames++;
+    }
+
+    // 文件结束或停止：最后一帧没有后续帧，直接判定，剩下的帧全部放出
+    if (!m_pending.empty() && !m_pending.back().judged) judge(&m_pending.back(), NULL);
+    place(true);
+
+    m_mutex.lock();
+    m_finished = true;
+    m_cond.wakeAll();
+    m_mutex.unlock();
+}
+
+void SceneDetector::analyzeFrame(int index, const uint8_t* luma) {
+    const Kernels& k = kernels(m_avx2);
+    const int blocks = m_blocksW * m_blocksH;
+    const int slot = index % 3;
+    Pending current;
+
+    k.downsample(luma, m_width, m_blocksW, m_blocksH, m_planes[slot].data());
+    histogram(m_planes[slot].data(), blocks, m_hists[slot].data(), kHistBins);
+
+    current.frame = index;
+    if (index > 0) {
+        const int prev = (index - 1) % 3;
+        current.sad = (float)k.sad(m_planes[prev].data(), m_planes[slot].data(), blocks) / blocks;
+        current.hist = histDiff(m_hists[prev].data(), m_hists[slot].data(), kHistBins, blocks);
+    }
+    // 有了这一帧，上一帧才能判定
+    if (!m_pending.empty()) judge(&m_pending.back(), &current);
+    m_pending.push_back(current);
+    place(false);
+}
+
+bool SceneDetector::isCutScore(float sad, float hist) const {
+    const float avg = m_avgSad < 0 ? 0.0f : m_avgSad;
+    if (sad >= std::max(kStrongSad, avg * kStrongSadRatio)) return true;
+    return hist >= kHistThreshold && sad >= std::max(kMinSad, avg * kSadRatio);
+}
+
+void SceneDetector::judge(Pending* candidate, Pending* next) {
+    const int j = candidate->frame;
+    bool flash = false;
+
+    candidate->judged = true;
+    candidate->cut = j > 0 && isCutScore(candidate->sad, candidate->hist);
+    if (candidate->cut && next && j > 0) {
+        // 前一帧和后一帧仍然相似：闪光灯或单帧干扰，不算切换；后一帧改为和闪光前的帧比较
+        const Kernels& k = kernels(m_avx2);
+        const int blocks = m_blocksW * m_blocksH;
+        const int before = (j - 1) % 3;
+        const int after = next->frame % 3;
+        float bridge_sad = (float)k.sad(m_planes[before].data(), m_planes[after].data(), blocks) / blocks;
+        float bridge_hist = histDiff(m_hists[before].data(), m_hists[after].data(), kHistBins, blocks);
+        if (!isCutScore(bridge_sad, bridge_hist)) {
+            candidate->cut = false;
+            next->sad = bridge_sad;
+            next->hist = bridge_hist;
+            flash = true;
+            m_flashes++;
+        }
+    }
+
+    if (candidate->cut) {
+        Cut cut;
+        cut.frame = j;
+        cut.sad = candidate->sad;
+        cut.hist = candidate->hist;
+        m_cuts.push_back(cut);
+    }
+    else if (j > 0 && !flash) {
+        // 近期运动水平，切换和闪光不计入
+        m_avgSad = m_avgSad < 0 ? candidate->sad : m_avgSad * 0.9f + candidate->sad * 0.1f;
+    }
+}
+
+void SceneDetector::place(bool flush) {
+    // 最后一帧要等下一帧才判定，所以队首之后需要 lookahead 个已判定的帧
+    while (!m_pending.empty() && (flush || (int)m_pending.size() >= m_lookahead + 2)) {
+        const Pending& front = m_pending.front();
+        const int j = front.frame;
+        const int since = m_lastKey < 0 ? INT_MAX : j - m_lastKey;
+        bool key = false;
+
+        if (m_lastKey < 0) {
+            key = true;
+        }
+        else if (front.cut && since >= m_minKeyint) {
+            key = true;
+            for (auto it = m_cuts.rbegin(); it != m_cuts.rend(); ++it) {
+                if (it->frame == j) {
+                    it->keyframe = true;
+                    break;
+                }
+            }
+        }
+        else if (since >= m_maxKeyint) {
+            // 周期关键帧到期，前方 lookahead 帧内有切换时推迟到切换处
+            bool cut_ahead = false;
+            for (size_t k = 1; k < m_pending.size() && k <= (size_t)m_lookahead; k++) {
+                if (m_pending[k].judged && m_pending[k].cut) {
+                    cut_ahead = true;
+                    break;
+                }
+            }
+            if (cut_ahead) {
+                if (!m_deferring) m_suppressedPeriodic++;
+                m_deferring = true;
+            }
+            else {
+                key = true;
+                m_periodicKeys++;
+            }
+        }
+
+        if (key) {
+            m_lastKey = j;
+            m_deferring = false;
+            m_keyframes.push_back(j);
+        }
+        publish(key);
+        m_pending.pop_front();
+    }
+}
+
+void SceneDetector::publish(bool keyframe) {
+    m_mutex.lock();
+    m_decisions.push_back(keyframe ? 1 : 0);
+    m_cond.wakeAll();
+    m_mutex.unlock();
+}
+
+bool SceneDetector::waitDecision(int index, bool* keyframe) {
+    QMutexLocker locker(&m_mutex);
+    int64_t wait_start = 0;
+
+    m_requested = std::max(m_requested, index);
+    m_cond.wakeAll();
+    while (index >= (int)m_decisions.size() && !m_finished && !m_stop) {
+        if (!wait_start) wait_start = av_gettime_relative();
+        m_cond.wait(&m_mutex);
+    }
+    if (wait_start) m_waitUs += av_gettime_relative() - wait_start;
+    if (index >= (int)m_decisions.size()) return false;
+    *keyframe = m_decisions[index] != 0;
+    return true;
+}
+
+void SceneDetector::clipToFrames(int frames) {
+    m_encodedFrames = frames;
+    while (!m_keyframes.empty() && m_keyframes.back() >= frames) {
+        const int j = m_keyframes.back();
+        bool at_cut = false;
+        for (const Cut& cut : m_cuts) {
+            if (cut.frame == j && cut.keyframe) at_cut = true;
+        }
+        // 第 0 帧既不算切换也不算周期关键帧
+        if (!at_cut && j > 0) m_periodicKeys--;
+        m_keyframes.pop_back();
+    }
+    while (!m_cuts.empty() && m_cuts.back().frame >= frames) m_cuts.pop_back();
+}
+
+QString SceneDetector::report() const {
+    int cut_keys = 0;
+    if (m_analyzedFrames == 0) return "no frames analyzed";
+    for (const Cut& cut : m_cuts) {
+        if (cut.keyframe) cut_keys++;
+    }
+
+    return QString("%1 frames, %2 cuts (%3 too close to the previous keyframe), %4 flashes ignored; "
+        "%5 keyframes: %6 at cuts, %7 periodic, %8 periodic IDRs moved to a cut; "
+        "analysis %9 ms/frame (%10) + read %11 ms/frame, encoder waited %12 ms in total")
+        .arg(m_encodedFrames >= 0 ? QString("%1 of %2 analyzed").arg(m_encodedFrames).arg(m_analyzedFrames)
+            : QString::number(m_analyzedFrames)).arg((int)m_cuts.size()).arg((int)m_cuts.size() - cut_keys).arg(m_flashes)
+        .arg((int)m_keyframes.size()).arg(cut_keys).arg(m_periodicKeys).arg(m_suppressedPeriodic)
+        .arg(m_analyzeUs / 1000.0 / m_analyzedFrames, 0, 'f', 3).arg(m_avx2 ? "AVX2" : "scalar")
+        .arg(m_readUs / 1000.0 / m_analyzedFrames, 0, 'f', 3).arg(m_waitUs / 1000.0, 0, 'f', 1);
+}
+
+bool SceneDetector::writeCutList(const QString& path, double frameRate, QString* error) const {
+    QJsonArray cuts;
+    for (const Cut& cut : m_cuts) {
+        QJsonObject entry;
+        entry["frame"] = cut.frame;
+        entry["time"] = qRound(cut.frame / frameRate * 1000) / 1000.0;
+        entry["sad"] = qRound(cut.sad * 100) / 100.0;
+        entry["hist"] = qRound(cut.hist * 1000) / 1000.0;
+        entry["key"] = cut.keyframe;
+        cuts.append(entry);
+    }
+
+    QJsonArray keyframes;
+    for (int frame : m_keyframes) keyframes.append(frame);
+
+    QJsonObject root;
+    root["input"] = m_path;
+    root["width"] = m_width;
+    root["height"] = m_height;
+    root["frame_rate"] = frameRate;
+    root["frames"] = m_encodedFrames >= 0 ? m_encodedFrames : m_analyzedFrames;
+    root["lookahead"] = m_lookahead;
+    root["min_keyint"] = m_minKeyint;
+    root["max_keyint"] = m_maxKeyint;
+    root["summary"] = report();
+    root["cuts"] = cuts;
+    root["keyframes"] = keyframes;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+// 场景切换预分析：独立线程提前读取原始 YUV 的亮度平面，领先编码线程若干帧，
+// 每帧缩成 8x8 块均值的小图，与前一帧比较块均值的 SAD 和亮度直方图差异。
+// 判定为切换的帧强制编成关键帧；周期关键帧到期时若前方几帧内就有切换，推迟到切换处，省掉一个多余的 IDR
+class SceneDetector {
+public:
+    struct Cut {
+        int frame = 0;
+        float sad = 0;       // 块均值的平均绝对差，0~255
+        float hist = 0;      // 直方图差异，0~1
+        bool keyframe = false;   // 离上一个关键帧太近的切换只记录，不强制关键帧
+    };
+
+    SceneDetector();
+    ~SceneDetector();
+
+    // lookahead 为判定一帧前需要看到的后续帧数；关键帧间隔在 [minKeyint, maxKeyint + lookahead] 内
+    bool start(const QString& yuvPath, int width, int height, int frameCount,
+        int lookahead, int minKeyint, int maxKeyint, QString* error);
+    // 编码线程送第 index 帧前调用，阻塞到结论可用；分析线程已结束（文件不足或停止）时返回 false
+    bool waitDecision(int index, bool* keyframe);
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+    bool usesAvx2() const { return m_avx2; }
+
+    // 以下在 stop() 之后调用
+    // 停止时分析线程会把已读到的帧全部放出，取消或编码提前结束时其中一部分没有编码；
+    // 只保留前 frames 帧的切换和关键帧，导出和报告都按实际编码的帧数
+    void clipToFrames(int frames);
+    const std::vector<Cut>& cuts() const { return m_cuts; }
+    const std::vector<int>& keyframes() const { return m_keyframes; }
+    // 切换点、最终的关键帧位置和判定参数，供分段等下游工具对齐
+    bool writeCutList(const QString& path, double frameRate, QString* error) const;
+    // 切换数、关键帧来源、每帧分析耗时和编码线程的等待时间
+    QString report() const;
+
+private:
+    struct Pending {
+        int frame = 0;
+        float sad = 0;
+        float hist = 0;
+        bool cut = false;
+        bool judged = false;     // 切换判定要等下一帧（排除闪光）
+    };
+
+    static const int kBlock = 8;
+    static const int kHistBins = 32;
+    static const int kExtraLead = 4;     // 在 lookahead 之外最多再领先这么多帧
+
+    void analyzeLoop(FILE* file);
+    void analyzeFrame(int index, const uint8_t* luma);
+    bool isCutScore(float sad, float hist) const;
+    // next 为其后一帧，文件末尾时为空
+    void judge(Pending* candidate, Pending* next);
+    void place(bool flush);
+    void publish(bool keyframe);
+
+    QString m_path;
+    int m_width = 0;
+    int m_height = 0;
+    int m_frameCount = 0;
+    int m_lookahead = 0;
+    int m_minKeyint = 0;
+    int m_maxKeyint = 0;
+    bool m_avx2 = false;
+
+    // 分析线程私有：最近三帧的缩略图和直方图（判断闪光需要前后两帧）
+    int m_blocksW = 0;
+    int m_blocksH = 0;
+    std::vector<uint8_t> m_planes[3];
+    std::vector<int> m_hists[3];
+    std::deque<Pending> m_pending;       // 已算出得分、等待判定或放置关键帧的帧
+    float m_avgSad = -1;
+    int m_lastKey = -1;
+    bool m_deferring = false;
+
+    QThread* m_thread = nullptr;
+    mutable QMutex m_mutex;
+    QWaitCondition m_cond;
+    std::vector<uint8_t> m_decisions;    // 按帧序，1 为关键帧
+    int m_requested = 0;
+    bool m_finished = false;
+    bool m_stop = false;
+
+    // 统计
+    std::vector<Cut> m_cuts;
+    std::vector<int> m_keyframes;
+    int m_periodicKeys = 0;
+    int m_suppressedPeriodic = 0;
+    int m_flashes = 0;
+    int m_analyzedFrames = 0;
+    int m_encodedFrames = -1;            // clipToFrames 之前为 -1
+    int64_t m_analyzeUs = 0;
+    int64_t m_readUs = 0;
+    int64_t m_waitUs = 0;
+};
\ No newline at end of file
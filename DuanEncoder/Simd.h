@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+// AVX2 内核的编译与运行时选择。整个工程按基线指令集编译，
+// 带 DUAN_AVX2_TARGET 的函数单独启用 AVX2，调用前用 cpuHasAvx2() 判断
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DUAN_X86 1
+#include <immintrin.h>
+// MSVC 不需要编译选项就能用 AVX2 内建函数；GCC/Clang 按函数开启
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DUAN_AVX2_TARGET
+#else
+#define DUAN_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// 结果由 FFmpeg 缓存，也受 av_force_cpu_flags 影响，便于对比标量路径
+inline bool cpuHasAvx2() {
+#ifdef DUAN_X86
+    return (av_get_cpu_flags() & AV_CPU_FLAG_AVX2) != 0;
+#else
+    return false;
+#endif
+}
+
+// mask 不能为 0
+inline int countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "SliceOutput.h"
+#include "Tracer.h"
+#include "Simd.h"
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+namespace {
+const uint8_t* findStartCodeC(const uint8_t* from, const uint8_t* end) {
+    const uint8_t* p = from;
+    while (p + 2 < end) {
+        // 第三个字节大于 1 时，起始码不可能从这三个位置中的任何一个开始
+        if (p[2] > 1) {
+            p += 3;
+        }
+        else if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            return p;
+        }
+        else {
+            p++;
+        }
+    }
+    return end;
+}
+
+#ifdef DUAN_X86
+// 三次错位加载分别比较 00、00、01，一次判断 32 个候选位置
+DUAN_AVX2_TARGET const uint8_t* findStartCodeAvx2(const uint8_t* from, const uint8_t* end) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    const uint8_t* p = from;
+    for (; p + 34 <= end; p += 32) {
+        __m256i b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), zero);
+        __m256i b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 1)), zero);
+        __m256i b2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 2)), one);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(b0, b1), b2));
+        if (mask) return p + countTrailingZeros(mask);
+    }
+    return findStartCodeC(p, end);
+}
+#endif
+
+typedef const uint8_t* (*FindStartCodeFn)(const uint8_t*, const uint8_t*);
+
+FindStartCodeFn selectFindStartCode() {
+#ifdef DUAN_X86
+    if (cpuHasAvx2()) return findStartCodeAvx2;
+#endif
+    return findStartCodeC;
+}
+}
+
+const uint8_t* AnnexB::findStartCode(const uint8_t* from, const uint8_t* end) {
+    static const FindStartCodeFn fn = selectFindStartCode();
+    return fn(from, end);
+}
+
+bool AnnexB::isSlice(const uint8_t* nal, AVCodecID codec) {
+    if (codec == AV_CODEC_ID_H264) {
+        int type = nal[0] & 0x1f;
+        return type >= 1 && type <= 5;
+    }
+    if (codec == AV_CODEC_ID_HEVC) {
+        int type = (nal[0] >> 1) & 0x3f;
+        return type <= 31;
+    }
+    return false;
+}
+
+int AvioSliceSink::writeSlice(const uint8_t* data, int size, int64_t pts, bool keyframe, bool lastInFrame) {
+    (void)pts;
+    (void)keyframe;
+    (void)lastInFrame;
+    avio_write(m_pb, data, size);
+    avio_flush(m_pb);
+    return m_pb->error;
+}
+
+SliceDispatcher::SliceDispatcher(AVCodecID codec) : m_codec(codec) {
+    for (int i = 0; i < kPendingFrames; i++) {
+        m_submitUs[i] = -1;
+        m_submitPts[i] = -1;
+    }
+}
+
+void SliceDispatcher::frameSubmitted(int64_t pts) {
+    int slot = (int)(pts % kPendingFrames);
+    m_submitPts[slot] = pts;
+    m_submitUs[slot] = av_gettime_relative();
+    for (SliceSink* sink : m_sinks) sink->frameSubmitted(pts);
+}
+
+int SliceDispatcher::dispatch(const AVPacket* pkt) {
+    const uint8_t* begin = pkt->data;
+    const uint8_t* end = pkt->data + pkt->size;
+    const uint8_t* unit = begin;
+    const uint8_t* sc = AnnexB::findStartCode(begin, end);
+    const bool keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    bool unitHasSlice = false;
+    int64_t submitted = -1;
+    int slot = 0;
+    int ret = 0;
+
+    if (pkt->pts >= 0) {
+        slot = (int)(pkt->pts % kPendingFrames);
+        if (m_submitPts[slot] == pkt->pts) submitted = m_submitUs[slot];
+    }
+
+    auto emitUnit = [&](const uint8_t* from, const uint8_t* to, bool last) -> int {
+        int err = 0;
+        for (SliceSink* sink : m_sinks) {
+            DUAN_TRACE_SCOPE("slice");
+            err = sink->writeSlice(from, (int)(to - from), pkt->pts, keyframe, last);
+            if (err < 0) break;
+        }
+        if (submitted >= 0) {
+            m_latencyUs.push_back((int)(av_gettime_relative() - submitted));
+        }
+        m_slices++;
+        return err;
+    };
+
+    // 每遇到一个新的切片 NAL 就把前一片发出去；参数集、SEI 等非切片 NAL 跟随其后的切片
+    while (sc + 3 < end) {
+        const uint8_t* nal = sc + 3;
+        if (AnnexB::isSlice(nal, m_codec)) {
+            if (unitHasSlice) {
+                // 4 字节起始码前面的 00 归入下一片
+                const uint8_t* cut = sc;
+                while (cut > unit && cut[-1] == 0) cut--;
+                ret = emitUnit(unit, cut, false);
+                if (ret < 0) return ret;
+                unit = cut;
+            }
+            unitHasSlice = true;
+        }
+        sc = AnnexB::findStartCode(nal, end);
+    }
+    ret = emitUnit(unit, end, true);
+
+    m_frames++;
+    if (keyframe) m_keyframes++;
+    m_bytes += pkt->size;
+    m_maxFrameBytes = std::max(m_maxFrameBytes, pkt->size);
+    return ret;
+}
+
+QString SliceDispatcher::report() const {
+    if (m_frames == 0) return "no frames";
+
+    std::vector<int> sorted(m_latencyUs);
+    std::sort(sorted.begin(), sorted.end());
+    double avgUs = 0;
+    for (int us : sorted) avgUs += us;
+    if (!sorted.empty()) avgUs /= sorted.size();
+    auto percentileMs = [&sorted](double p) {
+        if (sorted.empty()) return 0.0;
+        size_t index = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5));
+        return sorted[index] / 1000.0;
+    };
+    double avgFrameBytes = (double)m_bytes / m_frames;
+
+    return QString("%1 frames (%2 key), %3 slices/frame; slice latency avg %4 ms, p50 %5 ms, p95 %6 ms, max %7 ms; "
+        "frame size peak/avg %8")
+        .arg(m_frames).arg(m_keyframes).arg((double)m_slices / m_frames, 0, 'f', 1)
+        .arg(avgUs / 1000.0, 0, 'f', 2).arg(percentileMs(0.5), 0, 'f', 2)
+        .arg(percentileMs(0.95), 0, 'f', 2).arg(percentileMs(1.0), 0, 'f', 2)
+        .arg(avgFrameBytes > 0 ? m_maxFrameBytes / avgFrameBytes : 0.0, 0, 'f', 1);
+}
\ No newline at end of file
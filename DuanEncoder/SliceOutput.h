@@ -0,0 +1,68 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avio.h>
+}
+
+// Annex-B 码流的 NAL 切分
+namespace AnnexB {
+// 返回 [from, end) 中下一个 00 00 01 起始码的位置（指向第一个 00），没有则返回 end。有 AVX2 时每次扫 32 字节
+const uint8_t* findStartCode(const uint8_t* from, const uint8_t* end);
+// nal 指向起始码之后的 NAL 头，判断是否为编码切片（VCL）
+bool isSlice(const uint8_t* nal, AVCodecID codec);
+}
+
+// 切片的去向：低延迟模式下每个切片一产生就交给它，不等整帧
+class SliceSink {
+public:
+    virtual ~SliceSink() {}
+    // 一帧送入编码器时调用，需要按帧记录采集时刻的 sink 重写
+    virtual void frameSubmitted(int64_t pts) { (void)pts; }
+    // data 为完整的 Annex-B 片段（含起始码，帧首切片前带参数集/SEI），lastInFrame 表示本帧最后一片
+    virtual int writeSlice(const uint8_t* data, int size, int64_t pts, bool keyframe, bool lastInFrame) = 0;
+};
+
+// 直接写裸 Annex-B 文件（.h264/.265）的 IO，每片写完立即 flush
+class AvioSliceSink : public SliceSink {
+public:
+    explicit AvioSliceSink(AVIOContext* pb) : m_pb(pb) {}
+    int writeSlice(const uint8_t* data, int size, int64_t pts, bool keyframe, bool lastInFrame) override;
+
+private:
+    AVIOContext* m_pb;
+};
+
+// 把编码器输出的包按切片拆开逐个交给 sink，并统计每片相对送帧时刻的延迟。
+// libavcodec 的编码器按帧返回包，切片在取到包后立即分发；帧内各片的延迟差别来自分发本身
+class SliceDispatcher {
+public:
+    explicit SliceDispatcher(AVCodecID codec);
+
+    // 可以挂多个 sink（如文件和网络），按添加顺序依次写
+    void addSink(SliceSink* sink) { m_sinks.push_back(sink); }
+    // 在 avcodec_send_frame 之前调用，记下该帧的送入时刻
+    void frameSubmitted(int64_t pts);
+    // pkt 的时间戳须仍为编码器时间基；没有 sink 时只统计不输出
+    int dispatch(const AVPacket* pkt);
+    // 切片数、每片延迟分布和帧大小的峰均比
+    QString report() const;
+
+private:
+    static const int kPendingFrames = 64;
+
+    AVCodecID m_codec;
+    std::vector<SliceSink*> m_sinks;
+    int64_t m_submitUs[kPendingFrames];
+    int64_t m_submitPts[kPendingFrames];
+
+    int64_t m_frames = 0;
+    int64_t m_keyframes = 0;
+    int64_t m_slices = 0;
+    int64_t m_bytes = 0;
+    int m_maxFrameBytes = 0;
+    std::vector<int> m_latencyUs;      // 每片一个样本
+};
\ No newline at end of file
@@ -0,0 +1,349 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "ThumbnailGenerator.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+// 缩略图数量上限，超出时均匀抽取
+const int kMaxThumbnails = 2000;
+// 按字节划分前抽查的包数，用来确认解复用器给出了包的字节位置
+const int kPositionProbePackets = 64;
+
+// 有的解复用器（如部分裸流解析路径）不填 pkt->pos，这时无法按字节位置把关键帧分给区间
+bool packetPositionsKnown(AVFormatContext* fmt_ctx, int streamIndex) {
+    AVPacket* pkt = av_packet_alloc();
+    bool known = true;
+    int seen = 0;
+    if (!pkt) return false;
+    while (seen < kPositionProbePackets && av_read_frame(fmt_ctx, pkt) >= 0) {
+        if (pkt->stream_index == streamIndex) {
+            if (pkt->pos < 0) known = false;
+            seen++;
+        }
+        av_packet_unref(pkt);
+        if (!known) break;
+    }
+    av_packet_free(&pkt);
+    return known;
+}
+}
+
+ThumbnailGenerator::ThumbnailGenerator(QObject* parent) : QThread(parent) {}
+
+ThumbnailGenerator::~ThumbnailGenerator() {
+    wait();
+}
+
+void ThumbnailGenerator::setParams(const QString& inputFile, const QString& outputPrefix,
+    int thumbWidth, int columns, int workers) {
+    m_inputFile = inputFile;
+    m_outputPrefix = outputPrefix;
+    m_thumbWidth = std::max(16, thumbWidth) & ~1;
+    m_columns = std::max(1, columns);
+    m_workers = workers > 0 ? workers : QThread::idealThreadCount();
+}
+
+void ThumbnailGenerator::printError(const char* msg, int errnum) {
+    char err_buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+    av_strerror(errnum, err_buf, sizeof(err_buf));
+    emit thumbLog(QString("%1: %2").arg(msg).arg(err_buf));
+}
+
+int ThumbnailGenerator::processRange(const Range& range, std::vector<Thumb>& thumbs) {
+    AVFormatContext* fmt_ctx = nullptr;
+    AVCodecContext* codec_ctx = nullptr;
+    const AVCodec* codec = nullptr;
+    AVPacket* pkt = nullptr;
+    AVFrame* frame = nullptr;
+    SwsContext* sws_ctx = nullptr;
+    int64_t key_pos = -1;
+    int64_t last_pos = range.start;
+    int ret = 0;
+
+    ret = avformat_open_input(&fmt_ctx, m_inputFile.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0) goto cleanup;
+
+    ret = avformat_find_stream_info(fmt_ctx, nullptr);
+    if (ret < 0) goto cleanup;
+
+    codec = avcodec_find_decoder(fmt_ctx->streams[m_streamIndex]->codecpar->codec_id);
+    if (!codec) {
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto cleanup;
+    }
+
+    codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) {
+        ret = AVERROR(ENOMEM);
+        goto cleanup;
+    }
+
+    ret = avcodec_parameters_to_context(codec_ctx, fmt_ctx->streams[m_streamIndex]->codecpar);
+    if (ret < 0) goto cleanup;
+
+    // 只解关键帧；并行度来自区间划分，解码器本身单线程
+    codec_ctx->skip_frame = AVDISCARD_NONKEY;
+    codec_ctx->thread_count = 1;
+    ret = avcodec_open2(codec_ctx, codec, nullptr);
+    if (ret < 0) goto cleanup;
+
+    pkt = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!pkt || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto cleanup;
+    }
+
+    if (range.start > 0) {
+        if (m_byteRanges) {
+            ret = av_seek_frame(fmt_ctx, -1, range.start, AVSEEK_FLAG_BYTE);
+        }
+        else {
+            ret = av_seek_frame(fmt_ctx, m_streamIndex, range.start, AVSEEK_FLAG_BACKWARD);
+        }
+        if (ret < 0) goto cleanup;
+    }
+
+    while ((ret = av_read_frame(fmt_ctx, pkt)) >= 0) {
+        if (pkt->pos >= 0) last_pos = pkt->pos;
+        if (pkt->stream_index != m_streamIndex || !(pkt->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        // 区间以关键帧包的位置（或时间戳）为准，保证相邻区间不重复不遗漏
+        int64_t where = m_byteRanges ? pkt->pos : (pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts);
+        // 个别包没有字节位置时沿用之前最近一个已知位置，不能当成 -1 落到区间外被跳过。
+        // 位置普遍缺失的文件在探测时已退回单一区间
+        if (m_byteRanges && where < 0) where = last_pos;
+        if (where >= range.end) {
+            av_packet_unref(pkt);
+            break;
+        }
+        if (where < range.start) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        key_pos = pkt->pos;
+        ret = avcodec_send_packet(codec_ctx, pkt);
+        av_packet_unref(pkt);
+        if (ret < 0) goto cleanup;
+
+        // 每个关键帧单独冲刷，拿到图像后复位解码器，跳过中间的非关键帧
+        avcodec_send_packet(codec_ctx, nullptr);
+        while (avcodec_receive_frame(codec_ctx, frame) >= 0) {
+            Thumb thumb;
+            thumb.pos = key_pos;
+            if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                thumb.seconds = frame->best_effort_timestamp * av_q2d(m_timeBase);
+            }
+            thumb.image = QImage(m_thumbWidth, m_thumbHeight, QImage::Format_RGB888);
+
+            sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, (AVPixelFormat)frame->format,
+                m_thumbWidth, m_thumbHeight, AV_PIX_FMT_RGB24, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+            if (sws_ctx) {
+                uint8_t* dst[4] = { thumb.image.bits(), nullptr, nullptr, nullptr };
+                int dst_linesize[4] = { (int)thumb.image.bytesPerLine(), 0, 0, 0 };
+                sws_scale(sws_ctx, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+                thumbs.push_back(thumb);
+            }
+            av_frame_unref(frame);
+        }
+        avcodec_flush_buffers(codec_ctx);
+    }
+    if (ret == AVERROR_EOF) ret = 0;
+
+cleanup:
+    if (sws_ctx) sws_freeContext(sws_ctx);
+    if (frame) av_frame_free(&frame);
+    if (pkt) av_packet_free(&pkt);
+    if (codec_ctx) avcodec_free_context(&codec_ctx);
+    if (fmt_ctx) avformat_close_input(&fmt_ctx);
+    return ret;
+}
+
+bool ThumbnailGenerator::writeOutputs(std::vector<Thumb>& thumbs) {
+    // 均匀抽取，限制拼图尺寸
+    if ((int)thumbs.size() > kMaxThumbnails) {
+        std::vector<Thumb> picked;
+        picked.reserve(kMaxThumbnails);
+        for (int i = 0; i < kMaxThumbnails; i++) {
+            picked.push_back(thumbs[(size_t)i * thumbs.size() / kMaxThumbnails]);
+        }
+        thumbs.swap(picked);
+    }
+
+    int count = (int)thumbs.size();
+    int columns = std::min(m_columns, count);
+    int rows = (count + columns - 1) / columns;
+    QImage sheet(columns * m_thumbWidth, rows * m_thumbHeight, QImage::Format_RGB888);
+    sheet.fill(Qt::black);
+
+    QJsonArray entries;
+    QPainter painter(&sheet);
+    for (int i = 0; i < count; i++) {
+        int x = (i % columns) * m_thumbWidth;
+        int y = (i / columns) * m_thumbHeight;
+        painter.drawImage(x, y, thumbs[i].image);
+
+        QJsonObject entry;
+        entry["index"] = i;
+        entry["time"] = thumbs[i].seconds;
+        entry["pos"] = (double)thumbs[i].pos;
+        entry["x"] = x;
+        entry["y"] = y;
+        entries.append(entry);
+    }
+    painter.end();
+
+    QString image_path = m_outputPrefix + ".png";
+    if (!sheet.save(image_path)) {
+        emit thumbLog(QString("Could not write sprite sheet '%1'").arg(image_path));
+        return false;
+    }
+
+    QJsonObject root;
+    root["source"] = m_inputFile;
+    root["image"] = QFileInfo(image_path).fileName();
+    root["thumb_width"] = m_thumbWidth;
+    root["thumb_height"] = m_thumbHeight;
+    root["columns"] = columns;
+    root["rows"] = rows;
+    root["thumbnails"] = entries;
+
+    QString map_path = m_outputPrefix + ".json";
+    QFile map_file(map_path);
+    if (!map_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit thumbLog(QString("Could not write timestamp map '%1'").arg(map_path));
+        return false;
+    }
+    map_file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+
+    emit thumbLog(QString("Wrote %1 thumbnails to '%2' and '%3'").arg(count).arg(image_path).arg(map_path));
+    return true;
+}
+
+void ThumbnailGenerator::run() {
+    AVFormatContext* fmt_ctx = nullptr;
+    AVStream* stream = nullptr;
+    std::vector<Range> ranges;
+    std::vector<std::vector<Thumb>> results;
+    std::atomic<int> done{ 0 };
+    std::atomic<int> failed{ 0 };
+    std::vector<Thumb> thumbs;
+    QThreadPool pool;
+    QElapsedTimer timer;
+    int64_t total = 0;
+    int ret = 0;
+
+    m_success = false;
+    timer.start();
+
+    // 先探测一次：视频流、时长、是否只能按字节划分
+    ret = avformat_open_input(&fmt_ctx, m_inputFile.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0) {
+        printError("Unable to open the input file.", ret);
+        goto cleanup;
+    }
+
+    ret = avformat_find_stream_info(fmt_ctx, nullptr);
+    if (ret < 0) {
+        printError("Unable to retrieve stream information.", ret);
+        goto cleanup;
+    }
+
+    m_streamIndex = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (m_streamIndex < 0) {
+        emit thumbLog("No video stream found.");
+        goto cleanup;
+    }
+    stream = fmt_ctx->streams[m_streamIndex];
+    m_timeBase = stream->time_base;
+    m_thumbHeight = (int)((int64_t)m_thumbWidth * stream->codecpar->height / std::max(1, stream->codecpar->width)) & ~1;
+    m_thumbHeight = std::max(2, m_thumbHeight);
+
+    // 有时长的容器按时间划分；H.264/H.265裸流没有可靠时长，按字节划分
+    if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0 &&
+        !(fmt_ctx->iformat->flags & AVFMT_NOTIMESTAMPS)) {
+        m_byteRanges = false;
+        total = stream->duration;
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        for (int i = 0; i < m_workers; i++) {
+            Range r;
+            r.start = start + total * i / m_workers;
+            r.end = (i == m_workers - 1) ? INT64_MAX : start + total * (i + 1) / m_workers;
+            ranges.push_back(r);
+        }
+    }
+    else {
+        m_byteRanges = true;
+        total = avio_size(fmt_ctx->pb);
+        if (total <= 0 || (fmt_ctx->iformat->flags & AVFMT_NO_BYTE_SEEK) ||
+            !packetPositionsKnown(fmt_ctx, m_streamIndex)) {
+            // 不能按字节定位或包没有字节位置：整个文件交给一个工作线程顺序处理
+            ranges.push_back(Range{ 0, INT64_MAX });
+        }
+        else {
+            for (int i = 0; i < m_workers; i++) {
+                Range r;
+                r.start = total * i / m_workers;
+                r.end = (i == m_workers - 1) ? INT64_MAX : total * (i + 1) / m_workers;
+                ranges.push_back(r);
+            }
+        }
+    }
+    avformat_close_input(&fmt_ctx);
+
+    emit thumbLog(QString("Generating %1x%2 thumbnails of '%3' with %4 workers (%5 ranges)")
+        .arg(m_thumbWidth).arg(m_thumbHeight).arg(m_inputFile).arg(ranges.size())
+        .arg(m_byteRanges ? "byte" : "time"));
+
+    results.resize(ranges.size());
+    pool.setMaxThreadCount((int)ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        pool.start([this, &ranges, &results, &done, &failed, i]() {
+            int r = processRange(ranges[i], results[i]);
+            if (r < 0) {
+                printError("Thumbnail worker failed", r);
+                failed++;
+            }
+            emit thumbProgress(++done, (int)ranges.size());
+        });
+    }
+    pool.waitForDone();
+
+    if (failed > 0) {
+        goto cleanup;
+    }
+
+    // 各区间结果按顺序拼接，去掉区间边界处可能重复的关键帧
+    for (std::vector<Thumb>& part : results) {
+        for (Thumb& t : part) {
+            if (!thumbs.empty() && thumbs.back().pos == t.pos && t.pos >= 0) continue;
+            thumbs.push_back(t);
+        }
+    }
+
+    if (thumbs.empty()) {
+        emit thumbLog("No keyframes decoded.");
+        goto cleanup;
+    }
+
+    emit thumbLog(QString("Decoded %1 keyframes in %2 ms").arg(thumbs.size()).arg(timer.elapsed()));
+    m_success = writeOutputs(thumbs);
+
+cleanup:
+    if (fmt_ctx) avformat_close_input(&fmt_ctx);
+    emit thumbFinished(m_success);
+}
\ No newline at end of file
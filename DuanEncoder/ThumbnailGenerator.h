@@ -0,0 +1,67 @@
+#pragma once
+#include <QThread>
+#include <QString>
+#include <QObject>
+#include <QImage>
+#include <QMutex>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/error.h>
+#include <libavutil/rational.h>
+#include <libswscale/swscale.h>
+}
+
+// 缩略图条生成：只解码关键帧，文件按时间（或字节）区间分给多个线程并行处理，
+// 输出一张拼图 <prefix>.png 和时间戳映射 <prefix>.json。界面和命令行都可调用
+class ThumbnailGenerator : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailGenerator(QObject* parent = nullptr);
+    ~ThumbnailGenerator() override;
+
+    void setParams(const QString& inputFile, const QString& outputPrefix,
+        int thumbWidth = 160, int columns = 10, int workers = 0);
+    bool succeeded() const { return m_success; }
+
+protected:
+    void run() override;
+
+signals:
+    void thumbLog(const QString& log);
+    void thumbProgress(int current, int total);
+    void thumbFinished(bool success);
+
+private:
+    struct Thumb {
+        double seconds = -1.0;   // 无时间戳时为 -1
+        int64_t pos = -1;        // 关键帧包的字节位置
+        QImage image;
+    };
+
+    struct Range {
+        int64_t start = 0;
+        int64_t end = 0;
+    };
+
+    void printError(const char* msg, int errnum);
+    int processRange(const Range& range, std::vector<Thumb>& thumbs);
+    bool writeOutputs(std::vector<Thumb>& thumbs);
+
+    QString m_inputFile;
+    QString m_outputPrefix;
+    int m_thumbWidth = 160;
+    int m_thumbHeight = 90;
+    int m_columns = 10;
+    int m_workers = 0;
+    bool m_success = false;
+
+    // 探测结果，各工作线程共用
+    bool m_byteRanges = false;
+    int m_streamIndex = -1;
+    AVRational m_timeBase{ 1, 1 };
+};
\ No newline at end of file
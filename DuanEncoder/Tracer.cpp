@@ -0,0 +1,200 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Tracer.h"
+#include <QFile>
+#include <QTextStream>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+// 每个线程保留最近的 64K 段，约 1.5 MB，只在首次记录时分配，线程退出后由新线程复用
+const uint32_t kRingCapacity = 1u << 16;
+
+struct TraceEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t durNs;
+};
+
+// 单写者环形缓冲区：只有所属线程写入，导出线程按 head 读取快照。
+// head 只增不减；clear() 不碰 head，只推进全局代数，所属线程下次记录时把 start 移到 head
+struct TraceRing {
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> start{ 0 };    // 本代第一个事件
+    std::atomic<uint64_t> epoch{ 0 };    // start 对应的清空代数，与全局不同说明本代还没有事件
+    TraceEvent events[kRingCapacity];
+    int tid = 0;
+    char name[32] = { 0 };
+};
+
+// 线程退出后缓冲区留在 registry 里供导出，同时进入空闲队列，
+// 新线程优先接手最早退出的那个，缓冲区总数不超过同时记录过的线程数
+struct TraceRegistry {
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    std::deque<TraceRing*> retired;
+    int nextTid = 0;
+};
+
+QMutex g_registryMutex;
+TraceRegistry& registry() {
+    static TraceRegistry reg;
+    return reg;
+}
+
+std::atomic<uint64_t> g_clearEpoch{ 0 };
+
+// 线程退出时把缓冲区交还空闲队列
+struct RingOwner {
+    TraceRing* ring = nullptr;
+    ~RingOwner() {
+        if (!ring) return;
+        QMutexLocker locker(&g_registryMutex);
+        registry().retired.push_back(ring);
+    }
+};
+
+thread_local RingOwner t_owner;
+thread_local char t_pendingName[32] = { 0 };
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+TraceRing* currentRing() {
+    TraceRing* ring = t_owner.ring;
+    if (ring) return ring;
+
+    // 每个线程第一次记录时注册，之后写入无锁
+    QMutexLocker locker(&g_registryMutex);
+    TraceRegistry& reg = registry();
+    if (!reg.retired.empty()) {
+        ring = reg.retired.front();
+        reg.retired.pop_front();
+    }
+    else {
+        reg.rings.emplace_back(new TraceRing());
+        ring = reg.rings.back().get();
+    }
+    // 接手的缓冲区里是上一个线程的事件，换新的 tid 并从当前 head 开始，导出时不会串到新线程上
+    ring->tid = ++reg.nextTid;
+    ring->start.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    ring->epoch.store(g_clearEpoch.load(std::memory_order_relaxed), std::memory_order_release);
+    if (t_pendingName[0]) {
+        memcpy(ring->name, t_pendingName, sizeof(ring->name));
+    }
+    else {
+        snprintf(ring->name, sizeof(ring->name), "thread %d", ring->tid);
+    }
+    t_owner.ring = ring;
+    return ring;
+}
+
+QString jsonEscape(const char* text) {
+    QString out;
+    for (const char* p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += QLatin1Char(*p);
+    }
+    return out;
+}
+}
+
+std::atomic<bool> Tracer::s_enabled{ false };
+
+void Tracer::setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(const char* name) {
+    strncpy(t_pendingName, name, sizeof(t_pendingName) - 1);
+    if (t_owner.ring) {
+        QMutexLocker locker(&g_registryMutex);
+        memcpy(t_owner.ring->name, t_pendingName, sizeof(t_owner.ring->name));
+    }
+}
+
+int64_t Tracer::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void Tracer::record(const char* name, int64_t startNs, int64_t endNs) {
+    TraceRing* ring = currentRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t epoch = g_clearEpoch.load(std::memory_order_relaxed);
+    if (ring->epoch.load(std::memory_order_relaxed) != epoch) {
+        // clear() 之后的第一次记录：由所属线程自己丢弃旧事件
+        ring->start.store(head, std::memory_order_relaxed);
+        ring->epoch.store(epoch, std::memory_order_release);
+    }
+    TraceEvent& ev = ring->events[head & (kRingCapacity - 1)];
+    ev.name = name;
+    ev.startNs = startNs;
+    ev.durNs = endNs - startNs;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::clear() {
+    // 只推进代数，不写其他线程的缓冲区；代数落后的缓冲区导出时视为空
+    QMutexLocker locker(&g_registryMutex);
+    g_clearEpoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t Tracer::exportChromeTrace(const QString& path, QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return -1;
+    }
+
+    QTextStream out(&file);
+    qint64 pid = QCoreApplication::applicationPid();
+    int64_t written = 0;
+    bool first = true;
+    std::vector<TraceEvent> snapshot;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    QMutexLocker locker(&g_registryMutex);
+    const uint64_t epoch = g_clearEpoch.load(std::memory_order_relaxed);
+    for (auto& ring : registry().rings) {
+        // 本代还没有记录过的缓冲区只剩清空前的事件
+        if (ring->epoch.load(std::memory_order_acquire) != epoch) continue;
+        // 先读 head 再拷贝，拷贝后再读一次，丢掉拷贝期间被覆盖的旧事件
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(ring->start.load(std::memory_order_relaxed),
+            head > kRingCapacity ? head - kRingCapacity : 0);
+        snapshot.clear();
+        for (uint64_t i = begin; i < head; i++) {
+            snapshot.push_back(ring->events[i & (kRingCapacity - 1)]);
+        }
+        uint64_t after = ring->head.load(std::memory_order_acquire);
+        size_t skip = after > kRingCapacity && after - kRingCapacity > begin
+            ? (size_t)std::min<uint64_t>(after - kRingCapacity - begin, snapshot.size()) : 0;
+
+        out << (first ? "" : ",\n")
+            << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+            << ",\"args\":{\"name\":\"" << jsonEscape(ring->name) << "\"}}";
+        first = false;
+
+        for (size_t i = skip; i < snapshot.size(); i++) {
+            const TraceEvent& ev = snapshot[i];
+            out << ",\n{\"ph\":\"X\",\"name\":\"" << jsonEscape(ev.name) << "\",\"pid\":" << pid
+                << ",\"tid\":" << ring->tid
+                << ",\"ts\":" << QString::number(ev.startNs / 1000.0, 'f', 3)
+                << ",\"dur\":" << QString::number(ev.durNs / 1000.0, 'f', 3) << "}";
+            written++;
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+
+    if (file.error() != QFileDevice::NoError) {
+        if (error) *error = file.errorString();
+        return -1;
+    }
+    return written;
+}
\ No newline at end of file
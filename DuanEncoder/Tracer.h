@@ -0,0 +1,58 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <cstdint>
+
+// 分阶段耗时追踪，导出为 Chrome trace / Perfetto 可直接打开的 JSON。
+// 编译期：定义 DUAN_TRACE=0 时所有埋点宏展开为空；
+// 运行期：Tracer::setEnabled(false)（默认）时每个埋点只多一次原子读，不分配内存
+#ifndef DUAN_TRACE
+#define DUAN_TRACE 1
+#endif
+
+class Tracer {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // 给当前线程命名，显示在 trace 的线程轨道上
+    static void setThreadName(const char* name);
+
+    // 写入当前线程的环形缓冲区；name 必须是静态字符串
+    static void record(const char* name, int64_t startNs, int64_t endNs);
+    static int64_t nowNs();
+
+    // 导出所有线程缓冲区中的事件，返回写出的事件数，失败返回 -1
+    static int64_t exportChromeTrace(const QString& path, QString* error = nullptr);
+    // 清空已记录的事件，可在任意线程调用；各线程的缓冲区由其自己在下次记录时重置
+    static void clear();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+#if DUAN_TRACE
+// 作用域计时：构造时取开始时间，析构时记录一段
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name), m_start(Tracer::isEnabled() ? Tracer::nowNs() : -1) {}
+    ~TraceScope() {
+        if (m_start >= 0) Tracer::record(m_name, m_start, Tracer::nowNs());
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+};
+
+#define DUAN_TRACE_CONCAT2(a, b) a##b
+#define DUAN_TRACE_CONCAT(a, b) DUAN_TRACE_CONCAT2(a, b)
+#define DUAN_TRACE_SCOPE(name) TraceScope DUAN_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define DUAN_TRACE_THREAD(name) Tracer::setThreadName(name)
+#else
+#define DUAN_TRACE_SCOPE(name) ((void)0)
+#define DUAN_TRACE_THREAD(name) ((void)0)
+#endif
\ No newline at end of file
@@ -1,14 +1,343 @@
 #include "MainWindow.h"
+#include "ThumbnailGenerator.h"
+#include "Tracer.h"
+#include "EncodePool.h"
+#include "EncodeWorker.h"
+#include "FrameMemory.h"
+#include "BitstreamAnalyzer.h"
+#include "EncoderThread.h"
+#include "RtpStream.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 #include "stdafx.h"
 
+// 无界面模式：DuanEncoder --thumbnails <视频文件> [--out 前缀] [--thumb-width 160] [--columns 10] [--workers N]
+static int runThumbnails(const QCommandLineParser& parser)
+{
+    QString input = parser.value("thumbnails");
+    QString prefix = parser.isSet("out") ? parser.value("out") : input + ".thumbs";
+
+    ThumbnailGenerator generator;
+    // 主线程阻塞在 wait() 上，日志需直接在工作线程输出
+    QObject::connect(&generator, &ThumbnailGenerator::thumbLog, &generator, [](const QString& log) {
+        fprintf(stdout, "%s\n", log.toLocal8Bit().constData());
+        fflush(stdout);
+    }, Qt::DirectConnection);
+    generator.setParams(input, prefix, parser.value("thumb-width").toInt(),
+        parser.value("columns").toInt(), parser.value("workers").toInt());
+    generator.start();
+    generator.wait();
+    return generator.succeeded() ? 0 : 1;
+}
+
+// 编码工作进程：由 EncodePool 启动，只需要 QCoreApplication
+static int runEncodeWorker(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addOption({ "encode-worker", "Run as an encode worker connected to <server>.", "server" });
+    parser.addOption({ "worker-id", "Worker index assigned by the pool.", "n", "0" });
+    parser.addOption({ "worker-crash-after", "Crash after <n> frames (for testing restarts).", "n", "0" });
+    parser.process(app);
+
+    EncodeWorker worker(parser.value("encode-worker"), parser.value("worker-id").toInt(),
+        parser.value("worker-crash-after").toInt());
+    return worker.run();
+}
+
+// 多进程编码吞吐随工作进程数的变化：
+// DuanEncoder --encode-scaling <YUV文件> --width 1280 --height 720 [--frames 500] [--bitrate 2000] [--codec h264|hevc] [--workers N] [--inject-crash N]
+static int runEncodeScaling(const QCommandLineParser& parser)
+{
+    QString input = parser.value("encode-scaling");
+    QString output = parser.isSet("out") ? parser.value("out") : QDir::temp().filePath("duan_scaling.mp4");
+    int max_workers = parser.value("workers").toInt();
+    if (max_workers <= 0) max_workers = QThread::idealThreadCount();
+    int codec = parser.value("codec") == "hevc" ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+    int width = parser.value("width").toInt();
+    int height = parser.value("height").toInt();
+    std::vector<double> fps;
+    std::vector<int> keyframes;
+    std::vector<LogEntry> entries;
+    int64_t frame_bytes = (int64_t)width * height * 3 / 2;
+    int64_t total_frames = parser.value("frames").toInt();
+    int segment_frames = 0;
+
+    // 每段以 IDR 开头；段长随进程数变化时关键帧开销也跟着变，所以所有轮次都用最大进程数对应的段长
+    if (frame_bytes > 0) {
+        total_frames = std::min<int64_t>(total_frames, QFileInfo(input).size() / frame_bytes);
+    }
+    segment_frames = EncodePool::autoSegmentFrames(std::max<int64_t>(total_frames, 1), max_workers);
+
+    // 主线程阻塞等待，日志在这里定时取出打印
+    auto printLog = [&entries]() {
+        entries.clear();
+        LogSink::instance().drain(entries, LogSink::kCapacity);
+        for (const LogEntry& entry : entries) {
+            fprintf(stdout, "[%s] %s\n", entry.source, entry.text.toLocal8Bit().constData());
+        }
+        fflush(stdout);
+    };
+
+    for (int workers = 1; workers <= max_workers; workers++) {
+        EncodePool pool;
+        pool.setParams(input, output, width, height,
+            parser.value("bitrate").toInt() * 1000, parser.value("frames").toInt(), codec, workers);
+        pool.setSegmentFrames(segment_frames);
+        if (workers == max_workers) {
+            // 崩溃注入放在最后一轮，重启的代价会体现在这一行的吞吐里
+            pool.setInjectedCrash(parser.value("inject-crash").toInt());
+        }
+        pool.start();
+        while (!pool.wait(200)) {
+            printLog();
+        }
+        printLog();
+        if (!pool.succeeded()) {
+            fprintf(stderr, "encode with %d workers failed\n", workers);
+            return 1;
+        }
+        fps.push_back(pool.throughput());
+        keyframes.push_back(pool.keyframeCount());
+    }
+
+    fprintf(stdout, "\nsegments of %d frames in every run\n", segment_frames);
+    fprintf(stdout, "workers      fps  speedup  efficiency  keyframes\n");
+    for (size_t i = 0; i < fps.size(); i++) {
+        double speedup = fps[0] > 0 ? fps[i] / fps[0] : 0.0;
+        fprintf(stdout, "%7d  %7.1f  %6.2fx  %9.0f%%  %9d\n", (int)i + 1, fps[i], speedup, speedup * 100.0 / (i + 1), keyframes[i]);
+    }
+    if (!parser.isSet("out")) {
+        QFile::remove(output);
+    }
+    return 0;
+}
+
+// 大帧缓冲基准：DuanEncoder --frame-bench [--width 3840 --height 2160] [--frames 100] [--numa-node N]
+// 对比普通页和大页下的帧拷贝/遍历吞吐与 dTLB 缺失
+static int runFrameBench(const QCommandLineParser& parser)
+{
+    int width = parser.isSet("width") ? parser.value("width").toInt() : 3840;
+    int height = parser.isSet("height") ? parser.value("height").toInt() : 2160;
+    int frames = parser.isSet("frames") ? parser.value("frames").toInt() : 100;
+    QString report = FrameMemory::runBenchmark(width, height, frames, parser.value("numa-node").toInt());
+    fprintf(stdout, "%s\n", report.toLocal8Bit().constData());
+    return 0;
+}
+
+// 离线码流分析：DuanEncoder --analyze <.h264/.h265 文件> [--codec h264|hevc] [--out 报告.json|.bin]
+// 不指定 --codec 时按扩展名判断，报告默认写到 <文件>.analysis.json
+static int runAnalyze(const QCommandLineParser& parser)
+{
+    QString input = parser.value("analyze");
+    QString report = parser.isSet("out") ? parser.value("out") : input + ".analysis.json";
+    bool hevc = parser.isSet("codec") ? parser.value("codec") == "hevc"
+        : input.endsWith(".h265", Qt::CaseInsensitive) || input.endsWith(".265", Qt::CaseInsensitive)
+            || input.endsWith(".hevc", Qt::CaseInsensitive);
+    BitstreamAnalyzer analyzer(hevc ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264);
+    QString error;
+
+    int64_t start_ns = Tracer::nowNs();
+    if (!analyzer.analyzeFile(input, &error)) {
+        fprintf(stderr, "Unable to analyze '%s': %s\n", input.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+        return 1;
+    }
+    double elapsed_ms = (Tracer::nowNs() - start_ns) / 1e6;
+    fprintf(stdout, "%s\n", analyzer.summary().toLocal8Bit().constData());
+    fprintf(stdout, "analyzed in %.1f ms\n", elapsed_ms);
+
+    if (!analyzer.writeReport(report, &error)) {
+        fprintf(stderr, "Unable to write '%s': %s\n", report.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+        return 1;
+    }
+    fprintf(stdout, "report: %s\n", report.toLocal8Bit().constData());
+    return 0;
+}
+
+// RTP 本机回环：DuanEncoder --rtp-loopback <YUV文件> --width 1280 --height 720 [--frames 500] [--bitrate 2000]
+// [--codec h264|hevc] [--port 5004] [--jitter 50] [--mtu 1400] [--low-latency]
+// 编码并经 UDP 发给本进程内的接收端，报告发送突发度、丢包/乱序和端到端延迟
+static int runRtpLoopback(const QCommandLineParser& parser)
+{
+    QString input = parser.value("rtp-loopback");
+    int codec = parser.value("codec") == "hevc" ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+    // 同时写一份裸码流，低延迟模式下切片直接写 IO
+    QString output = QDir::temp().filePath(codec == AV_CODEC_ID_HEVC ? "duan_rtp_loopback.265" : "duan_rtp_loopback.h264");
+    int port = parser.value("port").toInt();
+    int jitter_ms = parser.value("jitter").toInt();
+    RtpReceiver receiver;
+    EncoderThread encoder;
+    QString error;
+    std::vector<LogEntry> entries;
+    int64_t received_bytes = 0;
+    bool encoded = false;
+
+    auto printLog = [&entries]() {
+        entries.clear();
+        LogSink::instance().drain(entries, LogSink::kCapacity);
+        for (const LogEntry& entry : entries) {
+            fprintf(stdout, "[%s] %s\n", entry.source, entry.text.toLocal8Bit().constData());
+        }
+        fflush(stdout);
+    };
+
+    if (!receiver.open((quint16)port, (AVCodecID)codec, jitter_ms, &error)) {
+        fprintf(stderr, "%s\n", error.toLocal8Bit().constData());
+        return 1;
+    }
+    // 代替播放器把拼好的访问单元读走
+    QThread* consumer = QThread::create([&receiver, &received_bytes]() {
+        std::vector<uint8_t> buf(256 * 1024);
+        int n = 0;
+        while ((n = receiver.read(buf.data(), (int)buf.size())) > 0) {
+            received_bytes += n;
+        }
+    });
+    consumer->start();
+
+    encoder.setParams(input, output, parser.value("width").toInt(), parser.value("height").toInt(),
+        parser.value("bitrate").toInt() * 1000, parser.value("frames").toInt(), codec);
+    encoder.setLowLatency(parser.isSet("low-latency"));
+    encoder.setRtpOutput(QString("127.0.0.1:%1").arg(port), jitter_ms, parser.value("mtu").toInt());
+    // 主线程阻塞在 wait() 上，结果直接在编码线程里记下
+    QObject::connect(&encoder, &EncoderThread::encodeFinished, &encoder, [&encoded](bool success) {
+        encoded = success;
+    }, Qt::DirectConnection);
+    encoder.start();
+    while (!encoder.wait(200)) {
+        printLog();
+    }
+    printLog();
+
+    // 留出抖动缓冲的时间让最后几个包到达
+    QThread::msleep(jitter_ms + 100);
+    receiver.close();
+    consumer->wait();
+    delete consumer;
+    QFile::remove(output);
+
+    fprintf(stdout, "receiver: %s\n", receiver.report().toLocal8Bit().constData());
+    fprintf(stdout, "received %.2f MB of Annex-B\n", received_bytes / 1048576.0);
+    // 编码失败（输入、编码器或 RTP 打不开）或接收端一个包都没收到都算测试失败
+    if (!encoded) {
+        fprintf(stderr, "encode failed\n");
+        return 1;
+    }
+    if (receiver.packetsReceived() == 0) {
+        fprintf(stderr, "no RTP packets received\n");
+        return 1;
+    }
+    return 0;
+}
+
+// 命令行里出现这些选项时不打开窗口，只需要 QCoreApplication；支持 --name 和 --name=value 两种写法
+static bool isHeadlessMode(int argc, char* argv[])
+{
+    static const char* const kHeadlessOptions[] = {
+        "--thumbnails", "--frame-bench", "--encode-scaling", "--analyze", "--rtp-loopback",
+    };
+    for (int i = 1; i < argc; i++) {
+        for (const char* option : kHeadlessOptions) {
+            size_t n = strlen(option);
+            if (strncmp(argv[i], option, n) == 0 && (argv[i][n] == '\0' || argv[i][n] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 int main(int argc, char* argv[])
 {
-    QApplication a(argc, argv);  // ʼӦá¼ѭԴ
-    // MainWindow ͨûԶĴ̳ࣨ QMainWindow
-    MainWindow w;
-    // ʾ
-    w.show();
-    //  Qt ¼ѭ
-    return a.exec();  // ʹܹӦû
+    // 工作进程不需要界面和显示环境，在创建 QApplication 之前分流
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--encode-worker") == 0) {
+            return runEncodeWorker(argc, argv);
+        }
+    }
+
+    // 无界面模式用 QCoreApplication，没有显示环境（如远程会话、CI）也能运行；
+    // 缩略图只在 QImage 上绘制和保存，不需要 GUI 平台插件
+    QScopedPointer<QCoreApplication> a(isHeadlessMode(argc, argv)
+        ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({ "thumbnails", "Generate a keyframe thumbnail sprite sheet for <file> and exit.", "file" });
+    parser.addOption({ "out", "Output prefix for <prefix>.png and <prefix>.json, the output file for --encode-scaling, or the report for --analyze (.json or binary).", "prefix" });
+    parser.addOption({ "thumb-width", "Thumbnail width in pixels.", "px", "160" });
+    parser.addOption({ "columns", "Thumbnails per sprite sheet row.", "n", "10" });
+    parser.addOption({ "workers", "Parallel decode workers for --thumbnails, or the largest encode worker count for --encode-scaling (0 = number of cores).", "n", "0" });
+    parser.addOption({ "encode-scaling", "Encode raw YUV420P <file> with 1..N worker processes and report throughput scaling.", "file" });
+    parser.addOption({ "width", "Input width for --encode-scaling, --rtp-loopback and --frame-bench.", "px", "480" });
+    parser.addOption({ "height", "Input height for --encode-scaling, --rtp-loopback and --frame-bench.", "px", "272" });
+    parser.addOption({ "frames", "Frames to encode for --encode-scaling and --rtp-loopback, or to process for --frame-bench (default 100).", "n", "500" });
+    parser.addOption({ "bitrate", "Bitrate in kbps for --encode-scaling and --rtp-loopback.", "kbps", "400" });
+    parser.addOption({ "codec", "h264 or hevc for --encode-scaling, --rtp-loopback and --analyze.", "name", "h264" });
+    parser.addOption({ "frame-bench", "Benchmark the 4K frame path with and without huge pages (throughput and dTLB misses)." });
+    parser.addOption({ "numa-node", "Pin --frame-bench to a NUMA node (-1 = no pinning).", "n", "-1" });
+    parser.addOption({ "inject-crash", "Crash one worker after <n> frames in the last --encode-scaling run.", "n", "0" });
+    parser.addOption({ "analyze", "Write per-frame statistics (type, size, NAL units, QP) for an Annex-B H.264/HEVC <file>.", "file" });
+    parser.addOption({ "rtp-loopback", "Encode raw YUV420P <file> and stream it over RTP to a receiver on localhost; report pacing, loss and latency.", "file" });
+    parser.addOption({ "port", "UDP port for --rtp-loopback.", "port", "5004" });
+    parser.addOption({ "jitter", "Sender pacing budget and receiver jitter buffer in ms for --rtp-loopback.", "ms", "50" });
+    parser.addOption({ "mtu", "Largest RTP packet for --rtp-loopback.", "bytes", "1400" });
+    parser.addOption({ "low-latency", "Use intra refresh and per-slice output for --rtp-loopback." });
+    parser.addOption({ "trace", "Record per-stage timing spans and write them as Chrome trace JSON to <file> on exit.", "file" });
+    parser.process(*a);
+
+    // 退出时导出 trace，可用 chrome://tracing 或 ui.perfetto.dev 打开
+    QString trace_file = parser.value("trace");
+    Tracer::setEnabled(!trace_file.isEmpty());
+    auto exportTrace = [&trace_file](int code) {
+        if (!trace_file.isEmpty()) {
+            QString error;
+            int64_t events = Tracer::exportChromeTrace(trace_file, &error);
+            if (events < 0) {
+                fprintf(stderr, "Unable to write trace '%s': %s\n",
+                    trace_file.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+            }
+            else {
+                fprintf(stdout, "trace: %lld spans written to %s\n", (long long)events, trace_file.toLocal8Bit().constData());
+            }
+        }
+        return code;
+    };
+
+    if (parser.isSet("thumbnails")) {
+        return exportTrace(runThumbnails(parser));
+    }
+    if (parser.isSet("frame-bench")) {
+        return exportTrace(runFrameBench(parser));
+    }
+    if (parser.isSet("encode-scaling")) {
+        return exportTrace(runEncodeScaling(parser));
+    }
+    if (parser.isSet("analyze")) {
+        return exportTrace(runAnalyze(parser));
+    }
+    if (parser.isSet("rtp-loopback")) {
+        return exportTrace(runRtpLoopback(parser));
+    }
+
+    int code = 0;
+    {
+        // MainWindow 通常是用户自定义的窗口类（继承自 QMainWindow）
+        MainWindow w;
+        // 显示主窗口
+        w.show();
+        // 启动 Qt 的事件循环
+        code = a->exec();  // 使程序能够响应用户操作并保持运行
+    }
+    // 窗口析构后各工作线程已结束，再导出
+    return exportTrace(code);
 }
\ No newline at end of file